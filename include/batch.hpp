@@ -4,14 +4,27 @@
 #include "preset.hpp"
 #include "tracker_rules.hpp"
 #include "torrent_creator.hpp"
+#include "batch_journal.hpp"
+#include "config_cache.hpp"
 #include <string>
 #include <vector>
 #include <optional>
 #include <filesystem>
 #include <chrono>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <memory>
 
 namespace fs = std::filesystem;
 
+/** @brief One .torrent of a fan-out job, layered over the job's own settings. */
+struct BatchOutput {
+    std::optional<std::string> output;     ///< Output .torrent path (auto-generated if empty)
+    std::optional<std::string> preset;     ///< Preset name to apply instead of the job's
+    ConfigValues values;                   ///< Overrides applied on top of the job's values
+};
+
 /** @brief A single job within a batch configuration. */
 struct BatchJob {
     std::string path;                      ///< Input file or directory
@@ -19,17 +32,34 @@ struct BatchJob {
     std::optional<std::string> preset;     ///< Preset name to apply
     bool fail_on_season_warning = false;   ///< Fail if TV season pack has missing episodes
     ConfigValues values;                   ///< Per-job config overrides
+    std::vector<BatchOutput> outputs;      ///< Torrents to create from this content (empty = one torrent)
 };
 
 /** @brief Parsed batch configuration from a YAML file. */
 struct BatchConfig {
     int workers = 1;                       ///< Number of parallel workers (default: 1)
+    int64_t hash_memory = 0;               ///< Piece-buffer budget shared by all workers in bytes (0 = default)
+    bool hash_cache = true;                ///< Reuse and record piece hashes in the persistent hash cache
+    int hash_threads = 0;                  ///< Hashing threads shared by all workers (0 = default)
+    int hdd_readers = 1;                   ///< Concurrent jobs per spinning disk
+    int ssd_readers = 0;                   ///< Concurrent jobs per SSD/NVMe or unknown device (0 = no cap)
     std::optional<fs::path> preset_file;   ///< Shared preset file for all jobs
     std::optional<fs::path> rules_file;    ///< Shared tracker rules file for all jobs
     std::optional<fs::path> output_dir;    ///< Default output directory
+    std::optional<fs::path> journal;       ///< Journal of finished jobs (set by parse() beside the batch file)
+    bool resume = false;                   ///< Skip jobs the journal records as done with unchanged settings and content
     std::vector<BatchJob> jobs;            ///< Ordered list of jobs to execute
 };
 
+/** @brief Wall-clock seconds a batch job spent in each phase. */
+struct BatchPhaseTimes {
+    double scan = 0;                       ///< Walking the content tree (ContentIndex::scan)
+    double rules = 0;                      ///< Presets, overrides, target piece count and tracker rules
+    double season = 0;                     ///< TV season pack check
+    double hash = 0;                       ///< Reading and hashing pieces
+    double write = 0;                      ///< Generating, bencoding and saving the .torrent files
+};
+
 /** @brief Result of executing a single batch job. */
 struct BatchResult {
     int job_index;                         ///< Index into the jobs vector
@@ -37,16 +67,98 @@ struct BatchResult {
     bool success;                          ///< Whether the torrent was created successfully
     std::string error_message;             ///< Error details if success is false
     double elapsed_seconds;                ///< Wall-clock time for this job
+    std::vector<std::string> outputs = {}; ///< Torrent files written (several for fan-out jobs)
+    int64_t content_bytes = 0;             ///< Size of the scanned content
+    double predicted_seconds = 0;          ///< Time run() predicted from estimated size and calibrated throughput
+    bool resumed = false;                  ///< Skipped: already done in an earlier run (--resume)
+    BatchPhaseTimes phases = {};           ///< Where elapsed_seconds went
+    int64_t bytes_read = 0;                ///< Content bytes read for hashing (cached pieces are not read)
+
+    /// @brief Effective read-and-hash rate in MB/s (0 if nothing was hashed).
+    double read_mb_per_second() const {
+        return phases.hash > 0 ? bytes_read / phases.hash / (1024.0 * 1024.0) : 0.0;
+    }
+};
+
+/** @brief Totals of a streamed batch; only failed jobs are kept individually. */
+struct BatchStreamSummary {
+    int64_t succeeded = 0;                 ///< Jobs whose torrents were written (or already done on --resume)
+    int64_t resumed = 0;                   ///< Of those, jobs skipped as already done
+    std::vector<BatchResult> failures;     ///< Failed jobs, in completion order
+};
+
+/**
+ * @brief Reads batch jobs one document at a time from NDJSON or multi-document YAML.
+ *
+ * Only the document being parsed is held in memory, so a job list of any
+ * length (for example generated by another program and piped to stdin) can
+ * feed BatchProcessor::run_stream() while it is still being written. In
+ * NDJSON every non-blank line is one job; in YAML every `---`-separated
+ * document is. Either way an optional first document with a `version` key
+ * holds the batch-level settings (workers, preset_file, output_dir, ...).
+ */
+class BatchJobStream {
+public:
+    enum class Format { NDJSON, YAML };
+
+    /**
+     * @brief Read the settings document, if any, from @p in.
+     * @throws std::runtime_error if the settings are invalid.
+     */
+    BatchJobStream(std::istream& in, Format format);
+
+    /**
+     * @brief Open a job stream.
+     * @param path File, or "-" for stdin. Files ending in .ndjson or .jsonl, and stdin
+     *        whose first character is '{', are read as NDJSON; anything else as YAML.
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    static std::unique_ptr<BatchJobStream> open(const std::string& path);
+
+    /// @brief Settings from the stream's first document (no jobs); defaults if it had none.
+    const BatchConfig& settings() const { return settings_; }
+
+    /**
+     * @brief Parse the next job.
+     * @return The job, or nullopt at the end of the stream.
+     * @throws std::runtime_error naming the document if it is not a valid job; the
+     *         stream stays usable and the next call moves on to the following document.
+     */
+    std::optional<BatchJob> next();
+
+    /// @brief Job documents returned or rejected so far.
+    int jobs_read() const { return jobs_read_; }
+
+private:
+    std::unique_ptr<std::istream> owned_;
+    std::istream& in_;
+    Format format_;
+    BatchConfig settings_;
+    std::optional<std::string> pending_;   // First document when it was a job
+    std::string carry_;                    // Content after a "--- " marker on the same line
+    int jobs_read_ = 0;
+
+    BatchJobStream(std::unique_ptr<std::istream> owned, Format format);
+    std::optional<std::string> read_document();
 };
 
 /** @brief Parses batch YAML files and executes jobs in parallel.
  *
- * Uses a worker-pool pattern with std::thread. Each worker pulls the next
- * available job index via an atomic counter, executes it, and stores the result.
+ * Uses a worker-pool pattern with std::thread. Jobs are grouped by the disk
+ * their content lives on, and each worker takes the next job of the least
+ * busy disk that is below its reader cap (DeviceScheduler), so a spinning
+ * disk is read by one job at a time while workers move on to other disks.
+ * Jobs are dispatched longest predicted time first (content size over the
+ * throughput ThroughputModel has measured for the disk in earlier runs).
+ * Every finished job is recorded in a BatchJournal, so a run interrupted
+ * by a crash can be resumed without redoing the jobs that completed.
+ * run_stream() instead takes jobs from a BatchJobStream as workers free up,
+ * in stream order and without device grouping, since later jobs are not
+ * known yet.
  *
- * Thread oversubscription note: each worker internally spawns hashing threads
- * via libtorrent. Total threads ≈ workers × hashing_threads. Consider capping
- * workers to available cores for CPU-bound workloads.
+ * Workers read content and write torrents themselves but hand all piece
+ * hashing to the shared HashExecutor, so hashing threads stay within the
+ * core budget (hash_threads) whatever the number of workers.
  */
 class BatchProcessor {
 public:
@@ -61,13 +173,33 @@ public:
     /** @brief Execute all jobs and return results in order. */
     std::vector<BatchResult> run();
 
+    /**
+     * @brief Execute jobs from @p source as it is read; memory does not grow with the job count.
+     * @param on_result Called for every finished job, one call at a time.
+     */
+    BatchStreamSummary run_stream(BatchJobStream& source,
+                                  const std::function<void(const BatchResult&)>& on_result = {});
+
     /** @brief Print a human-readable summary to stdout. */
     static void print_summary(const std::vector<BatchResult>& results);
 
+    /** @brief Print the totals and failures of a streamed batch to stdout. */
+    static void print_summary(const BatchStreamSummary& summary);
+
+    /**
+     * @brief Write @p result as one JSON line: status, phase times, bytes read and MB/s.
+     *
+     * A file of these lines (--report) is NDJSON, so nightly runs can be
+     * compared per job, per disk and per phase with standard JSON tools.
+     */
+    static void write_report_line(std::ostream& out, const BatchResult& result);
+
 private:
     BatchConfig config_;
 
-    BatchResult execute_job(int job_index, const PresetLoader& presets, const TrackerRulesDatabase& rules);
+    BatchResult execute_job(const BatchJob& job, int job_index, ResolvedConfigCache& cache, BatchJournal* journal);
+    void load_shared_files(PresetLoader& presets, TrackerRulesDatabase& rules) const;
+    std::unique_ptr<BatchJournal> open_journal() const;
 };
 
 #endif
@@ -0,0 +1,63 @@
+#ifndef BATCH_JOURNAL_HPP
+#define BATCH_JOURNAL_HPP
+
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/** @brief Outcome of one batch job as recorded in the journal. */
+struct BatchJournalEntry {
+    int job = 0;                          ///< Index into the batch's jobs
+    bool success = false;                 ///< Whether every output was written
+    std::string config_hash;              ///< Hash of the resolved torrent settings
+    std::string content_fingerprint;      ///< Hash of the scanned files' paths, sizes and mtimes
+    std::vector<std::string> outputs;     ///< Torrent files written
+};
+
+/**
+ * @brief Append-only, crash-safe record of finished batch jobs.
+ *
+ * Each job's outcome is one line, written with a single append and flushed
+ * to disk (fdatasync) before the job counts as done, so after a crash or a
+ * reboot the journal lists every job that completed. Every line ends with a
+ * checksum; a line cut short by a crash fails it and is ignored. When a job
+ * appears more than once, its last line wins.
+ */
+class BatchJournal
+{
+public:
+    /**
+     * @brief Open the journal at @p path.
+     * @param path Journal file; created if missing.
+     * @param keep Keep existing entries (resume); false starts an empty journal.
+     * @throws std::runtime_error if the file cannot be opened for writing.
+     */
+    BatchJournal(std::filesystem::path path, bool keep);
+    ~BatchJournal();
+
+    /// @brief Journal kept for a batch file: "<batch file>.journal" beside it.
+    static std::filesystem::path path_for(const std::filesystem::path& batch_file);
+
+    /// @brief Latest entry recorded for @p job, or null.
+    const BatchJournalEntry* find(int job) const;
+
+    /// @brief Durably append @p entry; failures are logged, not thrown.
+    void append(const BatchJournalEntry& entry);
+
+    /// @brief Valid entries read when the journal was opened.
+    size_t loaded() const { return loaded_; }
+
+    BatchJournal(const BatchJournal&) = delete;
+    BatchJournal& operator=(const BatchJournal&) = delete;
+
+private:
+    std::filesystem::path path_;
+    std::map<int, BatchJournalEntry> entries_;  // Only read before jobs start
+    size_t loaded_ = 0;
+    std::mutex mutex_;
+    int fd_ = -1;
+};
+
+#endif // BATCH_JOURNAL_HPP
@@ -0,0 +1,77 @@
+#ifndef CONFIG_CACHE_HPP
+#define CONFIG_CACHE_HPP
+
+#include "path_filter.hpp"
+#include "preset.hpp"
+#include "tracker_rules.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Memoizes the parts of batch job setup that many jobs share.
+ *
+ * Resolving a preset merges it over the defaults, compiling patterns builds an
+ * automaton, and matching trackers scans every rule; with thousands of jobs
+ * over a handful of presets and tracker sets the same answers are computed
+ * again and again. This cache computes each one once, keyed by preset name,
+ * pattern set and tracker list, and hands the same immutable result to every
+ * worker. Lookups take a shared lock; a miss computes outside the lock, so
+ * two workers may race to fill one entry but both get equal values.
+ *
+ * The loader and rules database must outlive the cache and must not change.
+ */
+class ResolvedConfigCache
+{
+public:
+    ResolvedConfigCache(const PresetLoader& presets, const TrackerRulesDatabase& rules);
+
+    /**
+     * @brief Preset @p name merged over the defaults.
+     * @throws std::runtime_error if the preset does not exist (failures are not cached).
+     */
+    std::shared_ptr<const ConfigValues> preset(const std::string& name);
+
+    /**
+     * @brief Filter for these patterns; copies share one compiled automaton.
+     * @param exclude_patterns User exclude globs.
+     * @param include_patterns Include globs.
+     * @param builtin_excludes Add the built-in excludes (utils::with_builtin_excludes).
+     */
+    PathFilter filter(const std::vector<std::string>& exclude_patterns,
+                      const std::vector<std::string>& include_patterns, bool builtin_excludes);
+
+    /// @brief Rule matching @p trackers (TrackerRulesDatabase::find_matching_rule), in their order.
+    std::shared_ptr<const std::optional<TrackerRule>> rule(const std::vector<std::string>& trackers);
+
+    /// @brief The rules database answers come from (for size-dependent enforcement).
+    const TrackerRulesDatabase& rules() const { return rules_; }
+
+    /// @brief Lookups answered from the cache.
+    int64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+
+    /// @brief Lookups that had to be computed.
+    int64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    const PresetLoader& presets_;
+    const TrackerRulesDatabase& rules_;
+
+    std::shared_mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const ConfigValues>> presets_cache_;
+    std::unordered_map<std::string, PathFilter> filters_;
+    std::unordered_map<std::string, std::shared_ptr<const std::optional<TrackerRule>>> rules_cache_;
+    std::atomic<int64_t> hits_{0};
+    std::atomic<int64_t> misses_{0};
+
+    template <typename Map, typename Make>
+    typename Map::mapped_type lookup(Map& map, const std::string& key, Make make);
+};
+
+#endif // CONFIG_CACHE_HPP
@@ -2,6 +2,7 @@
 #define CONSTANTS_HPP
 
 #include <array>
+#include <cstdint>
 
 /**
  * Standard torrent protocol piece sizes in bytes (16 KB to 32 MB, powers of 2).
@@ -28,4 +29,11 @@ namespace AllowedPieceSizes {
     constexpr std::array<int, 12> values = {16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768};
 }
 
+/**
+ * Default memory for piece buffers in flight while hashing (bytes).
+ */
+namespace HashMemory {
+    constexpr int64_t kDefaultBytes = 256LL * 1024 * 1024;
+}
+
 #endif
@@ -0,0 +1,100 @@
+#ifndef CONTENT_INDEX_HPP
+#define CONTENT_INDEX_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "path_filter.hpp"
+
+/**
+ * @brief Metadata of one regular file captured by a ContentIndex scan.
+ */
+struct ContentEntry {
+    std::string path;         ///< Path relative to the content root, '/'-separated ("" for a single-file root)
+    int64_t size = 0;         ///< File size in bytes
+    uint64_t device = 0;      ///< st_dev of the file
+    uint64_t inode = 0;       ///< st_ino of the file
+    int64_t mtime_ns = 0;     ///< Modification time in nanoseconds since the epoch
+    bool executable = false;  ///< Owner execute bit is set
+    bool symlink = false;     ///< Reached through a symbolic link (the target is indexed)
+};
+
+/**
+ * @brief How ContentIndex::scan walks a directory tree.
+ */
+struct ScanOptions {
+    bool follow_symlinks = true;  ///< Index link targets like lt::add_files; false skips links entirely
+    int threads = 0;              ///< Most directory-walking threads (0 = twice the cores, capped at 16)
+    int64_t max_files = 0;        ///< Stop opening directories once this many files are indexed (0 = no limit)
+};
+
+/**
+ * @brief Immutable snapshot of the files under a torrent's content path.
+ *
+ * One scan collects every file's size, inode and mtime with the include and
+ * exclude patterns already applied, so the stages of a job (disk-space check,
+ * target piece count and tracker rules, season pack check, file storage) all
+ * read the same metadata instead of walking and stat-ing the tree again.
+ *
+ * Subdirectories are listed concurrently by a small pool of threads that grows
+ * only while listed directories queue up (getdents64 and statx on Linux, with
+ * d_type sparing a stat for every directory entry).
+ * Directories matched by an exclude pattern are pruned before they are
+ * opened when no include patterns are given. Symbolic links are followed like
+ * lt::add_files does, except links back to an enclosing directory. Files are
+ * listed in path order regardless of thread timing, so repeated scans of the
+ * same tree are identical and can feed lt::file_storage directly.
+ */
+class ContentIndex
+{
+public:
+    /**
+     * @brief Scan a file or directory.
+     * @param root Content path; a regular file yields a single entry.
+     * @param filter Exclude/include globs applied to every file and directory.
+     * @param options Symlink handling, walker thread count and file limit.
+     * @return The snapshot; unreadable entries are logged and left out.
+     * @throws std::runtime_error if @p root does not exist.
+     */
+    static std::shared_ptr<const ContentIndex> scan(const std::filesystem::path& root,
+                                                    const PathFilter& filter = {},
+                                                    const ScanOptions& options = {});
+
+    /// @brief Content path the index was built from.
+    const std::filesystem::path& root() const { return root_; }
+
+    /// @brief True if the root is a directory (entries are relative to it).
+    bool is_directory() const { return is_directory_; }
+
+    /// @brief Included files in path order.
+    const std::vector<ContentEntry>& files() const { return files_; }
+
+    /// @brief Sum of all included file sizes.
+    int64_t total_size() const { return total_size_; }
+
+    /// @brief Absolute location of an entry on disk.
+    std::filesystem::path full_path(const ContentEntry& entry) const;
+
+    /// @brief Files left out by the patterns.
+    int files_excluded() const { return files_excluded_; }
+
+    /// @brief Directories pruned by exclude patterns without being walked.
+    int dirs_excluded() const { return dirs_excluded_; }
+
+    /// @brief True if ScanOptions::max_files cut the walk short; the index then lists only part of the tree.
+    bool truncated() const { return truncated_; }
+
+private:
+    std::filesystem::path root_;
+    bool is_directory_ = false;
+    std::vector<ContentEntry> files_;
+    int64_t total_size_ = 0;
+    int files_excluded_ = 0;
+    int dirs_excluded_ = 0;
+    bool truncated_ = false;
+};
+
+#endif // CONTENT_INDEX_HPP
@@ -0,0 +1,113 @@
+#ifndef CONTENT_READER_HPP
+#define CONTENT_READER_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+/**
+ * @brief I/O strategy used to read content files.
+ */
+enum class ReadBackend {
+    AUTO,   ///< TB_IO_BACKEND if set, otherwise PREAD
+    PREAD,  ///< Positional reads into caller buffers (pread on POSIX)
+    MMAP    ///< Read-only mapping of the whole file; views point into the mapping (opt-in)
+};
+
+/**
+ * @brief Expected access pattern, forwarded to the kernel as a read-ahead hint.
+ */
+enum class AccessPattern {
+    SEQUENTIAL,  ///< Front-to-back scans (hashing): aggressive read-ahead
+    RANDOM       ///< Scattered piece reads (checking individual pieces)
+};
+
+/**
+ * @brief Positional, read-only access to one content file.
+ *
+ * Shared by the creator, the checker and the updater so every hot loop reads
+ * through the same code path without iostream overhead. Reads never move a
+ * file position, so one instance may serve any offset in any order; instances
+ * are not shared between threads.
+ *
+ * The mmap backend hands out zero-copy views. A file truncated by another
+ * process while it is mapped raises SIGBUS on access, which is why AUTO reads
+ * with pread and MMAP must be requested explicitly.
+ */
+class ContentReader
+{
+public:
+    virtual ~ContentReader() = default;
+
+    /**
+     * @brief Open a file for reading.
+     * @param path File to open.
+     * @param backend Requested backend; MMAP falls back to PREAD for files under 1 MiB,
+     *        on network and FUSE filesystems, and where mapping is unavailable.
+     * @param pattern Access pattern hint.
+     * @return Reader positioned nowhere (all reads are positional).
+     * @throws std::runtime_error if the file cannot be opened.
+     */
+    static std::unique_ptr<ContentReader> open(const std::filesystem::path& path,
+                                               ReadBackend backend = ReadBackend::AUTO,
+                                               AccessPattern pattern = AccessPattern::SEQUENTIAL);
+
+    /**
+     * @brief Parse a backend name ("auto", "pread" or "mmap", case-insensitive).
+     * @return Matching backend, or AUTO for unknown names.
+     */
+    static ReadBackend parse_backend(const std::string& name);
+
+    /// @brief Size of the file in bytes when it was opened.
+    int64_t size() const { return size_; }
+
+    /// @brief Path the reader was opened with.
+    const std::filesystem::path& path() const { return path_; }
+
+    /// @brief Backend actually in use (never AUTO).
+    virtual ReadBackend backend() const = 0;
+
+    /**
+     * @brief Copy bytes at a file offset into a buffer.
+     * @param offset Byte offset within the file.
+     * @param dst Destination buffer of at least @p len bytes.
+     * @param len Number of bytes requested.
+     * @return Bytes copied; less than @p len only when the range passes end of file.
+     * @throws std::runtime_error on an I/O error.
+     */
+    virtual int64_t read(int64_t offset, char* dst, int64_t len) = 0;
+
+    /**
+     * @brief Get a pointer to bytes at a file offset, copying only if needed.
+     *
+     * The mmap backend returns a pointer into the mapping and leaves
+     * @p scratch untouched; other backends read into @p scratch and return it.
+     * The view stays valid until the next call on this reader.
+     *
+     * @param offset Byte offset within the file.
+     * @param len Number of bytes wanted.
+     * @param scratch Buffer of at least @p len bytes used when a copy is needed.
+     * @param got Set to the number of valid bytes (short only at end of file).
+     * @throws std::runtime_error on an I/O error.
+     */
+    virtual const char* view(int64_t offset, int64_t len, char* scratch, int64_t& got);
+
+    /**
+     * @brief Ask the OS to start reading a range that will be needed soon.
+     *
+     * Returns without waiting: the kernel fetches the range in the background
+     * (POSIX_FADV_WILLNEED or MADV_WILLNEED), so a later read() or view()
+     * finds it in the page cache. Only a hint; a no-op where unsupported.
+     */
+    virtual void prefetch(int64_t offset, int64_t len);
+
+protected:
+    ContentReader(std::filesystem::path path, int64_t size)
+        : path_(std::move(path)), size_(size) {}
+
+    std::filesystem::path path_;
+    int64_t size_;
+};
+
+#endif // CONTENT_READER_HPP
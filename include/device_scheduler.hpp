@@ -0,0 +1,84 @@
+#ifndef DEVICE_SCHEDULER_HPP
+#define DEVICE_SCHEDULER_HPP
+
+#include <condition_variable>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+/** @brief Block device that content is read from. */
+struct StorageDevice {
+    std::string id;            ///< Whole-disk "major:minor", or the raw st_dev when no block device is known
+    std::string name;          ///< Kernel name of the disk (e.g. "sda", "nvme0n1"), empty if unknown
+    bool rotational = false;   ///< Spinning disk; also set for a stacked device with any spinning member
+};
+
+/**
+ * @brief Find the device holding @p path.
+ *
+ * On Linux st_dev is looked up in sysfs and partitions are resolved to their
+ * disk, so every partition of one drive maps to the same id. Device-mapper
+ * and md devices count as rotational when any disk below them is. Where
+ * that is not possible (other systems, or filesystems without a block device
+ * such as tmpfs) the device is reported as non-rotational.
+ *
+ * @param path File or directory; a missing path yields an empty id.
+ * @param sysfs_root Root of the sysfs tree, for tests.
+ */
+StorageDevice storage_device_for(const std::filesystem::path& path,
+                                 const std::filesystem::path& sysfs_root = "/sys");
+
+/**
+ * @brief Describe block device @p major:@p minor from sysfs.
+ * @return Device with id "major:minor" and rotational false if sysfs has no entry for it.
+ */
+StorageDevice block_device_info(unsigned major, unsigned minor, const std::filesystem::path& sysfs_root = "/sys");
+
+/**
+ * @brief Hands out batch jobs so that each device has a bounded number of readers.
+ *
+ * Jobs are queued per device in dispatch order. acquire() returns the next
+ * job of the device with the fewest running jobs that is below its cap
+ * (ties go to the device whose next job comes first in that order), so
+ * workers spread over idle disks first and a spinning disk is never read by
+ * more jobs than it can serve without seeking back and forth.
+ */
+class DeviceScheduler {
+public:
+    /**
+     * @param devices Device of each job, indexed like the batch jobs.
+     * @param hdd_readers Concurrent jobs per rotational device (>= 1).
+     * @param ssd_readers Concurrent jobs per other device; 0 = no cap.
+     * @param order Job indices in dispatch order; empty = index order.
+     */
+    DeviceScheduler(const std::vector<StorageDevice>& devices, int hdd_readers, int ssd_readers,
+                    const std::vector<int>& order = {});
+
+    /**
+     * @brief Take the next job, waiting while every device with work is at its cap.
+     * @return Job index, or nullopt once every job has been handed out.
+     */
+    std::optional<int> acquire();
+
+    /// @brief Mark @p job finished, freeing its device slot.
+    void release(int job);
+
+private:
+    struct Queue {
+        std::vector<int> jobs;  // In dispatch order
+        size_t next = 0;
+        int running = 0;
+        int cap = 0;            // 0 = unlimited
+    };
+
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::vector<Queue> queues_;
+    std::vector<int> queue_of_job_;
+    std::vector<int> rank_;  // Position of each job in dispatch order
+    size_t remaining_ = 0;
+};
+
+#endif // DEVICE_SCHEDULER_HPP
@@ -0,0 +1,100 @@
+#ifndef HASH_BACKEND_HPP
+#define HASH_BACKEND_HPP
+
+#include <libtorrent/sha1_hash.hpp>
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief SHA implementation used for piece and merkle hashing.
+ *
+ * SHA_NI hashes one message at a time with the x86 SHA extensions. AVX2 and
+ * AVX512 are multi-buffer kernels that hash 8 or 16 equal-length messages at
+ * once, one per SIMD lane. GENERIC goes through lt::hasher / lt::hasher256.
+ */
+enum class HashKernel {
+    GENERIC,
+    SHA_NI,
+    AVX2,
+    AVX512
+};
+
+/**
+ * @brief One message of a hash batch.
+ */
+struct HashInput {
+    const char* data;  ///< Message bytes
+    int64_t size;      ///< Message length in bytes
+};
+
+namespace hash_backend
+{
+
+/// @brief Fastest kernel this CPU and OS support (AVX-512, then SHA-NI, then AVX2).
+HashKernel detect();
+
+/// @brief Whether @p kernel can run on this machine.
+bool supported(HashKernel kernel);
+
+/**
+ * @brief Kernel used by sha1() and sha256().
+ *
+ * Defaults to detect(); TB_HASH_KERNEL=generic|shani|avx2|avx512 overrides
+ * it when that kernel is supported.
+ */
+HashKernel active();
+
+/**
+ * @brief Switch the kernel used by sha1() and sha256() process-wide.
+ * @throws std::runtime_error if the kernel is not supported here.
+ */
+void set_active(HashKernel kernel);
+
+/**
+ * @brief Parse a kernel name ("generic", "shani", "avx2", "avx512").
+ * @throws std::invalid_argument on unknown names.
+ */
+HashKernel parse_kernel(const std::string& name);
+
+/// @brief Display name of a kernel.
+std::string kernel_name(HashKernel kernel);
+
+/**
+ * @brief Number of messages a batch should hold to keep the active kernel busy.
+ *
+ * 16 for AVX512, 8 for AVX2 and 1 otherwise. Larger batches are fine.
+ */
+int batch_size();
+
+/**
+ * @brief Cross-check every digest against OpenSSL (TB_HASH_VERIFY=1 enables it at startup).
+ *
+ * Meant for validating the kernels on new hardware; a mismatch throws
+ * std::runtime_error instead of producing a wrong torrent.
+ */
+void set_verify(bool enabled);
+
+/// @brief Whether digests are cross-checked against OpenSSL.
+bool verify();
+
+/**
+ * @brief SHA-1 of @p count independent messages.
+ *
+ * Messages of equal length are spread across SIMD lanes by the multi-buffer
+ * kernels, so callers should submit as many as they have at hand.
+ */
+void sha1(const HashInput* inputs, lt::sha1_hash* out, int count);
+
+/// @brief SHA-256 of @p count independent messages.
+void sha256(const HashInput* inputs, lt::sha256_hash* out, int count);
+
+/// @brief SHA-1 of one message.
+lt::sha1_hash sha1(const char* data, int64_t size);
+
+/// @brief SHA-256 of one message.
+lt::sha256_hash sha256(const char* data, int64_t size);
+
+} // namespace hash_backend
+
+#endif // HASH_BACKEND_HPP
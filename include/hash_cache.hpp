@@ -0,0 +1,110 @@
+#ifndef HASH_CACHE_HPP
+#define HASH_CACHE_HPP
+
+#include <libtorrent/sha1_hash.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief Persistent, size-capped store of piece hashes shared between runs.
+ *
+ * Records are opaque byte strings addressed by a 32-byte key (the SHA-256 of
+ * whatever identifies the content they describe). They live in one
+ * append-only file that is memory-mapped by every process using it: lookups
+ * copy the payload out of the mapping and stamp the record's last-use time in
+ * place, new records are appended under an exclusive lock on a sibling
+ * ".lock" file, and once the file outgrows its cap it is rewritten with the
+ * most recently used records only (least recently used are evicted first).
+ *
+ * Every record carries a checksum, so a record torn by a crash or a
+ * concurrent writer is ignored rather than trusted. The cache is purely an
+ * accelerator: any failure to open, map or write it is logged and turns the
+ * operation into a miss.
+ *
+ * Only available on POSIX systems; elsewhere shared() returns null.
+ */
+class HashCache
+{
+public:
+    using Key = lt::sha256_hash;
+
+    /// Default cap of the cache file (TB_HASH_CACHE_MB overrides it).
+    static constexpr int64_t kDefaultMaxBytes = 512LL * 1024 * 1024;
+
+    /**
+     * @brief Open (or create) a cache file.
+     * @param path Cache file; its directory is created if needed.
+     * @param max_bytes Size the file may reach before least recently used records are evicted.
+     */
+    HashCache(std::filesystem::path path, int64_t max_bytes = kDefaultMaxBytes);
+    ~HashCache();
+
+    /**
+     * @brief Process-wide cache at default_path(), opened on first use.
+     * @return The cache, or null when disabled (TB_HASH_CACHE=0) or unsupported.
+     */
+    static std::shared_ptr<HashCache> shared();
+
+    /// @brief $XDG_CACHE_HOME/torrent-builder/piece-hashes.bin (or ~/.cache/...).
+    static std::filesystem::path default_path();
+
+    /**
+     * @brief Copy the payload stored under @p key.
+     * @return False on a miss; @p payload is left untouched then.
+     */
+    bool lookup(const Key& key, std::vector<char>& payload);
+
+    /**
+     * @brief Store a payload under @p key, replacing any previous record.
+     *
+     * Payloads larger than a quarter of the cap are not stored.
+     */
+    void store(const Key& key, const char* data, size_t size);
+
+    /// @brief Records currently addressable.
+    size_t entries() const;
+
+    /// @brief Current size of the cache file in bytes.
+    int64_t file_size() const;
+
+    /// @brief Successful lookups since the cache was opened.
+    int64_t hits() const { return hits_.load(std::memory_order_relaxed); }
+
+    /// @brief Failed lookups since the cache was opened.
+    int64_t misses() const { return misses_.load(std::memory_order_relaxed); }
+
+    HashCache(const HashCache&) = delete;
+    HashCache& operator=(const HashCache&) = delete;
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    std::filesystem::path path_;
+    int64_t max_bytes_;
+    mutable std::mutex mutex_;
+    int fd_ = -1;
+    uint64_t inode_ = 0;
+    char* map_ = nullptr;
+    int64_t mapped_ = 0;   // Bytes mapped (the whole file when last refreshed)
+    int64_t scanned_ = 0;  // End of the last valid record seen
+    std::unordered_map<Key, int64_t, KeyHash> index_;  // Key -> record offset
+    std::atomic<int64_t> hits_{0};
+    std::atomic<int64_t> misses_{0};
+
+    bool open_locked();
+    void close_locked();
+    bool remap_locked();
+    void scan_locked();
+    bool reopen_if_replaced_locked();
+    void compact_locked();
+};
+
+#endif // HASH_CACHE_HPP
@@ -0,0 +1,95 @@
+#ifndef HASH_EXECUTOR_HPP
+#define HASH_EXECUTOR_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Process-wide pool of hashing threads shared by every concurrent job.
+ *
+ * Each hashing pass submits its work through its own Group. Groups with
+ * queued tasks are served round-robin, one task at a time, so concurrent
+ * batch jobs get an even share of the threads, and a thread never idles
+ * while any group has work. The pool size is the core budget: however many
+ * batch workers run, no more hashing threads than that ever exist.
+ *
+ * Tasks must not block on other tasks (a pool thread waiting on the pool can
+ * deadlock it) and should not throw; an escaping exception is logged and
+ * dropped.
+ */
+class HashExecutor
+{
+public:
+    /** @brief Tasks of one job; wait() covers only this group's tasks. */
+    class Group
+    {
+    public:
+        /// @brief Queue @p task to run on a pool thread.
+        void submit(std::function<void()> task);
+
+        /// @brief Block until every task submitted so far has finished. Not callable from a pool thread.
+        void wait();
+
+        /// @brief Waits for outstanding tasks.
+        ~Group();
+
+        Group(const Group&) = delete;
+        Group& operator=(const Group&) = delete;
+
+    private:
+        friend class HashExecutor;
+        explicit Group(HashExecutor& executor) : executor_(executor) {}
+
+        HashExecutor& executor_;
+        std::deque<std::function<void()>> tasks_;  // Guarded by executor_.mutex_
+        int outstanding_ = 0;                      // Queued plus running
+        bool listed_ = false;                      // In executor_.ready_
+        std::condition_variable done_;
+    };
+
+    /**
+     * @brief Start a pool.
+     * @param threads Hashing threads (clamped to >= 1).
+     */
+    explicit HashExecutor(int threads);
+    ~HashExecutor();
+
+    /**
+     * @brief The pool every TorrentCreator submits to, started on first use.
+     *
+     * Sized by set_default_threads() if it was called first, else by
+     * TB_HASH_THREADS, else by the hardware concurrency.
+     */
+    static HashExecutor& shared();
+
+    /**
+     * @brief Core budget for shared(); ignored (with a warning) once the pool has started.
+     * @param threads Hashing threads; <= 0 restores the default.
+     */
+    static void set_default_threads(int threads);
+
+    /// @brief Number of pool threads.
+    int threads() const { return static_cast<int>(threads_.size()); }
+
+    /// @brief New task group for one job.
+    std::unique_ptr<Group> make_group();
+
+    HashExecutor(const HashExecutor&) = delete;
+    HashExecutor& operator=(const HashExecutor&) = delete;
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<Group*> ready_;  // Groups with queued tasks, in service order
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+
+    void run();
+};
+
+#endif // HASH_EXECUTOR_HPP
@@ -0,0 +1,71 @@
+#ifndef MERKLE_HPP
+#define MERKLE_HPP
+
+#include <libtorrent/sha1_hash.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace merkle
+{
+
+/// Leaf size of every v2 hash tree (16 KiB).
+constexpr int block_size = 16 * 1024;
+
+/**
+ * @brief Number of leaves in a tree covering the given block count.
+ * @param blocks Number of 16 KiB blocks (>= 0).
+ * @return Smallest power of two >= blocks (1 for 0 or 1 blocks).
+ */
+int num_leafs(int blocks);
+
+/**
+ * @brief Root of a subtree whose leaves are all padding (zero) hashes.
+ * @param num_leafs Power-of-two leaf count.
+ */
+lt::sha256_hash pad_hash(int num_leafs);
+
+/**
+ * @brief Reduce a tree level by level to its root.
+ *
+ * Missing nodes at the bottom level are filled with @p pad; each higher level
+ * pads with the hash of two padding children. Each level goes to the hash
+ * backend in batches of sibling pairs.
+ *
+ * @param nodes Bottom-level hashes (consumed).
+ * @param width Power-of-two width of the bottom level (>= nodes.size()).
+ * @param pad Hash standing in for absent bottom-level nodes.
+ */
+lt::sha256_hash root(std::vector<lt::sha256_hash> nodes, int width,
+                     const lt::sha256_hash& pad = lt::sha256_hash());
+
+/**
+ * @brief Hash the 16 KiB leaves of a buffer and reduce them to a subtree root.
+ * @param data Piece data.
+ * @param len Bytes of real data in @p data (the last leaf may be short).
+ * @param num_leafs Power-of-two leaf count to pad to.
+ */
+lt::sha256_hash piece_root(const char* data, int len, int num_leafs);
+
+/**
+ * @brief Leaf count each piece of a file is padded to.
+ *
+ * A file that fits in one piece is its own piece, so its tree is only as
+ * wide as its blocks need; the pieces of larger files pad to a full piece.
+ *
+ * @param file_size File size in bytes.
+ * @param piece_length Torrent piece length (power of two, >= 16 KiB).
+ */
+int piece_leafs(int64_t file_size, int piece_length);
+
+/**
+ * @brief Pieces root of a file from its piece layer.
+ * @param piece_layer One subtree root per piece, in file order (consumed).
+ * @param piece_length Torrent piece length.
+ * @return The single entry for a one-piece file; all zeros for an empty layer.
+ */
+lt::sha256_hash layer_root(std::vector<lt::sha256_hash> piece_layer, int piece_length);
+
+} // namespace merkle
+
+#endif // MERKLE_HPP
@@ -0,0 +1,156 @@
+#ifndef PIECE_STREAM_HPP
+#define PIECE_STREAM_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace libtorrent
+{
+class file_storage;
+} // namespace libtorrent
+
+namespace lt = libtorrent;
+
+/**
+ * @brief One contiguous range of a piece, read from a single file.
+ *
+ * Spans of a piece are laid out back to back in the piece buffer.
+ */
+struct ReadSpan {
+    int file;        ///< Index into the stream's file list; -1 reads as zeros (pad files)
+    int64_t offset;  ///< Byte offset within the file
+    int64_t length;  ///< Number of bytes
+};
+
+/**
+ * @brief A piece buffer filled by a PieceStream.
+ *
+ * Ranges that could not be read (missing or short files, I/O errors) are
+ * zero-filled and counted in @c missing; the first error message is kept.
+ */
+struct StreamPiece {
+    int index = -1;               ///< Piece index
+    int size = 0;                 ///< Bytes of piece data in @c data
+    int64_t missing = 0;          ///< Bytes that could not be read
+    std::string error;            ///< First open/read error for this piece
+    std::vector<char> data;       ///< Piece data (capacity = stream buffer size)
+    std::atomic<int> pending{0};  ///< Free for consumers, e.g. hash families still using the buffer
+
+    /// @brief True if every byte of the piece was read.
+    bool complete() const { return missing == 0; }
+
+private:
+    friend class PieceStream;
+    int spans_left = 0;
+    int buffer_index = 0;
+};
+
+/**
+ * @brief Reads pieces ahead of the hashers with a bounded set of buffers in flight.
+ *
+ * On Linux the stream drives an io_uring instance from a single thread: every
+ * free buffer is turned into read requests (fixed buffers when the kernel
+ * allows registering them), and each completed piece is handed to the
+ * consumer callback straight from the completion loop. Where io_uring is
+ * unavailable (older kernels, seccomp-filtered containers, other platforms)
+ * a few threads read pieces synchronously through ContentReader instead.
+ * Each of those threads claims runs of consecutive pieces, hints the whole
+ * run to the kernel before reading it, and keeps its recently used files
+ * open in a small LRU, so sequential content costs no seek and one open per
+ * file.
+ *
+ * Pieces are issued in index order but may complete out of order. The
+ * consumer must release() every delivered piece to return its buffer.
+ */
+class PieceStream
+{
+public:
+    /// @brief Maps a piece to its spans; returns the piece size in bytes.
+    using Layout = std::function<int(int piece, std::vector<ReadSpan>& spans)>;
+
+    /**
+     * @brief Create a stream over an arbitrary piece layout.
+     * @param files Paths indexed by ReadSpan::file.
+     * @param num_pieces Number of pieces to deliver.
+     * @param layout Piece-to-span mapping.
+     * @param buffer_size Bytes per buffer (>= largest piece).
+     * @param buffer_count Pieces that may be in flight or held by consumers at once (>= 1).
+     */
+    PieceStream(std::vector<std::filesystem::path> files, int num_pieces, Layout layout,
+                int buffer_size, int buffer_count);
+    ~PieceStream();
+
+    /**
+     * @brief Create a stream over the pieces of a torrent's file storage.
+     * @param files Storage whose pieces are read (pad files read as zeros); must outlive the stream.
+     * @param save_path Directory the storage paths are relative to.
+     * @param buffer_count Pieces in flight (>= 1).
+     * @param pieces Pieces to read, in order (empty = all). StreamPiece::index is
+     *        then the position in this list, not the piece index.
+     */
+    static std::unique_ptr<PieceStream> for_storage(const lt::file_storage& files,
+                                                    const std::string& save_path,
+                                                    int buffer_count,
+                                                    std::vector<int> pieces = {});
+
+    /// @brief Whether this process can use io_uring (probed once, cached).
+    static bool async_available();
+
+    /// @brief Force the synchronous reader path (TB_NO_IO_URING=1 does this process-wide).
+    void disable_async() { allow_async_ = false; }
+
+    /// @brief Whether the last run() used io_uring.
+    bool used_async() const { return used_async_; }
+
+    /// @brief Most reads the last run() had queued on io_uring at once (0 for synchronous reads).
+    int peak_inflight() const { return peak_inflight_; }
+
+    /**
+     * @brief Read every piece, calling @p on_ready for each completed piece.
+     *
+     * Blocks until all pieces have been delivered or @p cancel is set; no
+     * read is in flight when it returns. @p on_ready runs on a stream thread
+     * and must not block on the stream itself.
+     *
+     * @param on_ready Consumer callback; takes ownership until release().
+     * @param cancel Stops issuing new reads when set.
+     * @param sync_readers Threads used by the synchronous fallback.
+     * @throws std::runtime_error if the io_uring ring fails; every read it
+     *         still held has failed or finished by then.
+     */
+    void run(const std::function<void(StreamPiece*)>& on_ready, const std::atomic<bool>& cancel,
+             int sync_readers = 2);
+
+    /// @brief Return a delivered piece's buffer to the stream.
+    void release(StreamPiece* piece);
+
+    PieceStream(const PieceStream&) = delete;
+    PieceStream& operator=(const PieceStream&) = delete;
+
+private:
+    std::vector<std::filesystem::path> files_;
+    int num_pieces_;
+    Layout layout_;
+    std::vector<std::unique_ptr<StreamPiece>> buffers_;
+    std::vector<StreamPiece*> free_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool allow_async_ = true;
+    bool used_async_ = false;
+    int peak_inflight_ = 0;
+
+    StreamPiece* acquire(const std::atomic<bool>& cancel, bool wait);
+    void prepare(StreamPiece* piece, int index, std::vector<ReadSpan>& spans);
+    void run_sync(const std::function<void(StreamPiece*)>& on_ready, const std::atomic<bool>& cancel,
+                  int readers);
+    bool run_async(const std::function<void(StreamPiece*)>& on_ready, const std::atomic<bool>& cancel);
+};
+
+#endif // PIECE_STREAM_HPP
@@ -7,6 +7,8 @@
 #include <filesystem>
 #include <utility>
 
+class ContentIndex;
+
 /**
  * @brief Result of season pack analysis for a directory.
  *
@@ -42,6 +44,17 @@ namespace season_pack
  */
 SeasonPackInfo analyze(const std::filesystem::path &input_path);
 
+/**
+ * @brief Analyze the files of an existing ContentIndex for season pack completeness.
+ *
+ * Same detection as analyze(path), without walking the directory again. Only
+ * files the index kept (after include/exclude patterns) are considered.
+ *
+ * @param index Snapshot of the content; file roots return is_season_pack=false.
+ * @return SeasonPackInfo with detection results.
+ */
+SeasonPackInfo analyze(const ContentIndex &index);
+
 /**
  * @brief Extract season number from a path string using naming conventions.
  *
@@ -104,13 +117,15 @@ std::string format_missing_episodes(const std::vector<int> &missing);
  * @param input_path Path to analyze.
  * @param fail_on_warning Whether the feature is enabled.
  * @param job_index Batch job index for log prefix (-1 = no prefix, for CLI).
+ * @param index Pre-scanned content of @p input_path (nullptr scans it here).
  * @return std::nullopt if safe to proceed, or an error message string if the
  *         season pack has missing episodes and should be rejected.
  */
 std::optional<std::string> evaluate_season_warning(
     const std::filesystem::path &input_path,
     bool fail_on_warning,
-    int job_index = -1);
+    int job_index = -1,
+    const ContentIndex *index = nullptr);
 
 }
 
@@ -0,0 +1,58 @@
+#ifndef THROUGHPUT_MODEL_HPP
+#define THROUGHPUT_MODEL_HPP
+
+#include "device_scheduler.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Per-device hashing throughput learned from earlier batch runs.
+ *
+ * Each job that hashed content records the rate it read and hashed at on its
+ * device (bytes read over hashing time) as a moving average, both under the device's name and under its class ("hdd" or
+ * "ssd"). Estimates use the device's own rate, else its class rate, else a
+ * built-in default. Rates persist in a small text file next to the piece
+ * hash cache; a missing or unreadable file only means default estimates.
+ */
+class ThroughputModel
+{
+public:
+    static constexpr double kDefaultHddBytesPerSecond = 150.0 * 1024 * 1024;
+    static constexpr double kDefaultSsdBytesPerSecond = 800.0 * 1024 * 1024;
+
+    /**
+     * @brief Load rates from @p path.
+     * @param path Rates file; empty keeps the model in memory only.
+     */
+    explicit ThroughputModel(std::filesystem::path path = {});
+
+    /// @brief $XDG_CACHE_HOME/torrent-builder/throughput.txt (or ~/.cache/...).
+    static std::filesystem::path default_path();
+
+    /// @brief Predicted seconds to hash @p bytes stored on @p device.
+    double estimate_seconds(const StorageDevice& device, int64_t bytes) const;
+
+    /**
+     * @brief Fold one job's measured rate into the model.
+     *
+     * Measurements shorter than a second are too noisy and are ignored.
+     */
+    void record(const StorageDevice& device, int64_t bytes, double seconds);
+
+    /// @brief Write the rates back to the file given at construction; failures are logged.
+    void save() const;
+
+private:
+    std::filesystem::path path_;
+    mutable std::mutex mutex_;
+    std::map<std::string, double> rates_;  // Bytes per second by device name or class
+
+    static std::string device_key(const StorageDevice& device);
+    static std::string class_key(const StorageDevice& device);
+};
+
+#endif // THROUGHPUT_MODEL_HPP
@@ -6,8 +6,8 @@
 #include <optional>
 #include <memory>
 #include <filesystem>
-#include <unordered_map>
-#include <fstream>
+
+#include <libtorrent/sha1_hash.hpp>
 
 namespace fs = std::filesystem;
 
@@ -82,8 +82,14 @@ struct CheckResult
  * @brief Verify local files against a .torrent file.
  *
  * Loads a .torrent file, checks for missing files, verifies piece hashes
- * (v1 SHA-1, v2 SHA-256, or both for hybrid torrents), and detects extra
+ * (v1 SHA-1, or v2 SHA-256 merkle trees for v2 and hybrid torrents), and detects extra
  * files not referenced by the torrent.
+ *
+ * Pieces are read ahead by a PieceStream and verified in parallel on the
+ * shared HashExecutor; verdicts are merged in piece order, so the result
+ * does not depend on how reads and hashes interleaved. Torrents with v2
+ * hashes, hybrids included, are verified per file against the BEP 52 hash
+ * trees (16 KiB leaves up to the piece layer and the pieces root).
  */
 class TorrentChecker
 {
@@ -121,22 +127,11 @@ class TorrentChecker
     fs::path torrent_path_;
     std::vector<char> raw_buffer_;
     std::unique_ptr<lt::torrent_info> torrent_info_;
-    std::vector<char> piece_buffer_;
-    std::unordered_map<std::string, std::ifstream> open_files_;
 
     void load_torrent();
-    void close_all_files();
-    std::ifstream &get_file_stream(const fs::path &file_path);
-
-    int find_file_for_piece(int64_t piece_offset, int64_t piece_end) const;
-
-    void read_piece_data(int piece_index, const int piece_length,
-                         const int64_t total_size,
-                         const lt::torrent_info &info,
-                         const fs::path &base_path);
 
-    bool verify_piece_v1(int piece_index) const;
-    bool verify_piece_v2(int piece_index, const lt::torrent_info &info) const;
+    bool verify_piece_v1(int piece_index, const lt::sha1_hash &computed) const;
+    void verify_files_v2(const std::vector<lt::sha256_hash> &piece_roots, std::vector<char> &corrupt) const;
 
     std::vector<CheckResult::CorruptedPiece> verify_all_pieces(const fs::path &base_path,
                                                                 bool verbose);
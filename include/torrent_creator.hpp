@@ -8,21 +8,27 @@
 #include <libtorrent/bencode.hpp>
 #include <libtorrent/error_code.hpp>
 
+#include "content_index.hpp"
+#include "path_filter.hpp"
 #include "logger.hpp"
 #include "terminal.hpp"
 #include <atomic>
+#include <memory>
 #include <thread>
 #include <mutex>
 #include <string>
 #include <vector>
 #include <optional>
 #include <iostream>
+#include <ctime>
 #include <filesystem>
 #include <fstream>
-#include <regex>
+#include <functional>
 
 namespace fs = std::filesystem;
 
+class HashCache;
+
 extern const std::vector<std::string> default_trackers;
 
 enum class TorrentVersion {
@@ -46,9 +52,11 @@ struct TorrentConfig {
     bool include_creation_date = true;
     std::optional<std::string> source;            // Cross-seeding identity (sets info.source)
     bool entropy;                                 // Randomize info hash per invocation
-    std::vector<std::regex> exclude_regex;        // Pre-compiled exclude patterns
-    std::vector<std::regex> include_regex;        // Pre-compiled include patterns (overrides exclude)
+    PathFilter filter;                            // Compiled exclude/include globs (include overrides exclude)
     bool silent;                                   // Suppress progress output (batch mode)
+    int64_t hash_memory = 0;                       // Read-buffer budget for hashing in bytes (0 = HashMemory::kDefaultBytes)
+    std::shared_ptr<const ContentIndex> content_index; // Files scanned with this config's patterns (scanned on demand if null)
+    std::shared_ptr<HashCache> hash_cache;         // Persistent piece hashes to reuse and extend (null = hash everything)
 
     /**
      * @brief Construct a torrent configuration with all creation parameters.
@@ -65,8 +73,7 @@ struct TorrentConfig {
      * @param include_creation_date Whether to embed the current timestamp.
      * @param source Source string for cross-seeding (sets info.source).
      * @param entropy Add random entropy field for unique info hash.
-     * @param exclude_re Pre-compiled regex patterns for file exclusion.
-     * @param include_re Pre-compiled regex patterns for file inclusion (overrides exclude).
+     * @param filter Compiled exclude (built-ins already applied) and include globs.
      * @param tpc Optional target piece count (for display; piece_size holds resolved value).
      * @throws std::filesystem::filesystem_error if the path does not exist.
      */
@@ -78,8 +85,7 @@ struct TorrentConfig {
                  bool include_creation_date = true,
                  std::optional<std::string> source = std::nullopt,
                  bool entropy = false,
-                 std::vector<std::regex> exclude_re = {},
-                 std::vector<std::regex> include_re = {},
+                 PathFilter filter = {},
                  bool silent = false,
                  std::optional<int> tpc = std::nullopt)
         : path(p), output(o), trackers(t), version(v),
@@ -87,8 +93,7 @@ struct TorrentConfig {
           target_piece_count(tpc),
           creator(creator), name(name_val), include_creation_date(include_creation_date),
           source(source), entropy(entropy),
-          exclude_regex(std::move(exclude_re)),
-          include_regex(std::move(include_re)),
+          filter(std::move(filter)),
           silent(silent)
     {
         // Validate that the provided path exists
@@ -99,6 +104,20 @@ struct TorrentConfig {
     }
 };
 
+/** @brief Where a TorrentCreator's time went, summed over its hashing passes. */
+struct CreationStats {
+    double hash_seconds = 0;     ///< Reading content and hashing pieces
+    double write_seconds = 0;    ///< Generating, bencoding and saving the .torrent files
+    int64_t bytes_read = 0;      ///< Content bytes read (pieces reused from the hash cache are not read)
+
+    CreationStats& operator+=(const CreationStats& other) {
+        hash_seconds += other.hash_seconds;
+        write_seconds += other.write_seconds;
+        bytes_read += other.bytes_read;
+        return *this;
+    }
+};
+
 class TorrentCreator {
 public:
     /**
@@ -110,13 +129,45 @@ public:
     /**
      * @brief Create and save a .torrent file according to the configuration.
      *
-     * Orchestrates file scanning, piece hashing (single-threaded or parallel
-     * based on file size), metadata assembly, and disk write.
+     * Orchestrates file scanning, piece hashing (a bounded reader→hasher
+     * pipeline whose buffers fit in TorrentConfig::hash_memory), metadata
+     * assembly, and disk write.
      *
      * @throws std::runtime_error on hashing, I/O, or configuration errors.
      * @throws UserInterrupt if the user presses 'q' or hashing times out.
      */
     void create_torrent();
+
+    /**
+     * @brief Also write @p config's torrent from the same hashing pass.
+     *
+     * The extra output keeps its own trackers, web seeds, comment, private
+     * flag, name, source, entropy, creator and date; its content, filter and
+     * version must match the primary configuration. Its piece size must
+     * resolve to the same value unless the torrents are v1: then each
+     * distinct power-of-two size is hashed from the same read, so extra
+     * sizes cost CPU but no I/O (checked by create_torrent()).
+     *
+     * @throws std::invalid_argument if the content or version differs.
+     */
+    void add_output(TorrentConfig config);
+
+    /**
+     * @brief Create every configuration, hashing each distinct layout once.
+     *
+     * Configurations that share content, filter, version and (resolved) piece
+     * size form one group: one TorrentCreator hashes it and writes all of its
+     * outputs. v1 configurations ignore the piece size, since one read feeds
+     * every size. Groups are created in order of their first member.
+     *
+     * @return Hashing and writing time and bytes read, summed over the groups.
+     * @throws std::runtime_error or UserInterrupt as create_torrent().
+     */
+    static CreationStats create_torrents(std::vector<TorrentConfig> configs);
+
+    /// @brief Time and bytes of the last create_torrent() (partial if it threw).
+    const CreationStats& stats() const { return stats_; }
+
     /**
      * @brief Get libtorrent creation flags for a given torrent version.
      * @param version V1 → v1_only, V2 → v2_only, HYBRID → no flags (both v1+v2).
@@ -125,16 +176,17 @@ public:
 
 private:
     TorrentConfig config_;
+    std::vector<TorrentConfig> extra_outputs_;  // Written from config_'s hashing pass
     lt::file_storage fs_;
-    std::mutex progress_mutex_;   // Guards total_processed_ across worker threads
-    int64_t total_processed_ = 0;
+    CreationStats stats_;
 
     void add_files_to_storage();
-    void print_torrent_summary(int64_t total_size, int piece_size, int num_pieces) const;
+    void write_output(const TorrentConfig& config, lt::entry e, std::time_t creation_date) const;
+    void print_torrent_summary(const TorrentConfig& config, int64_t total_size, int piece_size, int num_pieces) const;
     void print_progress_bar(int progress, int total, double speed, double eta, int64_t processed, int64_t total_size) const;
-    void hash_large_file(const fs::path& path, lt::create_torrent& t, int piece_size, TerminalGuard& guard);
-    void hash_large_file_parallel(const fs::path& path, lt::create_torrent& t, int piece_size, TerminalGuard& guard);
-    void hash_block(const fs::path& path, lt::create_torrent& t, int piece_size, int64_t start_offset, int64_t end_offset, std::mutex& mutex, std::atomic<bool>& cancel);
+    void hash_storage_parallel(const std::vector<lt::create_torrent*>& torrents, TerminalGuard& guard);
+    void hash_with_monitor(const lt::create_torrent& t, TerminalGuard& guard,
+                           const std::function<void(std::atomic<int64_t>&, std::atomic<bool>&)>& job);
 };
 
 #endif // CREATE_TORRENT_HPP
@@ -63,6 +63,7 @@ int piece_size_for_target_count(int64_t total_size, int target_piece_count);
  *
  * For a single file, returns its size. For a directory, recursively sums all
  * regular file sizes. Returns 0 on error or if the path does not exist.
+ * Jobs that already hold a ContentIndex should use its total_size() instead.
  *
  * @param path File or directory path.
  * @return Total content size in bytes.
@@ -250,6 +251,9 @@ std::regex glob_to_regex(const std::string &pattern);
 /**
  * @brief Determine whether a file should be included based on exclude/include patterns.
  *
+ * Reference implementation with one std::regex_match per pattern; the
+ * scanning code uses PathFilter, which makes the same decisions in one pass.
+ *
  * Decision logic (evaluated in order):
  *   1. If both lists are empty, include the file.
  *   2. If include patterns exist and the file matches any, include.
@@ -305,6 +309,17 @@ const std::vector<std::string>& builtin_exclude_patterns();
 std::vector<std::regex> apply_builtin_excludes(const std::vector<std::regex>& user_excludes,
                                                 bool enabled);
 
+/**
+ * @brief Prepend built-in exclude globs to a list of user exclude globs.
+ *
+ * Glob-string counterpart of apply_builtin_excludes(), for building a PathFilter.
+ *
+ * @param user_globs User-supplied exclude glob patterns (kept as-is).
+ * @param enabled Whether to prepend the built-in patterns.
+ * @return Built-ins first, then user globs, when enabled; otherwise user_globs unchanged.
+ */
+std::vector<std::string> with_builtin_excludes(const std::vector<std::string>& user_globs, bool enabled);
+
 /**
  * @brief Generate 32 random bytes as a 64-char lowercase hex string.
  * @return 64-character hex string suitable for use as torrent info entropy field.
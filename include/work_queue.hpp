@@ -0,0 +1,95 @@
+#ifndef WORK_QUEUE_HPP
+#define WORK_QUEUE_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/**
+ * @brief Unbounded multi-producer, multi-consumer queue.
+ *
+ * pop() blocks until an item arrives or the queue is closed and drained,
+ * which lets a pool of workers run until producers signal the end.
+ */
+template <typename T>
+class WorkQueue
+{
+public:
+    void push(T item)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            items_.push_back(std::move(item));
+        }
+        cv_.notify_one();
+    }
+
+    /// @brief Next item, or std::nullopt once the queue is closed and empty.
+    std::optional<T> pop()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !items_.empty() || closed_; });
+        if (items_.empty()) return std::nullopt;
+        T item = std::move(items_.front());
+        items_.pop_front();
+        return item;
+    }
+
+    /**
+     * @brief Wait for at least one item, then take up to @p max of them.
+     * @return False once the queue is closed and empty.
+     */
+    bool pop_batch(std::vector<T>& out, size_t max)
+    {
+        out.clear();
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !items_.empty() || closed_; });
+        while (!items_.empty() && out.size() < max) {
+            out.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        return !out.empty();
+    }
+
+    /**
+     * @brief Take up to @p max items without waiting.
+     * @return False if the queue was empty.
+     */
+    bool try_pop_batch(std::vector<T>& out, size_t max)
+    {
+        out.clear();
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!items_.empty() && out.size() < max) {
+            out.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        return !out.empty();
+    }
+
+    /// @brief Number of items waiting to be taken.
+    size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return items_.size();
+    }
+
+    /// @brief Stop accepting waits; consumers drain remaining items, then pop() returns nullopt.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<T> items_;
+    bool closed_ = false;
+};
+
+#endif // WORK_QUEUE_HPP
@@ -5,13 +5,26 @@
 #include "utils.hpp"
 #include "constants.hpp"
 #include "season_pack.hpp"
+#include "config_cache.hpp"
+#include "content_index.hpp"
+#include "hash_backend.hpp"
+#include "device_scheduler.hpp"
+#include "hash_cache.hpp"
+#include "hash_executor.hpp"
+#include "throughput_model.hpp"
 #include <yaml-cpp/yaml.h>
+#include <algorithm>
 #include <thread>
 #include <atomic>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <cctype>
 #include <cmath>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <string_view>
 
 namespace
 {
@@ -48,22 +61,116 @@ TorrentVersion resolve_version(int v)
     }
 }
 
-std::vector<std::regex> compile_patterns(const std::optional<std::vector<std::string>>& patterns)
+double seconds_since(std::chrono::steady_clock::time_point start)
 {
-    std::vector<std::regex> compiled;
-    if (patterns) {
-        for (const auto& p : *patterns) {
-            try {
-                compiled.push_back(utils::glob_to_regex(p));
-            } catch (const std::regex_error&) {
-                throw std::runtime_error("Invalid pattern: " + p);
-            }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Files walked per job to order the batch; past this a tree's partial size
+// already ranks it among the largest jobs.
+constexpr int64_t estimate_max_files = 20000;
+
+// Size used to order jobs before any of them is scanned with its own
+// patterns: every file below the content path, unfiltered, cut short on
+// very large trees.
+int64_t estimate_content_size(const fs::path& path)
+{
+    try {
+        return ContentIndex::scan(path, {}, ScanOptions{.max_files = estimate_max_files})->total_size();
+    } catch (const std::exception&) {
+        return 0; // The job itself reports a missing path
+    }
+}
+
+std::string to_hex(const lt::sha256_hash& hash)
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string out;
+    for (unsigned char byte : hash) {
+        out += digits[byte >> 4];
+        out += digits[byte & 0xf];
+    }
+    return out;
+}
+
+// Length-prefixed fields, so adjacent values cannot run into each other
+class Fingerprint
+{
+public:
+    Fingerprint& add(std::string_view field)
+    {
+        text_ += std::to_string(field.size());
+        text_ += ':';
+        text_ += field;
+        return *this;
+    }
+
+    Fingerprint& add(const std::optional<std::string>& field)
+    {
+        return field ? add(std::string_view("1")).add(std::string_view(*field)) : add(std::string_view("0"));
+    }
+
+    Fingerprint& add(int64_t value) { return add(std::string_view(std::to_string(value))); }
+
+    Fingerprint& add(const std::string& field) { return add(std::string_view(field)); }
+
+    std::string hex() const { return to_hex(hash_backend::sha256(text_.data(), static_cast<int64_t>(text_.size()))); }
+
+private:
+    std::string text_;
+};
+
+// Everything that shapes the written torrents: a change re-runs the job on --resume
+std::string config_hash(const std::vector<TorrentConfig>& configs)
+{
+    Fingerprint f;
+    for (const auto& c : configs) {
+        f.add(c.path.string()).add(c.output.lexically_normal().string());
+        f.add(static_cast<int64_t>(c.trackers.size()));
+        for (const auto& tracker : c.trackers) f.add(tracker);
+        f.add(static_cast<int64_t>(c.version)).add(c.comment).add(static_cast<int64_t>(c.is_private));
+        f.add(static_cast<int64_t>(c.web_seeds.size()));
+        for (const auto& seed : c.web_seeds) f.add(seed);
+        f.add(static_cast<int64_t>(c.piece_size.value_or(0))).add(c.creator).add(c.name);
+        f.add(static_cast<int64_t>(c.include_creation_date)).add(c.source).add(static_cast<int64_t>(c.entropy));
+        f.add(static_cast<int64_t>(c.filter.exclude_patterns().size()));
+        for (const auto& pattern : c.filter.exclude_patterns()) f.add(pattern);
+        f.add(static_cast<int64_t>(c.filter.include_patterns().size()));
+        for (const auto& pattern : c.filter.include_patterns()) f.add(pattern);
+    }
+    return f.hex();
+}
+
+// Path, size and mtime of every file the job's scans selected
+std::string content_fingerprint(const std::vector<TorrentConfig>& configs)
+{
+    Fingerprint f;
+    std::vector<const ContentIndex*> seen;
+    for (const auto& c : configs) {
+        const ContentIndex* index = c.content_index.get();
+        if (!index || std::ranges::find(seen, index) != seen.end()) continue;
+        seen.push_back(index);
+        f.add(index->root().string()).add(static_cast<int64_t>(index->files().size()));
+        for (const auto& file : index->files()) {
+            f.add(file.path).add(file.size).add(file.mtime_ns);
         }
     }
-    return compiled;
+    return f.hex();
 }
 
-TorrentConfig build_torrent_config(const ConfigValues& cv, const fs::path& default_output_dir)
+// Exclude (built-ins included) and include patterns of one resolved job,
+// compiled once per distinct pattern set for the whole batch.
+PathFilter compile_job_filter(const ConfigValues& cv, ResolvedConfigCache& cache)
+{
+    bool use_builtin_excludes = cv.builtin_excludes.value_or(true);
+    if (use_builtin_excludes) {
+        log_message("Applying built-in exclude patterns (set builtin_excludes: false to disable)", LogLevel::INFO);
+    }
+    return cache.filter(cv.exclude_patterns.value_or(std::vector<std::string>{}),
+                        cv.include_patterns.value_or(std::vector<std::string>{}), use_builtin_excludes);
+}
+
+TorrentConfig build_torrent_config(const ConfigValues& cv, const fs::path& default_output_dir, PathFilter filter)
 {
     fs::path input_path(cv.path.value());
     if (!fs::exists(input_path)) {
@@ -122,11 +229,6 @@ TorrentConfig build_torrent_config(const ConfigValues& cv, const fs::path& defau
         include_creation_date = *cv.creation_date;
     }
 
-    bool use_builtin_excludes = cv.builtin_excludes.value_or(true);
-    if (use_builtin_excludes) {
-        log_message("Applying built-in exclude patterns (set builtin_excludes: false to disable)", LogLevel::INFO);
-    }
-
     return TorrentConfig(
         input_path,
         output,
@@ -141,8 +243,7 @@ TorrentConfig build_torrent_config(const ConfigValues& cv, const fs::path& defau
         include_creation_date,
         cv.source,
         cv.entropy.value_or(false),
-        utils::apply_builtin_excludes(compile_patterns(cv.exclude_patterns), use_builtin_excludes),
-        compile_patterns(cv.include_patterns),
+        std::move(filter),
         false,
         cv.target_piece_count
     );
@@ -165,32 +266,118 @@ ConfigValues parse_job_node(const YAML::Node& node)
     return cv;
 }
 
+std::string with_torrent_extension(std::string out)
+{
+    if (out.size() < 8 || utils::to_lower(out.substr(out.size() - 8)) != ".torrent") {
+        out += ".torrent";
+    }
+    return out;
 }
 
-BatchProcessor::BatchProcessor(BatchConfig config)
-    : config_(std::move(config))
+// An entry of a job's `outputs` list: a preset name, a tracker URL (one
+// torrent announcing to that tracker only) or a map of preset/output/overrides.
+BatchOutput parse_output_node(const YAML::Node& node)
 {
+    BatchOutput target;
+    if (node.IsScalar()) {
+        std::string value = node.as<std::string>();
+        if (utils::is_valid_url(value)) {
+            target.values.trackers = std::vector<std::string>{std::move(value)};
+        } else {
+            target.preset = std::move(value);
+        }
+        return target;
+    }
+
+    if (node["path"]) {
+        throw std::runtime_error("Batch job outputs share the job's 'path' and cannot set their own");
+    }
+    target.values = parse_yaml_config(node);
+    if (node["preset"]) target.preset = node["preset"].as<std::string>();
+    if (node["output"]) target.output = with_torrent_extension(node["output"].as<std::string>());
+    return target;
 }
 
-BatchConfig BatchProcessor::parse(const fs::path& yaml_path)
+// Resolves target_piece_count -> piece_size before tracker rule enforcement.
+void resolve_target_piece_count(ConfigValues& resolved, int64_t content_size, const std::string& label)
 {
-    if (!fs::exists(yaml_path)) {
-        throw std::runtime_error("Batch file not found: " + yaml_path.string());
+    if (!resolved.target_piece_count || resolved.piece_size) return;
+
+    if (*resolved.target_piece_count <= 0) {
+        throw std::runtime_error(label + ": target_piece_count must be positive");
     }
 
-    static constexpr std::uintmax_t max_yaml_size = 1 * 1024 * 1024;
-    if (fs::file_size(yaml_path) > max_yaml_size) {
-        throw std::runtime_error("Batch file too large (max 1 MB): " + yaml_path.string());
+    if (content_size > 0) {
+        int resolved_bytes = utils::piece_size_for_target_count(content_size, *resolved.target_piece_count);
+        resolved.piece_size = resolved_bytes / 1024;
+        int64_t resulting_pieces = (content_size + resolved_bytes - 1) / resolved_bytes;
+        log_message(label + ": target piece count "
+            + std::to_string(*resolved.target_piece_count) + " resolved to "
+            + std::to_string(resolved_bytes / 1024) + " KB ("
+            + std::to_string(resulting_pieces) + " pieces)", LogLevel::INFO);
+    } else {
+        log_message(label + ": target_piece_count "
+            + std::to_string(*resolved.target_piece_count)
+            + " ignored: content size is 0", LogLevel::WARNING);
+        resolved.target_piece_count = std::nullopt;
     }
+}
 
-    YAML::Node root = YAML::LoadFile(yaml_path.string());
+// Applies the tracker rule matching the resolved trackers: auto-set source
+// and piece-length limits.
+void apply_tracker_rules(ConfigValues& resolved, int64_t content_size, ResolvedConfigCache& cache,
+                         const std::string& label)
+{
+    auto trackers = resolved.trackers.value_or(std::vector<std::string>{});
+    if (trackers.empty()) return;
+
+    const auto match = cache.rule(trackers);
+    const std::optional<TrackerRule>& matched_rule = *match;
+    if (!matched_rule) {
+        log_message(label + ": no matching rule found for configured trackers", LogLevel::INFO);
+        return;
+    }
 
-    if (!root["version"] || root["version"].as<int>() != 1) {
-        throw std::runtime_error("Unsupported batch file version (expected: 1)");
+    if (matched_rule->source && !resolved.source) {
+        resolved.source = *matched_rule->source;
+        log_message(label + ": rule '"
+            + matched_rule->name + "' auto-set source to '" + *resolved.source + "'", LogLevel::INFO);
     }
 
-    BatchConfig config;
+    if (matched_rule->max_piece_length || matched_rule->max_torrent_size || !matched_rule->piece_length_overrides.empty()) {
 
+        std::optional<int> current_kb;
+        if (resolved.piece_size && *resolved.piece_size > 0) {
+            current_kb = *resolved.piece_size;
+        }
+
+        auto enforcement = cache.rules().enforce(*matched_rule, content_size, current_kb);
+
+        if (enforcement.adjusted && enforcement.adjusted_piece_length) {
+            if (current_kb) {
+                std::string limit_info;
+                if (matched_rule->max_piece_length) {
+                    limit_info = "max_piece_length (" + std::to_string(*matched_rule->max_piece_length / 1024) + " KB)";
+                } else {
+                    limit_info = "rule constraint";
+                }
+                log_message(label + ": rule '"
+                    + matched_rule->name + "': user-specified piece size ("
+                    + std::to_string(*current_kb) + " KB) adjusted by " + limit_info, LogLevel::WARNING);
+            } else {
+                resolved.piece_size = *enforcement.adjusted_piece_length;
+            }
+        }
+
+        if (enforcement.constraint_violation) {
+            log_message(label + ": " + enforcement.violation_message, LogLevel::WARNING);
+        }
+    }
+}
+
+// Batch-level settings: everything in a batch file except `jobs`.
+void parse_settings(const YAML::Node& root, BatchConfig& config)
+{
     if (root["workers"]) {
         config.workers = root["workers"].as<int>();
         if (config.workers < 1) {
@@ -198,6 +385,39 @@ BatchConfig BatchProcessor::parse(const fs::path& yaml_path)
         }
     }
 
+    if (root["hash_memory_mb"]) {
+        int mb = root["hash_memory_mb"].as<int>();
+        if (mb < 1) {
+            throw std::runtime_error("hash_memory_mb must be >= 1");
+        }
+        config.hash_memory = static_cast<int64_t>(mb) * 1024 * 1024;
+    }
+
+    if (root["hash_threads"]) {
+        config.hash_threads = root["hash_threads"].as<int>();
+        if (config.hash_threads < 1) {
+            throw std::runtime_error("hash_threads must be >= 1");
+        }
+    }
+
+    if (root["hdd_readers"]) {
+        config.hdd_readers = root["hdd_readers"].as<int>();
+        if (config.hdd_readers < 1) {
+            throw std::runtime_error("hdd_readers must be >= 1");
+        }
+    }
+
+    if (root["ssd_readers"]) {
+        config.ssd_readers = root["ssd_readers"].as<int>();
+        if (config.ssd_readers < 0) {
+            throw std::runtime_error("ssd_readers must be >= 0");
+        }
+    }
+
+    if (root["hash_cache"]) {
+        config.hash_cache = root["hash_cache"].as<bool>();
+    }
+
     if (root["preset_file"]) {
         config.preset_file = root["preset_file"].as<std::string>();
     }
@@ -209,182 +429,357 @@ BatchConfig BatchProcessor::parse(const fs::path& yaml_path)
     if (root["output_dir"]) {
         config.output_dir = root["output_dir"].as<std::string>();
     }
+}
+
+BatchJob parse_job(const YAML::Node& job_node)
+{
+    BatchJob job;
+    job.values = parse_job_node(job_node);
+
+    if (!job.values.path) {
+        throw std::runtime_error("Each batch job must have a 'path' field");
+    }
+
+    if (job_node["output"]) {
+        job.output = with_torrent_extension(job_node["output"].as<std::string>());
+    }
+
+    if (job_node["outputs"]) {
+        if (!job_node["outputs"].IsSequence() || job_node["outputs"].size() == 0) {
+            throw std::runtime_error("Batch job 'outputs' must be a non-empty list");
+        }
+        if (job.output) {
+            throw std::runtime_error("Batch job cannot combine 'output' with 'outputs' (set output per entry)");
+        }
+        for (const auto& output_node : job_node["outputs"]) {
+            job.outputs.push_back(parse_output_node(output_node));
+        }
+    }
+
+    if (job_node["preset"]) {
+        job.preset = job_node["preset"].as<std::string>();
+    }
+
+    if (job_node["fail_on_season_warning"]) {
+        job.fail_on_season_warning = job_node["fail_on_season_warning"].as<bool>();
+    }
+
+    job.path = *job.values.path;
+    return job;
+}
+
+}
+
+BatchProcessor::BatchProcessor(BatchConfig config)
+    : config_(std::move(config))
+{
+}
+
+BatchConfig BatchProcessor::parse(const fs::path& yaml_path)
+{
+    if (!fs::exists(yaml_path)) {
+        throw std::runtime_error("Batch file not found: " + yaml_path.string());
+    }
+
+    static constexpr std::uintmax_t max_yaml_size = 1 * 1024 * 1024;
+    if (fs::file_size(yaml_path) > max_yaml_size) {
+        throw std::runtime_error("Batch file too large (max 1 MB; stream larger job lists as NDJSON "
+            "or multi-document YAML with --stream): " + yaml_path.string());
+    }
+
+    YAML::Node root = YAML::LoadFile(yaml_path.string());
+
+    if (!root["version"] || root["version"].as<int>() != 1) {
+        throw std::runtime_error("Unsupported batch file version (expected: 1)");
+    }
+
+    BatchConfig config;
+    parse_settings(root, config);
 
     if (!root["jobs"] || !root["jobs"].IsSequence()) {
         throw std::runtime_error("Batch file must contain a 'jobs' list");
     }
 
     for (const auto& job_node : root["jobs"]) {
-        BatchJob job;
-        job.values = parse_job_node(job_node);
+        config.jobs.push_back(parse_job(job_node));
+    }
+
+    config.journal = BatchJournal::path_for(yaml_path);
+
+    log_message("Parsed batch config: " + std::to_string(config.jobs.size())
+        + " jobs, " + std::to_string(config.workers) + " workers", LogLevel::INFO);
+
+    return config;
+}
+
+BatchJobStream::BatchJobStream(std::istream& in, Format format)
+    : in_(in), format_(format)
+{
+    auto first = read_document();
+    if (!first) return;
+
+    // Anything but a settings document is the first job, reported by next()
+    YAML::Node root;
+    try {
+        root = YAML::Load(*first);
+    } catch (const YAML::Exception&) {
+    }
+    if (!root.IsMap() || !root["version"]) {
+        pending_ = std::move(first);
+        return;
+    }
+    if (root["version"].as<int>() != 1) {
+        throw std::runtime_error("Unsupported batch file version (expected: 1)");
+    }
+    if (root["jobs"]) {
+        throw std::runtime_error("Job stream settings cannot contain 'jobs'; give each job its own document");
+    }
+    parse_settings(root, settings_);
+}
+
+BatchJobStream::BatchJobStream(std::unique_ptr<std::istream> owned, Format format)
+    : BatchJobStream(*owned, format)
+{
+    owned_ = std::move(owned);
+}
+
+std::unique_ptr<BatchJobStream> BatchJobStream::open(const std::string& path)
+{
+    if (path == "-") {
+        std::cin >> std::ws;
+        const Format format = std::cin.peek() == '{' ? Format::NDJSON : Format::YAML;
+        return std::make_unique<BatchJobStream>(std::cin, format);
+    }
+
+    auto file = std::make_unique<std::ifstream>(path);
+    if (!*file) {
+        throw std::runtime_error("Cannot open job stream: " + path);
+    }
+    std::string extension = fs::path(path).extension().string();
+    std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    const Format format = extension == ".ndjson" || extension == ".jsonl" ? Format::NDJSON : Format::YAML;
+    return std::unique_ptr<BatchJobStream>(new BatchJobStream(std::move(file), format));
+}
 
-        if (!job.values.path) {
-            throw std::runtime_error("Each batch job must have a 'path' field");
+// One document of text: the next non-blank line for NDJSON, or the lines up
+// to the next "---" (or "...") marker for YAML.
+std::optional<std::string> BatchJobStream::read_document()
+{
+    std::string line;
+    if (format_ == Format::NDJSON) {
+        while (std::getline(in_, line)) {
+            if (line.find_first_not_of(" \t\r") != std::string::npos) return line;
         }
+        return std::nullopt;
+    }
 
-        if (job_node["output"]) {
-            std::string out = job_node["output"].as<std::string>();
-            if (out.size() < 8 || utils::to_lower(out.substr(out.size() - 8)) != ".torrent") {
-                out += ".torrent";
+    std::string document = std::move(carry_);
+    carry_.clear();
+    bool content = document.find_first_not_of(" \t\r\n") != std::string::npos;
+    while (std::getline(in_, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        const bool start = line == "---" || line.starts_with("--- ");
+        if (start || line == "...") {
+            if (start && line.size() > 4) {
+                carry_ = line.substr(4) + '\n';
             }
-            job.output = std::move(out);
+            if (content) return document;
+            document = std::move(carry_);
+            carry_.clear();
+            content = document.find_first_not_of(" \t\r\n") != std::string::npos;
+            continue;
         }
-
-        if (job_node["preset"]) {
-            job.preset = job_node["preset"].as<std::string>();
+        document += line;
+        document += '\n';
+        // Comment-only documents are skipped like blank ones
+        if (!content) {
+            const size_t first = line.find_first_not_of(" \t");
+            content = first != std::string::npos && line[first] != '#';
         }
+    }
+    if (content) return document;
+    return std::nullopt;
+}
 
-        if (job_node["fail_on_season_warning"]) {
-            job.fail_on_season_warning = job_node["fail_on_season_warning"].as<bool>();
+std::optional<BatchJob> BatchJobStream::next()
+{
+    while (true) {
+        std::optional<std::string> document = std::move(pending_);
+        pending_.reset();
+        if (!document) document = read_document();
+        if (!document) return std::nullopt;
+
+        YAML::Node node;
+        try {
+            node = YAML::Load(*document);
+        } catch (const YAML::Exception& e) {
+            throw std::runtime_error("Job document " + std::to_string(++jobs_read_) + ": " + e.what());
         }
+        if (node.IsNull()) continue;
 
-        job.path = *job.values.path;
-        config.jobs.push_back(std::move(job));
+        const int number = ++jobs_read_;
+        try {
+            if (!node.IsMap()) {
+                throw std::runtime_error("not a mapping");
+            }
+            return parse_job(node);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Job document " + std::to_string(number) + ": " + e.what());
+        }
     }
-
-    log_message("Parsed batch config: " + std::to_string(config.jobs.size())
-        + " jobs, " + std::to_string(config.workers) + " workers", LogLevel::INFO);
-
-    return config;
 }
 
-BatchResult BatchProcessor::execute_job(int job_index, const PresetLoader& presets, const TrackerRulesDatabase& rules)
+// A job writes one torrent, or one per entry of its `outputs` list. Each
+// output resolves its own preset, overrides and tracker rules; outputs that
+// select the same files share one scan, and those that also agree on piece
+// size and version share one hashing pass (TorrentCreator::create_torrents).
+BatchResult BatchProcessor::execute_job(const BatchJob& job, int job_index, ResolvedConfigCache& cache,
+                                        BatchJournal* journal)
 {
-    const BatchJob& job = config_.jobs[job_index];
     BatchResult result;
     result.job_index = job_index;
     result.job_name = job.output.value_or(job.path);
     result.success = false;
 
     auto start = std::chrono::steady_clock::now();
+    BatchJournalEntry entry;
+    entry.job = job_index;
 
     try {
-        ConfigValues resolved;
-
-        if (job.preset) {
-            resolved = presets.resolve(*job.preset);
+        const std::string job_label = "Job " + std::to_string(job_index + 1);
+        std::vector<BatchOutput> targets = job.outputs;
+        if (targets.empty()) {
+            targets.push_back(BatchOutput{job.output, std::nullopt, {}});
         }
 
-        resolved = merge_config_values(resolved, job.values);
-
-        if (!resolved.path) {
-            resolved.path = job.path;
-        }
-        if (!resolved.output && job.output) {
-            resolved.output = *job.output;
+        fs::path output_dir;
+        if (config_.output_dir) {
+            output_dir = *config_.output_dir;
         }
 
-        // Validate mutual exclusivity
-        if (resolved.piece_size && resolved.target_piece_count) {
-            throw std::runtime_error("Job " + std::to_string(job_index + 1)
-                + ": piece_size and target_piece_count are mutually exclusive");
-        }
+        // Concurrent jobs split one buffer budget so memory does not scale with --workers
+        // (a streamed batch has no job list and keeps every worker busy)
+        const int concurrent = config_.jobs.empty() ? std::max(1, config_.workers)
+            : std::max(1, std::min(config_.workers, static_cast<int>(config_.jobs.size())));
+        const int64_t budget = config_.hash_memory > 0 ? config_.hash_memory : HashMemory::kDefaultBytes;
+
+        std::vector<std::shared_ptr<const ContentIndex>> scans;
+        std::vector<TorrentConfig> configs;
+        for (size_t i = 0; i < targets.size(); ++i) {
+            const BatchOutput& target = targets[i];
+            const std::string label = job.outputs.empty() ? job_label
+                : job_label + " output " + std::to_string(i + 1);
+            auto phase_start = std::chrono::steady_clock::now();
+
+            ConfigValues resolved;
+
+            const auto& preset = target.preset ? target.preset : job.preset;
+            if (preset) {
+                resolved = *cache.preset(*preset);
+            }
 
-        // Compute content size once for target resolution and/or tracker rule enforcement
-        bool need_content_size = (resolved.target_piece_count && !resolved.piece_size)
-            || !resolved.trackers.value_or(std::vector<std::string>{}).empty();
-        int64_t content_size = need_content_size
-            ? utils::compute_content_size(fs::path(*resolved.path)) : 0;
+            resolved = merge_config_values(resolved, job.values);
+            resolved = merge_config_values(resolved, target.values);
 
-        // Resolve target_piece_count -> piece_size before tracker rule enforcement
-        if (resolved.target_piece_count && !resolved.piece_size) {
-            if (*resolved.target_piece_count <= 0) {
-                throw std::runtime_error("Job " + std::to_string(job_index + 1)
-                    + ": target_piece_count must be positive");
+            if (!resolved.path) {
+                resolved.path = job.path;
+            }
+            if (!resolved.output && target.output) {
+                resolved.output = *target.output;
             }
 
-            if (content_size > 0) {
-                int resolved_bytes = utils::piece_size_for_target_count(content_size, *resolved.target_piece_count);
-                resolved.piece_size = resolved_bytes / 1024;
-                int64_t resulting_pieces = (content_size + resolved_bytes - 1) / resolved_bytes;
-                log_message("Job " + std::to_string(job_index + 1) + ": target piece count "
-                    + std::to_string(*resolved.target_piece_count) + " resolved to "
-                    + std::to_string(resolved_bytes / 1024) + " KB ("
-                    + std::to_string(resulting_pieces) + " pieces)", LogLevel::INFO);
-            } else {
-                log_message("Job " + std::to_string(job_index + 1) + ": target_piece_count "
-                    + std::to_string(*resolved.target_piece_count)
-                    + " ignored: content size is 0", LogLevel::WARNING);
-                resolved.target_piece_count = std::nullopt;
+            // Validate mutual exclusivity
+            if (resolved.piece_size && resolved.target_piece_count) {
+                throw std::runtime_error(label + ": piece_size and target_piece_count are mutually exclusive");
             }
-        }
 
-        auto trackers = resolved.trackers.value_or(std::vector<std::string>{});
-        if (!trackers.empty()) {
-            auto matched_rule = rules.find_matching_rule(trackers);
-            if (matched_rule) {
-                if (matched_rule->source && !resolved.source) {
-                    resolved.source = *matched_rule->source;
-                    log_message("Job " + std::to_string(job_index + 1) + ": rule '"
-                        + matched_rule->name + "' auto-set source to '" + *resolved.source + "'", LogLevel::INFO);
+            // Scan the content once per set of patterns: target resolution, tracker
+            // rule enforcement, the season check and the torrent's file list all read
+            // from this snapshot instead of walking the tree again.
+            const fs::path input_path(*resolved.path);
+            if (!fs::exists(input_path)) {
+                throw std::runtime_error("Path does not exist: " + input_path.string());
+            }
+            PathFilter filter = compile_job_filter(resolved, cache);
+            std::shared_ptr<const ContentIndex> content_index;
+            for (const auto& config : configs) {
+                if (config.filter == filter) {
+                    content_index = config.content_index;
+                    break;
                 }
-
-                if (matched_rule->max_piece_length || matched_rule->max_torrent_size || !matched_rule->piece_length_overrides.empty()) {
-
-                    std::optional<int> current_kb;
-                    if (resolved.piece_size && *resolved.piece_size > 0) {
-                        current_kb = *resolved.piece_size;
-                    }
-
-                    auto enforcement = rules.enforce(*matched_rule, content_size, current_kb);
-
-                    if (enforcement.adjusted && enforcement.adjusted_piece_length) {
-                        if (current_kb) {
-                            std::string limit_info;
-                            if (matched_rule->max_piece_length) {
-                                limit_info = "max_piece_length (" + std::to_string(*matched_rule->max_piece_length / 1024) + " KB)";
-                            } else {
-                                limit_info = "rule constraint";
-                            }
-                            log_message("Job " + std::to_string(job_index + 1) + ": rule '"
-                                + matched_rule->name + "': user-specified piece size ("
-                                + std::to_string(*current_kb) + " KB) adjusted by " + limit_info, LogLevel::WARNING);
-                        } else {
-                            resolved.piece_size = *enforcement.adjusted_piece_length;
-                        }
-                    }
-
-                    if (enforcement.constraint_violation) {
-                        log_message("Job " + std::to_string(job_index + 1) + ": " + enforcement.violation_message, LogLevel::WARNING);
-                    }
+            }
+            result.phases.rules += seconds_since(phase_start);
+            if (!content_index) {
+                phase_start = std::chrono::steady_clock::now();
+                content_index = ContentIndex::scan(input_path, filter);
+                result.phases.scan += seconds_since(phase_start);
+
+                phase_start = std::chrono::steady_clock::now();
+                auto season_error = season_pack::evaluate_season_warning(
+                    input_path, job.fail_on_season_warning, job_index, content_index.get());
+                result.phases.season += seconds_since(phase_start);
+                if (season_error)
+                {
+                    throw std::runtime_error(*season_error);
+                }
+            }
+            int64_t content_size = content_index->total_size();
+            if (configs.empty()) result.content_bytes = content_size;
+            phase_start = std::chrono::steady_clock::now();
+
+            resolve_target_piece_count(resolved, content_size, label);
+            apply_tracker_rules(resolved, content_size, cache, label);
+
+            TorrentConfig tc = build_torrent_config(resolved, output_dir, std::move(filter));
+            tc.content_index = std::move(content_index);
+            for (const auto& config : configs) {
+                if (config.output.lexically_normal() == tc.output.lexically_normal()) {
+                    throw std::runtime_error(label + ": output " + tc.output.string()
+                        + " is written by another output of this job");
                 }
-            } else {
-                log_message("Job " + std::to_string(job_index + 1) + ": no matching rule found for configured trackers", LogLevel::INFO);
             }
-        }
 
-        fs::path output_dir;
-        if (config_.output_dir) {
-            output_dir = *config_.output_dir;
+            tc.silent = true;
+            tc.hash_memory = budget / concurrent;
+            if (config_.hash_cache) tc.hash_cache = HashCache::shared();
+            result.outputs.push_back(tc.output.string());
+            configs.push_back(std::move(tc));
+            result.phases.rules += seconds_since(phase_start);
         }
 
-        TorrentConfig tc = build_torrent_config(resolved, output_dir);
+        entry.config_hash = config_hash(configs);
+        entry.content_fingerprint = content_fingerprint(configs);
+        entry.outputs = result.outputs;
 
-        auto season_error = season_pack::evaluate_season_warning(
-            tc.path, job.fail_on_season_warning, job_index);
-        if (season_error)
-        {
-            throw std::runtime_error(*season_error);
+        const BatchJournalEntry* done = journal && config_.resume ? journal->find(job_index) : nullptr;
+        if (done && done->success && done->config_hash == entry.config_hash
+            && done->content_fingerprint == entry.content_fingerprint
+            && std::ranges::all_of(result.outputs, [](const std::string& out) { return fs::exists(out); })) {
+            result.resumed = true;
+        } else {
+            const CreationStats stats = TorrentCreator::create_torrents(std::move(configs));
+            result.phases.hash = stats.hash_seconds;
+            result.phases.write = stats.write_seconds;
+            result.bytes_read = stats.bytes_read;
         }
 
-        tc.silent = true;
-        TorrentCreator creator(std::move(tc));
-        creator.create_torrent();
-
         result.success = true;
     } catch (const std::exception& e) {
         result.error_message = e.what();
     }
 
-    auto end = std::chrono::steady_clock::now();
-    result.elapsed_seconds = std::chrono::duration<double>(end - start).count();
+    entry.success = result.success;
+    if (journal && !result.resumed) {
+        journal->append(entry);
+    }
+
+    result.elapsed_seconds = seconds_since(start);
 
     return result;
 }
 
-std::vector<BatchResult> BatchProcessor::run()
+void BatchProcessor::load_shared_files(PresetLoader& presets, TrackerRulesDatabase& rules) const
 {
-    PresetLoader presets;
     try {
         auto preset_path = PresetLoader::find_preset_file(config_.preset_file);
         presets.load(preset_path);
@@ -392,28 +787,88 @@ std::vector<BatchResult> BatchProcessor::run()
         log_message("Preset file not available: " + std::string(e.what()), LogLevel::WARNING);
     }
 
-    TrackerRulesDatabase rules;
     try {
         auto rules_path = TrackerRulesDatabase::find_rules_file(config_.rules_file);
         rules.load(rules_path);
     } catch (const std::runtime_error& e) {
         log_message("Rules file not available: " + std::string(e.what()), LogLevel::WARNING);
     }
+}
+
+std::unique_ptr<BatchJournal> BatchProcessor::open_journal() const
+{
+    if (!config_.journal) {
+        if (config_.resume) {
+            log_message("No batch journal to resume from; running every job", LogLevel::WARNING);
+        }
+        return nullptr;
+    }
+    auto journal = std::make_unique<BatchJournal>(*config_.journal, config_.resume);
+    if (config_.resume) {
+        log_message("Resuming batch: " + std::to_string(journal->loaded()) + " journal entries in "
+            + config_.journal->string(), LogLevel::INFO);
+    }
+    return journal;
+}
+
+std::vector<BatchResult> BatchProcessor::run()
+{
+    PresetLoader presets;
+    TrackerRulesDatabase rules;
+    load_shared_files(presets, rules);
+    ResolvedConfigCache cache(presets, rules);
 
     std::vector<BatchResult> results(config_.jobs.size());
-    std::atomic<int> next_job{0};
+    std::unique_ptr<BatchJournal> journal = open_journal();
+
+    std::vector<StorageDevice> devices;
+    devices.reserve(config_.jobs.size());
+    std::vector<std::string> seen;
+    for (const auto& job : config_.jobs) {
+        devices.push_back(storage_device_for(job.path));
+        const StorageDevice& device = devices.back();
+        if (!device.id.empty() && std::ranges::find(seen, device.id) == seen.end()) {
+            seen.push_back(device.id);
+            log_message("Device " + (device.name.empty() ? device.id : device.name)
+                + (device.rotational ? " (rotational)" : " (non-rotational)"), LogLevel::INFO);
+        }
+    }
+
+    // Longest predicted job first, so a large job listed last does not keep
+    // the batch running after every other worker has finished. Each job
+    // scans its own content later, so the prediction works from a capped,
+    // unfiltered estimate.
+    ThroughputModel throughput(ThroughputModel::default_path());
+    std::vector<double> predicted(config_.jobs.size());
+    std::vector<int> order(config_.jobs.size());
+    for (size_t i = 0; i < config_.jobs.size(); ++i) {
+        predicted[i] = throughput.estimate_seconds(devices[i], estimate_content_size(config_.jobs[i].path));
+        order[i] = static_cast<int>(i);
+    }
+    std::ranges::stable_sort(order, [&](int a, int b) { return predicted[a] > predicted[b]; });
+    DeviceScheduler scheduler(devices, config_.hdd_readers, config_.ssd_readers, order);
 
     auto worker = [&]() {
         while (true) {
-            int idx = next_job.fetch_add(1);
-            if (idx >= static_cast<int>(config_.jobs.size())) break;
+            std::optional<int> next = scheduler.acquire();
+            if (!next) break;
+            const int idx = *next;
 
             log_message("Job " + std::to_string(idx + 1) + " started: "
                 + sanitize_for_terminal(config_.jobs[idx].path), LogLevel::INFO);
 
-            results[idx] = execute_job(idx, presets, rules);
+            results[idx] = execute_job(config_.jobs[idx], idx, cache, journal.get());
+            scheduler.release(idx);
+            results[idx].predicted_seconds = predicted[idx];
+            // Calibrate on what was actually read and hashed: scans, writes
+            // and pieces served by the hash cache say nothing about the disk
+            if (results[idx].success && results[idx].bytes_read > 0) {
+                throughput.record(devices[idx], results[idx].bytes_read, results[idx].phases.hash);
+            }
 
-            if (results[idx].success) {
+            if (results[idx].resumed) {
+                log_message("Job " + std::to_string(idx + 1) + " already done, skipped", LogLevel::INFO);
+            } else if (results[idx].success) {
                 log_message("Job " + std::to_string(idx + 1) + " completed ("
                     + std::to_string(results[idx].elapsed_seconds) + "s)", LogLevel::INFO);
             } else {
@@ -423,6 +878,10 @@ std::vector<BatchResult> BatchProcessor::run()
         }
     };
 
+    if (config_.hash_threads > 0) {
+        HashExecutor::set_default_threads(config_.hash_threads);
+    }
+
     int actual_workers = std::min(config_.workers, static_cast<int>(config_.jobs.size()));
     const int max_workers = static_cast<int>(std::thread::hardware_concurrency()) * 2;
     if (actual_workers > max_workers && max_workers > 0) {
@@ -440,10 +899,105 @@ std::vector<BatchResult> BatchProcessor::run()
     for (auto& t : threads) {
         t.join();
     }
+    log_message("Shared job setup: " + std::to_string(cache.hits()) + " reused, "
+        + std::to_string(cache.misses()) + " computed", LogLevel::INFO);
+    throughput.save();
 
     return results;
 }
 
+// Workers take turns reading the next document from the source, so parsing
+// keeps just ahead of hashing and only the jobs being run are in memory.
+BatchStreamSummary BatchProcessor::run_stream(BatchJobStream& source,
+                                              const std::function<void(const BatchResult&)>& on_result)
+{
+    PresetLoader presets;
+    TrackerRulesDatabase rules;
+    load_shared_files(presets, rules);
+    ResolvedConfigCache cache(presets, rules);
+    std::unique_ptr<BatchJournal> journal = open_journal();
+
+    if (config_.hash_threads > 0) {
+        HashExecutor::set_default_threads(config_.hash_threads);
+    }
+
+    BatchStreamSummary summary;
+    std::mutex source_mutex;
+    std::mutex result_mutex;
+    bool source_done = false;
+
+    auto worker = [&]() {
+        while (true) {
+            std::optional<BatchJob> job;
+            BatchResult result;
+            int idx = 0;
+            {
+                std::lock_guard<std::mutex> lock(source_mutex);
+                if (source_done) break;
+                idx = source.jobs_read();
+                try {
+                    job = source.next();
+                    if (!job) source_done = true;
+                } catch (const std::exception& e) {
+                    result.job_index = idx;
+                    result.job_name = "Job " + std::to_string(idx + 1);
+                    result.success = false;
+                    result.error_message = e.what();
+                    result.elapsed_seconds = 0;
+                }
+            }
+            // A document that is not a valid job fails on its own; the stream goes on
+            if (!job && result.error_message.empty()) break;
+
+            if (job) {
+                log_message("Job " + std::to_string(idx + 1) + " started: "
+                    + sanitize_for_terminal(job->path), LogLevel::INFO);
+                result = execute_job(*job, idx, cache, journal.get());
+            }
+
+            if (result.resumed) {
+                log_message("Job " + std::to_string(idx + 1) + " already done, skipped", LogLevel::INFO);
+            } else if (result.success) {
+                log_message("Job " + std::to_string(idx + 1) + " completed ("
+                    + std::to_string(result.elapsed_seconds) + "s)", LogLevel::INFO);
+            } else {
+                log_message("Job " + std::to_string(idx + 1) + " failed: "
+                    + sanitize_for_terminal(result.error_message), LogLevel::ERR);
+            }
+
+            std::lock_guard<std::mutex> lock(result_mutex);
+            if (result.success) {
+                ++summary.succeeded;
+                if (result.resumed) ++summary.resumed;
+            }
+            if (on_result) on_result(result);
+            if (!result.success) summary.failures.push_back(std::move(result));
+        }
+    };
+
+    int actual_workers = config_.workers;
+    const int max_workers = static_cast<int>(std::thread::hardware_concurrency()) * 2;
+    if (actual_workers > max_workers && max_workers > 0) {
+        actual_workers = max_workers;
+    }
+    log_message("Starting streamed batch execution: " + std::to_string(actual_workers) + " workers",
+        LogLevel::INFO);
+    std::vector<std::thread> threads;
+    threads.reserve(actual_workers);
+
+    for (int i = 0; i < actual_workers; ++i) {
+        threads.emplace_back(worker);
+    }
+
+    for (auto& t : threads) {
+        t.join();
+    }
+    log_message("Shared job setup: " + std::to_string(cache.hits()) + " reused, "
+        + std::to_string(cache.misses()) + " computed", LogLevel::INFO);
+
+    return summary;
+}
+
 void BatchProcessor::print_summary(const std::vector<BatchResult>& results)
 {
     int succeeded = 0;
@@ -460,10 +1014,21 @@ void BatchProcessor::print_summary(const std::vector<BatchResult>& results)
     for (const auto& r : results) {
         std::ostringstream time_str;
         time_str << std::fixed << std::setprecision(1) << r.elapsed_seconds << "s";
+        if (r.predicted_seconds > 0) {
+            time_str << ", predicted " << r.predicted_seconds << "s";
+        }
 
-        if (r.success) {
+        if (r.resumed) {
+            oss << "  \u2713 " << sanitize_for_terminal(r.job_name);
+            oss << "  already done (resumed)\n";
+        } else if (r.success) {
             oss << "  \u2713 " << sanitize_for_terminal(r.job_name);
             oss << "  completed (" << time_str.str() << ")\n";
+            if (r.outputs.size() > 1) {
+                for (const auto& output : r.outputs) {
+                    oss << "      " << sanitize_for_terminal(output) << "\n";
+                }
+            }
         } else {
             oss << "  \u2717 " << sanitize_for_terminal(r.job_name);
             oss << "  FAILED: " << sanitize_for_terminal(r.error_message) << "\n";
@@ -478,3 +1043,57 @@ void BatchProcessor::print_summary(const std::vector<BatchResult>& results)
     }
     log_message(oss.str(), LogLevel::INFO);
 }
+
+void BatchProcessor::print_summary(const BatchStreamSummary& summary)
+{
+    const size_t failed = summary.failures.size();
+
+    std::ostringstream oss;
+    oss << "\nBatch Summary (" << summary.succeeded + static_cast<int64_t>(failed) << " jobs):\n";
+    for (const auto& r : summary.failures) {
+        oss << "  \u2717 " << sanitize_for_terminal(r.job_name);
+        oss << "  FAILED: " << sanitize_for_terminal(r.error_message) << "\n";
+    }
+
+    oss << "\n  Succeeded: " << summary.succeeded;
+    if (summary.resumed > 0) {
+        oss << " (" << summary.resumed << " already done)";
+    }
+    oss << "    Failed: " << failed << "\n";
+
+    std::cout << oss.str();
+    if (failed > 0) {
+        log_message("Batch completed with " + std::to_string(failed) + " failed job(s)", LogLevel::ERR);
+    }
+    log_message(oss.str(), LogLevel::INFO);
+}
+
+void BatchProcessor::write_report_line(std::ostream& out, const BatchResult& r)
+{
+    const char* status = r.resumed ? "resumed" : r.success ? "ok" : "failed";
+
+    std::ostringstream line;
+    line << std::fixed << std::setprecision(3);
+    line << "{\"job\": " << r.job_index + 1
+         << ", \"name\": \"" << utils::escape_json(r.job_name) << "\""
+         << ", \"status\": \"" << status << "\"";
+    if (!r.success) {
+        line << ", \"error\": \"" << utils::escape_json(r.error_message) << "\"";
+    }
+    line << ", \"elapsed_seconds\": " << r.elapsed_seconds
+         << ", \"predicted_seconds\": " << r.predicted_seconds
+         << ", \"phases\": {\"scan\": " << r.phases.scan
+         << ", \"rules\": " << r.phases.rules
+         << ", \"season\": " << r.phases.season
+         << ", \"hash\": " << r.phases.hash
+         << ", \"write\": " << r.phases.write << "}"
+         << ", \"content_bytes\": " << r.content_bytes
+         << ", \"bytes_read\": " << r.bytes_read
+         << ", \"read_mb_per_second\": " << r.read_mb_per_second()
+         << ", \"outputs\": [";
+    for (size_t i = 0; i < r.outputs.size(); ++i) {
+        line << (i ? ", " : "") << "\"" << utils::escape_json(r.outputs[i]) << "\"";
+    }
+    line << "]}\n";
+    out << line.str();
+}
@@ -0,0 +1,204 @@
+#include "batch_journal.hpp"
+#include "logger.hpp"
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Line layout: status, job, config hash, content fingerprint, outputs...,
+// checksum; tab-separated, with tabs, newlines and backslashes escaped.
+constexpr std::string_view line_tag = "tbj1";
+
+std::string escape(const std::string& text)
+{
+    std::string out;
+    for (char c : text) {
+        switch (c) {
+        case '\\': out += "\\\\"; break;
+        case '\t': out += "\\t"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        default: out += c;
+        }
+    }
+    return out;
+}
+
+std::string unescape(const std::string& text)
+{
+    std::string out;
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] != '\\' || i + 1 == text.size()) {
+            out += text[i];
+            continue;
+        }
+        switch (text[++i]) {
+        case 't': out += '\t'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        default: out += text[i];
+        }
+    }
+    return out;
+}
+
+// FNV-1a: only has to catch torn or garbled lines, not tampering
+std::string checksum(std::string_view text)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    char buf[17];
+    std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(hash));
+    return buf;
+}
+
+std::vector<std::string> split_tabs(const std::string& line)
+{
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        const size_t tab = line.find('\t', start);
+        fields.push_back(line.substr(start, tab - start));
+        if (tab == std::string::npos) break;
+        start = tab + 1;
+    }
+    return fields;
+}
+
+bool parse_line(const std::string& line, BatchJournalEntry& entry)
+{
+    const size_t last_tab = line.rfind('\t');
+    if (last_tab == std::string::npos) return false;
+    const std::string body = line.substr(0, last_tab);
+    if (checksum(body) != line.substr(last_tab + 1)) return false;
+
+    const auto fields = split_tabs(body);
+    if (fields.size() < 5 || fields[0] != line_tag) return false;
+    if (fields[1] != "ok" && fields[1] != "fail") return false;
+    try {
+        entry.job = std::stoi(fields[2]);
+    } catch (const std::exception&) {
+        return false;
+    }
+    entry.success = fields[1] == "ok";
+    entry.config_hash = fields[3];
+    entry.content_fingerprint = fields[4];
+    entry.outputs.clear();
+    for (size_t i = 5; i < fields.size(); ++i) {
+        entry.outputs.push_back(unescape(fields[i]));
+    }
+    return true;
+}
+
+bool sync_fd(int fd)
+{
+#ifdef _WIN32
+    return _commit(fd) == 0;
+#elif defined(__APPLE__)
+    return ::fsync(fd) == 0;
+#else
+    return ::fdatasync(fd) == 0;
+#endif
+}
+
+}
+
+BatchJournal::BatchJournal(fs::path path, bool keep) : path_(std::move(path))
+{
+    if (keep) {
+        std::ifstream in(path_, std::ios::binary);
+        std::string line;
+        // A final line without its newline was torn by a crash and is skipped
+        while (std::getline(in, line) && !in.eof()) {
+            BatchJournalEntry entry;
+            if (parse_line(line, entry)) {
+                entries_[entry.job] = std::move(entry);
+                ++loaded_;
+            }
+        }
+    }
+
+#ifdef _WIN32
+    const int flags = _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY | (keep ? 0 : _O_TRUNC);
+    fd_ = _open(path_.string().c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+    const int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (keep ? 0 : O_TRUNC);
+    fd_ = ::open(path_.c_str(), flags, 0644);
+#endif
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open batch journal " + path_.string() + ": " + std::strerror(errno));
+    }
+}
+
+BatchJournal::~BatchJournal()
+{
+    if (fd_ >= 0) {
+#ifdef _WIN32
+        _close(fd_);
+#else
+        ::close(fd_);
+#endif
+    }
+}
+
+fs::path BatchJournal::path_for(const fs::path& batch_file)
+{
+    return fs::path(batch_file.string() + ".journal");
+}
+
+const BatchJournalEntry* BatchJournal::find(int job) const
+{
+    auto it = entries_.find(job);
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+void BatchJournal::append(const BatchJournalEntry& entry)
+{
+    std::string body = std::string(line_tag) + '\t' + (entry.success ? "ok" : "fail") + '\t'
+        + std::to_string(entry.job) + '\t' + escape(entry.config_hash) + '\t' + escape(entry.content_fingerprint);
+    for (const auto& output : entry.outputs) {
+        body += '\t' + escape(output);
+    }
+    const std::string line = body + '\t' + checksum(body) + '\n';
+
+    // One write per line: O_APPEND keeps concurrent workers' lines whole
+    std::lock_guard<std::mutex> lock(mutex_);
+    size_t written = 0;
+    while (written < line.size()) {
+#ifdef _WIN32
+        const int n = _write(fd_, line.data() + written, static_cast<unsigned>(line.size() - written));
+#else
+        const ssize_t n = ::write(fd_, line.data() + written, line.size() - written);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            log_message("Failed to write batch journal " + path_.string() + ": " + std::strerror(errno),
+                        LogLevel::WARNING);
+            return;
+        }
+        written += static_cast<size_t>(n);
+    }
+    if (!sync_fd(fd_)) {
+        log_message("Failed to flush batch journal " + path_.string() + ": " + std::strerror(errno),
+                    LogLevel::WARNING);
+    }
+}
@@ -0,0 +1,70 @@
+#include "config_cache.hpp"
+#include "utils.hpp"
+
+#include <mutex>
+
+namespace
+{
+
+// Length-prefixed, so no two different lists produce the same key
+void append_list(std::string& key, const std::vector<std::string>& items)
+{
+    key += std::to_string(items.size());
+    key += '|';
+    for (const auto& item : items) {
+        key += std::to_string(item.size());
+        key += ':';
+        key += item;
+    }
+}
+
+}
+
+ResolvedConfigCache::ResolvedConfigCache(const PresetLoader& presets, const TrackerRulesDatabase& rules)
+    : presets_(presets), rules_(rules)
+{
+}
+
+template <typename Map, typename Make>
+typename Map::mapped_type ResolvedConfigCache::lookup(Map& map, const std::string& key, Make make)
+{
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex_);
+        if (auto it = map.find(key); it != map.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    auto value = make();
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    return map.try_emplace(key, std::move(value)).first->second;
+}
+
+std::shared_ptr<const ConfigValues> ResolvedConfigCache::preset(const std::string& name)
+{
+    return lookup(presets_cache_, name, [&] {
+        return std::make_shared<const ConfigValues>(presets_.resolve(name));
+    });
+}
+
+PathFilter ResolvedConfigCache::filter(const std::vector<std::string>& exclude_patterns,
+                                       const std::vector<std::string>& include_patterns, bool builtin_excludes)
+{
+    std::string key = builtin_excludes ? "b" : "-";
+    append_list(key, exclude_patterns);
+    append_list(key, include_patterns);
+    return lookup(filters_, key, [&] {
+        return PathFilter(utils::with_builtin_excludes(exclude_patterns, builtin_excludes), include_patterns);
+    });
+}
+
+std::shared_ptr<const std::optional<TrackerRule>> ResolvedConfigCache::rule(const std::vector<std::string>& trackers)
+{
+    std::string key;
+    append_list(key, trackers);
+    return lookup(rules_cache_, key, [&] {
+        return std::make_shared<const std::optional<TrackerRule>>(rules_.find_matching_rule(trackers));
+    });
+}
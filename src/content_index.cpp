@@ -0,0 +1,466 @@
+#include "content_index.hpp"
+#include "logger.hpp"
+#include "work_queue.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#ifndef _WIN32
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <sys/sysmacros.h>
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+using DirId = std::pair<uint64_t, uint64_t>;  // (st_dev, st_ino)
+
+// One directory waiting to be listed. Each task carries the identities of
+// the directories above it so symlink loops are caught without a shared set.
+struct DirTask {
+    fs::path path;
+    std::string rel;
+    std::vector<DirId> ancestors;
+};
+
+// What one walker thread collected; merged once all threads are done.
+struct Partial {
+    std::vector<ContentEntry> files;
+    int files_excluded = 0;
+    int dirs_excluded = 0;
+    bool truncated = false;
+};
+
+struct Filters {
+    const PathFilter& paths;
+    bool follow_symlinks;
+};
+
+std::string join(const std::string& dir, const std::string& name)
+{
+    return dir.empty() ? name : dir + "/" + name;
+}
+
+bool prune_directory(const std::string& rel, const Filters& filters, Partial& out)
+{
+    if (!filters.paths.should_prune_directory(rel)) return false;
+    ++out.dirs_excluded;
+    return true;
+}
+
+bool keep_file(const std::string& rel, const Filters& filters, Partial& out)
+{
+    if (filters.paths.should_include_file(rel)) return true;
+    ++out.files_excluded;
+    log_message("Excluded by pattern: " + rel, LogLevel::INFO);
+    return false;
+}
+
+// Component-wise path order: '/' sorts before every other byte, so "a/b"
+// precedes "a.txt" the same way a depth-first walk of sorted directories would.
+bool path_before(const std::string& a, const std::string& b)
+{
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(),
+        [](char x, char y) {
+            const unsigned ux = x == '/' ? 0u : static_cast<unsigned char>(x);
+            const unsigned uy = y == '/' ? 0u : static_cast<unsigned char>(y);
+            return ux < uy;
+        });
+}
+
+#ifndef _WIN32
+
+enum class EntryKind { FILE, DIRECTORY, LINK, OTHER, UNKNOWN };
+
+struct RawEntry {
+    std::string name;
+    EntryKind kind;
+};
+
+EntryKind kind_from_d_type(unsigned char d_type)
+{
+    switch (d_type) {
+        case DT_REG: return EntryKind::FILE;
+        case DT_DIR: return EntryKind::DIRECTORY;
+        case DT_LNK: return EntryKind::LINK;
+        case DT_UNKNOWN: return EntryKind::UNKNOWN;
+        default: return EntryKind::OTHER;
+    }
+}
+
+EntryKind kind_from_mode(mode_t mode)
+{
+    if (S_ISREG(mode)) return EntryKind::FILE;
+    if (S_ISDIR(mode)) return EntryKind::DIRECTORY;
+    if (S_ISLNK(mode)) return EntryKind::LINK;
+    return EntryKind::OTHER;
+}
+
+bool is_dot(const char* name)
+{
+    return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+#if defined(__linux__)
+// getdents64 fills a large buffer per syscall instead of readdir's
+// libc-sized batches, which matters on network filesystems.
+bool read_entries(int fd, std::vector<RawEntry>& out)
+{
+    constexpr size_t reclen_offset = 16;  // after d_ino and d_off
+    constexpr size_t type_offset = 18;
+    constexpr size_t name_offset = 19;
+    thread_local std::vector<char> buf(256 * 1024);
+    for (;;) {
+        const long n = syscall(SYS_getdents64, fd, buf.data(), buf.size());
+        if (n < 0) return false;
+        if (n == 0) return true;
+        for (long off = 0; off < n;) {
+            const char* rec = buf.data() + off;
+            unsigned short reclen;
+            std::memcpy(&reclen, rec + reclen_offset, sizeof(reclen));
+            const char* name = rec + name_offset;
+            if (!is_dot(name)) {
+                out.push_back({name, kind_from_d_type(static_cast<unsigned char>(rec[type_offset]))});
+            }
+            off += reclen;
+        }
+    }
+}
+#else
+bool read_entries(int fd, std::vector<RawEntry>& out)
+{
+    int dup_fd = dup(fd);
+    DIR* dir = dup_fd >= 0 ? fdopendir(dup_fd) : nullptr;
+    if (!dir) {
+        if (dup_fd >= 0) close(dup_fd);
+        return false;
+    }
+    while (const dirent* d = readdir(dir)) {
+        if (!is_dot(d->d_name)) out.push_back({d->d_name, kind_from_d_type(d->d_type)});
+    }
+    closedir(dir);
+    return true;
+}
+#endif
+
+struct Meta {
+    EntryKind kind = EntryKind::OTHER;
+    int64_t size = 0;
+    uint64_t device = 0;
+    uint64_t inode = 0;
+    int64_t mtime_ns = 0;
+    bool executable = false;
+};
+
+// statx asks only for the fields the index keeps; fstatat elsewhere.
+bool stat_at(int dir_fd, const char* name, bool follow, Meta& out)
+{
+    const int flags = follow ? 0 : AT_SYMLINK_NOFOLLOW;
+#if defined(__linux__) && defined(STATX_BASIC_STATS)
+    struct statx stx;
+    if (statx(dir_fd, name, flags, STATX_TYPE | STATX_MODE | STATX_INO | STATX_SIZE | STATX_MTIME, &stx) != 0) {
+        return false;
+    }
+    out.kind = kind_from_mode(stx.stx_mode);
+    out.size = static_cast<int64_t>(stx.stx_size);
+    out.device = static_cast<uint64_t>(makedev(stx.stx_dev_major, stx.stx_dev_minor));
+    out.inode = static_cast<uint64_t>(stx.stx_ino);
+    out.mtime_ns = static_cast<int64_t>(stx.stx_mtime.tv_sec) * 1000000000 + stx.stx_mtime.tv_nsec;
+    out.executable = (stx.stx_mode & S_IXUSR) != 0;
+#else
+    struct stat st;
+    if (fstatat(dir_fd, name, &st, flags) != 0) {
+        return false;
+    }
+    out.kind = kind_from_mode(st.st_mode);
+    out.size = static_cast<int64_t>(st.st_size);
+    out.device = static_cast<uint64_t>(st.st_dev);
+    out.inode = static_cast<uint64_t>(st.st_ino);
+#if defined(__APPLE__)
+    out.mtime_ns = static_cast<int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    out.mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+    out.executable = (st.st_mode & S_IXUSR) != 0;
+#endif
+    return true;
+}
+
+ContentEntry make_entry(std::string rel, const Meta& meta, bool symlink)
+{
+    ContentEntry e;
+    e.path = std::move(rel);
+    e.size = meta.size;
+    e.device = meta.device;
+    e.inode = meta.inode;
+    e.mtime_ns = meta.mtime_ns;
+    e.executable = meta.executable;
+    e.symlink = symlink;
+    return e;
+}
+
+// Lists one directory. d_type answers the file/directory question without a
+// stat; only kept files and links are stat-ed, and excluded subdirectories
+// are pruned before they are ever opened.
+void list_directory(const DirTask& task, const Filters& filters, Partial& out, std::vector<DirTask>& subdirs)
+{
+    const int fd = open(task.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        log_message("Cannot open directory " + task.path.string() + ": " + std::strerror(errno), LogLevel::WARNING);
+        return;
+    }
+
+    // A directory that is its own ancestor was reached through a symlink loop.
+    struct stat dir_st;
+    DirId id{0, 0};
+    if (fstat(fd, &dir_st) == 0) {
+        id = {static_cast<uint64_t>(dir_st.st_dev), static_cast<uint64_t>(dir_st.st_ino)};
+        if (std::find(task.ancestors.begin(), task.ancestors.end(), id) != task.ancestors.end()) {
+            log_message("Skipping symlink loop: " + task.path.string(), LogLevel::WARNING);
+            close(fd);
+            return;
+        }
+    }
+
+    std::vector<RawEntry> entries;
+    if (!read_entries(fd, entries)) {
+        log_message("Cannot read directory " + task.path.string() + ": " + std::strerror(errno), LogLevel::WARNING);
+    }
+
+    for (auto& entry : entries) {
+        std::string rel = join(task.rel, entry.name);
+        EntryKind kind = entry.kind;
+        bool have_meta = false;
+        Meta meta;
+
+        if (kind == EntryKind::UNKNOWN) {
+            if (!stat_at(fd, entry.name.c_str(), false, meta)) {
+                log_message("Cannot stat " + (task.path / entry.name).string() + ": " + std::strerror(errno), LogLevel::WARNING);
+                continue;
+            }
+            kind = meta.kind;
+            have_meta = kind != EntryKind::LINK;
+        }
+        const bool symlink = kind == EntryKind::LINK;
+        if (symlink) {
+            // Links are followed like lt::add_files does; the target decides the type.
+            if (!filters.follow_symlinks) continue;
+            if (!stat_at(fd, entry.name.c_str(), true, meta)) {
+                log_message("Cannot stat " + (task.path / entry.name).string() + ": " + std::strerror(errno), LogLevel::WARNING);
+                continue;
+            }
+            kind = meta.kind;
+            have_meta = true;
+        }
+
+        if (kind == EntryKind::DIRECTORY) {
+            if (prune_directory(rel, filters, out)) continue;
+            DirTask sub{task.path / entry.name, std::move(rel), task.ancestors};
+            sub.ancestors.push_back(id);
+            subdirs.push_back(std::move(sub));
+        } else if (kind == EntryKind::FILE) {
+            if (!keep_file(rel, filters, out)) continue;
+            if (!have_meta && !stat_at(fd, entry.name.c_str(), true, meta)) {
+                log_message("Cannot stat " + (task.path / entry.name).string() + ": " + std::strerror(errno), LogLevel::WARNING);
+                continue;
+            }
+            out.files.push_back(make_entry(std::move(rel), meta, symlink));
+        }
+    }
+    close(fd);
+}
+
+ContentEntry stat_root_file(const fs::path& root)
+{
+    Meta meta;
+    if (!stat_at(AT_FDCWD, root.c_str(), true, meta)) {
+        throw std::runtime_error("Cannot stat " + root.string() + ": " + std::strerror(errno));
+    }
+    std::error_code ec;
+    return make_entry("", meta, fs::is_symlink(root, ec));
+}
+
+#else
+
+int64_t mtime_ns(const fs::file_time_type& t)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::clock_cast<std::chrono::system_clock>(t).time_since_epoch()).count();
+}
+
+void list_directory(const DirTask& task, const Filters& filters, Partial& out, std::vector<DirTask>& subdirs)
+{
+    std::error_code ec;
+    for (fs::directory_iterator it(task.path, ec), end; !ec && it != end; it.increment(ec)) {
+        const fs::directory_entry& child = *it;
+        std::error_code entry_ec;
+        const bool symlink = child.is_symlink(entry_ec);
+        if (symlink && !filters.follow_symlinks) continue;
+        std::string rel = join(task.rel, child.path().filename().generic_string());
+        if (child.is_directory(entry_ec)) {
+            if (prune_directory(rel, filters, out)) continue;
+            subdirs.push_back({child.path(), std::move(rel), {}});
+        } else if (child.is_regular_file(entry_ec)) {
+            if (!keep_file(rel, filters, out)) continue;
+            ContentEntry e;
+            e.path = std::move(rel);
+            e.size = static_cast<int64_t>(child.file_size(entry_ec));
+            e.mtime_ns = mtime_ns(child.last_write_time(entry_ec));
+            e.symlink = symlink;
+            if (entry_ec) {
+                log_message("Cannot stat " + child.path().string() + ": " + entry_ec.message(), LogLevel::WARNING);
+                continue;
+            }
+            out.files.push_back(std::move(e));
+        }
+    }
+    if (ec) {
+        log_message("Cannot read directory " + task.path.string() + ": " + ec.message(), LogLevel::WARNING);
+    }
+}
+
+ContentEntry stat_root_file(const fs::path& root)
+{
+    ContentEntry e;
+    e.size = static_cast<int64_t>(fs::file_size(root));
+    e.mtime_ns = mtime_ns(fs::last_write_time(root));
+    return e;
+}
+
+#endif
+
+// Walks the tree with a pool of threads pulling directories from a shared
+// queue, so sibling subtrees are listed and stat-ed concurrently. The calling
+// thread starts alone; a walker that leaves directories queued behind it adds
+// one more, up to `threads`, so flat and small trees never start a thread.
+// Past `max_files` (when positive) queued directories are drained unlisted.
+// The queue closes once the last outstanding directory has been taken.
+Partial walk_parallel(const fs::path& root, const Filters& filters, int threads, int64_t max_files)
+{
+    WorkQueue<DirTask> queue;
+    std::atomic<int64_t> outstanding{1};
+    std::atomic<int64_t> listed{0};
+    std::atomic<bool> truncated{false};
+    queue.push({root, "", {}});
+
+    std::mutex merge_mutex;
+    Partial merged;
+
+    std::mutex pool_mutex;
+    std::vector<std::thread> pool;
+    std::function<void()> worker;
+    auto grow = [&]() {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        if (static_cast<int>(pool.size()) + 1 < threads) {
+            pool.emplace_back(worker);
+        }
+    };
+
+    worker = [&]() {
+        Partial local;
+        std::vector<DirTask> subdirs;
+        while (auto task = queue.pop()) {
+            subdirs.clear();
+            if (max_files > 0 && listed.load() >= max_files) {
+                truncated.store(true);
+            } else {
+                const size_t before = local.files.size();
+                list_directory(*task, filters, local, subdirs);
+                listed.fetch_add(static_cast<int64_t>(local.files.size() - before));
+            }
+            outstanding.fetch_add(static_cast<int64_t>(subdirs.size()));
+            for (auto& sub : subdirs) {
+                queue.push(std::move(sub));
+            }
+            if (queue.size() > 1) {
+                grow();
+            }
+            if (outstanding.fetch_sub(1) == 1) {
+                queue.close();
+            }
+        }
+        std::lock_guard<std::mutex> lock(merge_mutex);
+        merged.files.insert(merged.files.end(),
+                            std::make_move_iterator(local.files.begin()),
+                            std::make_move_iterator(local.files.end()));
+        merged.files_excluded += local.files_excluded;
+        merged.dirs_excluded += local.dirs_excluded;
+    };
+
+    worker();
+    // The queue only closes after every walker's last grow(), so the pool is final
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    for (auto& t : pool) {
+        t.join();
+    }
+
+    std::sort(merged.files.begin(), merged.files.end(),
+              [](const ContentEntry& a, const ContentEntry& b) { return path_before(a.path, b.path); });
+    merged.truncated = truncated.load();
+    return merged;
+}
+
+int scan_threads(int requested)
+{
+    if (requested > 0) return requested;
+    // Listing directories is latency-bound (network filesystems especially),
+    // so more threads than cores still pay off; past 16 the server is the limit.
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    return std::clamp(cores * 2, 2, 16);
+}
+
+}
+
+std::shared_ptr<const ContentIndex> ContentIndex::scan(const fs::path& root,
+                                                      const PathFilter& filter,
+                                                      const ScanOptions& options)
+{
+    auto index = std::make_shared<ContentIndex>();
+    index->root_ = root;
+
+    std::error_code ec;
+    const auto status = fs::status(root, ec);
+    if (ec || !fs::exists(status)) {
+        throw std::runtime_error("Cannot scan " + root.string() + ": path does not exist");
+    }
+    index->is_directory_ = fs::is_directory(status);
+
+    if (!index->is_directory_) {
+        // A single file is the whole torrent; patterns only apply inside directories.
+        index->files_.push_back(stat_root_file(root));
+    } else {
+        const Filters filters{filter, options.follow_symlinks};
+        Partial walked = walk_parallel(root, filters, scan_threads(options.threads), options.max_files);
+        index->files_ = std::move(walked.files);
+        index->truncated_ = walked.truncated;
+        index->files_excluded_ = walked.files_excluded;
+        index->dirs_excluded_ = walked.dirs_excluded;
+    }
+
+    for (const auto& f : index->files_) {
+        index->total_size_ += f.size;
+    }
+    return index;
+}
+
+fs::path ContentIndex::full_path(const ContentEntry& entry) const
+{
+    return is_directory_ ? root_ / entry.path : root_;
+}
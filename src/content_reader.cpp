@@ -0,0 +1,267 @@
+#include "content_reader.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/vfs.h>
+#elif defined(__APPLE__)
+#include <sys/mount.h>
+#include <sys/param.h>
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Files below this size are cheaper to read than to map.
+constexpr int64_t min_mmap_size = 1024 * 1024;
+
+std::string error_text(int err)
+{
+    return std::system_category().message(err);
+}
+
+#ifdef _WIN32
+
+// Portable fallback: std::ifstream with an explicit seek per read.
+class StreamReader final : public ContentReader
+{
+public:
+    StreamReader(const fs::path& path, int64_t size, std::ifstream file)
+        : ContentReader(path, size), file_(std::move(file)) {}
+
+    ReadBackend backend() const override { return ReadBackend::PREAD; }
+
+    int64_t read(int64_t offset, char* dst, int64_t len) override
+    {
+        len = std::max<int64_t>(0, std::min(len, size_ - offset));
+        if (len == 0) return 0;
+        file_.clear();
+        file_.seekg(offset);
+        file_.read(dst, len);
+        if (file_.bad()) {
+            throw std::runtime_error("Read error: " + path_.string());
+        }
+        return file_.gcount();
+    }
+
+private:
+    std::ifstream file_;
+};
+
+#else
+
+// Positional reads on a raw descriptor; no shared file position, no iostream buffering.
+class PreadReader final : public ContentReader
+{
+public:
+    PreadReader(const fs::path& path, int64_t size, int fd)
+        : ContentReader(path, size), fd_(fd) {}
+
+    ~PreadReader() override { ::close(fd_); }
+
+    ReadBackend backend() const override { return ReadBackend::PREAD; }
+
+    int64_t read(int64_t offset, char* dst, int64_t len) override
+    {
+        int64_t total = 0;
+        while (total < len) {
+            ssize_t n = ::pread(fd_, dst + total, static_cast<size_t>(len - total),
+                                static_cast<off_t>(offset + total));
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("Read error: " + path_.string() + ": " + error_text(errno));
+            }
+            if (n == 0) break; // End of file
+            total += n;
+        }
+        return total;
+    }
+
+    void prefetch(int64_t offset, int64_t len) override
+    {
+#ifdef POSIX_FADV_WILLNEED
+        ::posix_fadvise(fd_, static_cast<off_t>(offset), static_cast<off_t>(len), POSIX_FADV_WILLNEED);
+#else
+        (void)offset;
+        (void)len;
+#endif
+    }
+
+private:
+    int fd_;
+};
+
+// Read-only private mapping of the whole file.
+class MmapReader final : public ContentReader
+{
+public:
+    MmapReader(const fs::path& path, int64_t size, void* base)
+        : ContentReader(path, size), base_(static_cast<const char*>(base)) {}
+
+    ~MmapReader() override { ::munmap(const_cast<char*>(base_), static_cast<size_t>(size_)); }
+
+    ReadBackend backend() const override { return ReadBackend::MMAP; }
+
+    int64_t read(int64_t offset, char* dst, int64_t len) override
+    {
+        len = std::max<int64_t>(0, std::min(len, size_ - offset));
+        if (len > 0) std::memcpy(dst, base_ + offset, static_cast<size_t>(len));
+        return len;
+    }
+
+    const char* view(int64_t offset, int64_t len, char*, int64_t& got) override
+    {
+        got = std::max<int64_t>(0, std::min(len, size_ - offset));
+        return base_ + std::min(offset, size_);
+    }
+
+    void prefetch(int64_t offset, int64_t len) override
+    {
+        // madvise() needs a page-aligned start
+        static const int64_t page = ::sysconf(_SC_PAGESIZE);
+        const int64_t start = std::min(offset, size_) / page * page;
+        const int64_t end = std::min(offset + len, size_);
+        if (end > start) {
+            ::madvise(const_cast<char*>(base_) + start, static_cast<size_t>(end - start), MADV_WILLNEED);
+        }
+    }
+
+private:
+    const char* base_;
+};
+
+// Network and FUSE filesystems can fail or shrink files under a mapping, which
+// surfaces as SIGBUS instead of a read error; keep those on pread.
+bool is_local_filesystem(int fd)
+{
+#if defined(__linux__)
+    struct statfs st;
+    if (::fstatfs(fd, &st) != 0) return false;
+    switch (static_cast<unsigned long>(st.f_type)) {
+    case 0x6969UL:      // NFS
+    case 0x517BUL:      // SMB
+    case 0xFF534D42UL:  // CIFS
+    case 0xFE534D42UL:  // SMB2
+    case 0x65735546UL:  // FUSE
+    case 0x01021997UL:  // 9P
+    case 0x73757245UL:  // Coda
+    case 0x564C5953UL:  // AFS (kAFS)
+        return false;
+    default:
+        return true;
+    }
+#elif defined(__APPLE__)
+    struct statfs st;
+    if (::fstatfs(fd, &st) != 0) return false;
+    return (st.f_flags & MNT_LOCAL) != 0;
+#else
+    (void)fd;
+    return false;
+#endif
+}
+
+#endif
+
+ReadBackend backend_from_env()
+{
+    if (const char* e = std::getenv("TB_IO_BACKEND")) {
+        return ContentReader::parse_backend(e);
+    }
+    return ReadBackend::AUTO;
+}
+
+} // namespace
+
+ReadBackend ContentReader::parse_backend(const std::string& name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (lower == "pread") return ReadBackend::PREAD;
+    if (lower == "mmap") return ReadBackend::MMAP;
+    return ReadBackend::AUTO;
+}
+
+const char* ContentReader::view(int64_t offset, int64_t len, char* scratch, int64_t& got)
+{
+    got = read(offset, scratch, len);
+    return scratch;
+}
+
+void ContentReader::prefetch(int64_t, int64_t)
+{
+}
+
+std::unique_ptr<ContentReader> ContentReader::open(const fs::path& path, ReadBackend backend,
+                                                   AccessPattern pattern)
+{
+    if (backend == ReadBackend::AUTO) {
+        backend = backend_from_env();
+    }
+
+#ifdef _WIN32
+    (void)backend;
+    (void)pattern;
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Failed to open file: " + path.string());
+    }
+    std::error_code ec;
+    int64_t size = static_cast<int64_t>(fs::file_size(path, ec));
+    if (ec) {
+        throw std::runtime_error("Failed to stat file: " + path.string() + ": " + ec.message());
+    }
+    return std::make_unique<StreamReader>(path, size, std::move(file));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open file: " + path.string() + ": " + error_text(errno));
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to stat file: " + path.string() + ": " + error_text(err));
+    }
+    const int64_t size = static_cast<int64_t>(st.st_size);
+
+    // A mapped file truncated by another process raises SIGBUS on access
+    // rather than a read error, so mapping is opt-in and even then limited to
+    // large files on local filesystems. Mapping needs a 64-bit address space
+    // to hold arbitrarily large content.
+    if (backend == ReadBackend::MMAP && sizeof(void*) >= 8 && size >= min_mmap_size
+        && is_local_filesystem(fd)) {
+        void* base = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (base != MAP_FAILED) {
+            ::close(fd); // The mapping keeps the file referenced
+            ::madvise(base, static_cast<size_t>(size),
+                      pattern == AccessPattern::SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+            return std::make_unique<MmapReader>(path, size, base);
+        }
+        log_message("mmap failed for " + path.string() + " (" + error_text(errno)
+                        + "), falling back to pread", LogLevel::WARNING);
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, 0, 0, pattern == AccessPattern::SEQUENTIAL ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM);
+#endif
+    return std::make_unique<PreadReader>(path, size, fd);
+#endif
+}
@@ -0,0 +1,146 @@
+#include "device_scheduler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <sys/sysmacros.h>
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+std::string read_line(const fs::path& path)
+{
+    std::ifstream f(path);
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+// True if the disk at sysfs device directory @p dir spins, or sits on top of
+// one that does. Partitions are resolved to their disk first.
+bool is_rotational(fs::path dir, int depth)
+{
+    std::error_code ec;
+    if (fs::exists(dir / "partition", ec)) {
+        dir = dir.parent_path();
+    }
+    if (read_line(dir / "queue" / "rotational") == "1") return true;
+    if (depth >= 4) return false;
+
+    for (fs::directory_iterator it(dir / "slaves", ec), end; !ec && it != end; it.increment(ec)) {
+        fs::path member = fs::canonical(it->path(), ec);
+        if (!ec && is_rotational(member, depth + 1)) return true;
+        ec.clear();
+    }
+    return false;
+}
+
+}
+
+StorageDevice block_device_info(unsigned major, unsigned minor, const fs::path& sysfs_root)
+{
+    StorageDevice device;
+    device.id = std::to_string(major) + ":" + std::to_string(minor);
+
+    std::error_code ec;
+    fs::path dir = fs::canonical(sysfs_root / "dev" / "block" / device.id, ec);
+    if (ec) return device;
+    if (fs::exists(dir / "partition", ec)) {
+        dir = dir.parent_path();
+    }
+
+    device.name = dir.filename().string();
+    if (std::string disk = read_line(dir / "dev"); !disk.empty()) {
+        device.id = disk;
+    }
+    device.rotational = is_rotational(dir, 0);
+    return device;
+}
+
+StorageDevice storage_device_for(const fs::path& path, const fs::path& sysfs_root)
+{
+#ifndef _WIN32
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return {};
+#if defined(__linux__)
+    return block_device_info(major(st.st_dev), minor(st.st_dev), sysfs_root);
+#else
+    (void)sysfs_root;
+    return StorageDevice{std::to_string(static_cast<unsigned long long>(st.st_dev)), {}, false};
+#endif
+#else
+    (void)sysfs_root;
+    std::error_code ec;
+    if (!fs::exists(path, ec)) return {};
+    return StorageDevice{path.root_name().string(), {}, false};
+#endif
+}
+
+DeviceScheduler::DeviceScheduler(const std::vector<StorageDevice>& devices, int hdd_readers, int ssd_readers,
+                                 const std::vector<int>& order)
+    : queue_of_job_(devices.size(), -1), rank_(devices.size()), remaining_(devices.size())
+{
+    std::vector<int> jobs = order;
+    if (jobs.empty()) {
+        for (size_t job = 0; job < devices.size(); ++job) jobs.push_back(static_cast<int>(job));
+    }
+
+    std::vector<std::string> ids;
+    for (size_t position = 0; position < jobs.size(); ++position) {
+        const size_t job = static_cast<size_t>(jobs[position]);
+        rank_[job] = static_cast<int>(position);
+        size_t q = 0;
+        while (q < ids.size() && ids[q] != devices[job].id) ++q;
+        if (q == ids.size()) {
+            ids.push_back(devices[job].id);
+            Queue queue;
+            queue.cap = devices[job].rotational ? std::max(1, hdd_readers) : std::max(0, ssd_readers);
+            queues_.push_back(std::move(queue));
+        }
+        queues_[q].jobs.push_back(static_cast<int>(job));
+        queue_of_job_[job] = static_cast<int>(q);
+    }
+}
+
+std::optional<int> DeviceScheduler::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        if (remaining_ == 0) return std::nullopt;
+
+        // Least busy device first; on a tie, the one whose next job comes first
+        Queue* best = nullptr;
+        for (auto& queue : queues_) {
+            if (queue.next == queue.jobs.size()) continue;
+            if (queue.cap > 0 && queue.running >= queue.cap) continue;
+            if (!best || queue.running < best->running
+                || (queue.running == best->running
+                    && rank_[queue.jobs[queue.next]] < rank_[best->jobs[best->next]])) {
+                best = &queue;
+            }
+        }
+        if (best) {
+            ++best->running;
+            --remaining_;
+            return best->jobs[best->next++];
+        }
+        cv_.wait(lock);
+    }
+}
+
+void DeviceScheduler::release(int job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --queues_[queue_of_job_[job]].running;
+    }
+    cv_.notify_all();
+}
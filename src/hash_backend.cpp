@@ -0,0 +1,724 @@
+#include "hash_backend.hpp"
+#include "logger.hpp"
+
+#include <libtorrent/hasher.hpp>
+#include <openssl/evp.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TB_HAVE_X86_KERNELS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#define TB_TARGET(features) __attribute__((target(features)))
+#define TB_INLINE inline __attribute__((always_inline))
+#endif
+
+namespace
+{
+
+constexpr uint32_t sha1_init[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+constexpr uint32_t sha256_init[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                     0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+alignas(16) constexpr uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+// Builds the final block(s) of a message: the bytes after its last full
+// block, 0x80, zeros and the length in bits. Returns 1 or 2 blocks.
+int pad_tail(const char* data, int64_t size, unsigned char tail[128])
+{
+    const int64_t full = size / 64 * 64;
+    const int rem = static_cast<int>(size - full);
+    std::memset(tail, 0, 128);
+    if (rem > 0) std::memcpy(tail, data + full, rem);
+    tail[rem] = 0x80;
+    const int blocks = rem < 56 ? 1 : 2;
+    const uint64_t bits = static_cast<uint64_t>(size) * 8;
+    for (int i = 0; i < 8; ++i) {
+        tail[blocks * 64 - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+    }
+    return blocks;
+}
+
+void store_be32(char* out, uint32_t word)
+{
+    out[0] = static_cast<char>(word >> 24);
+    out[1] = static_cast<char>(word >> 16);
+    out[2] = static_cast<char>(word >> 8);
+    out[3] = static_cast<char>(word);
+}
+
+template <typename Hasher, typename Digest>
+Digest generic_digest(const char* data, int64_t size)
+{
+    Hasher h;
+    while (size > 0) {
+        const int n = static_cast<int>(std::min<int64_t>(size, 1 << 30));
+        h.update(data, n);
+        data += n;
+        size -= n;
+    }
+    return h.final();
+}
+
+lt::sha1_hash generic_sha1(const char* data, int64_t size)
+{
+    return generic_digest<lt::hasher, lt::sha1_hash>(data, size);
+}
+
+lt::sha256_hash generic_sha256(const char* data, int64_t size)
+{
+    return generic_digest<lt::hasher256, lt::sha256_hash>(data, size);
+}
+
+#ifdef TB_HAVE_X86_KERNELS
+
+struct CpuFeatures {
+    bool sha_ni = false;
+    bool avx2 = false;
+    bool avx512 = false;
+};
+
+CpuFeatures probe_cpu()
+{
+    CpuFeatures f;
+    unsigned a = 0, b = 0, c = 0, d = 0;
+    if (!__get_cpuid(1, &a, &b, &c, &d)) return f;
+    const bool ssse3 = c & (1u << 9);
+    const bool sse41 = c & (1u << 19);
+    const bool osxsave = c & (1u << 27);
+    const bool avx = c & (1u << 28);
+
+    unsigned b7 = 0;
+    if (__get_cpuid_max(0, nullptr) >= 7) {
+        unsigned a7 = 0, c7 = 0, d7 = 0;
+        __cpuid_count(7, 0, a7, b7, c7, d7);
+    }
+    f.sha_ni = ssse3 && sse41 && (b7 & (1u << 29));
+
+    if (osxsave && avx) {
+        // The OS must save the YMM (and for AVX-512, opmask/ZMM) state on context switches.
+        unsigned lo = 0, hi = 0;
+        __asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+        const bool ymm = (lo & 0x6) == 0x6;
+        const bool zmm = (lo & 0xe6) == 0xe6;
+        f.avx2 = ymm && (b7 & (1u << 5));
+        f.avx512 = f.avx2 && zmm && (b7 & (1u << 16));
+    }
+    return f;
+}
+
+const CpuFeatures& cpu()
+{
+    static const CpuFeatures features = probe_cpu();
+    return features;
+}
+
+// ─── SHA-NI ───────────────────────────────────────────────────
+// One message at a time; the rounds are expanded at compile time because the
+// round-function selector of sha1rnds4 must be an immediate.
+
+template <int G>
+TB_TARGET("sha,sse4.1,ssse3") TB_INLINE
+void sha1_shani_group(__m128i& abcd, __m128i (&e)[2], __m128i (&m)[4])
+{
+    constexpr int cur = G & 1;
+    if constexpr (G == 0) {
+        e[0] = _mm_add_epi32(e[0], m[0]);
+        e[1] = abcd;
+    } else {
+        e[cur] = _mm_sha1nexte_epu32(e[cur], m[G & 3]);
+        e[cur ^ 1] = abcd;
+    }
+    abcd = _mm_sha1rnds4_epu32(abcd, e[cur], G / 5);
+    if constexpr (G >= 3 && G <= 18) m[(G + 1) & 3] = _mm_sha1msg2_epu32(m[(G + 1) & 3], m[G & 3]);
+    if constexpr (G >= 2 && G <= 17) m[(G + 2) & 3] = _mm_xor_si128(m[(G + 2) & 3], m[G & 3]);
+    if constexpr (G >= 1 && G <= 16) m[(G + 3) & 3] = _mm_sha1msg1_epu32(m[(G + 3) & 3], m[G & 3]);
+}
+
+template <int... G>
+TB_TARGET("sha,sse4.1,ssse3") TB_INLINE
+void sha1_shani_rounds(__m128i& abcd, __m128i (&e)[2], __m128i (&m)[4], std::integer_sequence<int, G...>)
+{
+    (sha1_shani_group<G>(abcd, e, m), ...);
+}
+
+TB_TARGET("sha,sse4.1,ssse3")
+void sha1_blocks_shani(uint32_t state[5], const unsigned char* data, int64_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0x1b);
+    __m128i e0 = _mm_set_epi32(static_cast<int>(state[4]), 0, 0, 0);
+
+    for (; blocks > 0; --blocks, data += 64) {
+        const __m128i abcd_save = abcd;
+        __m128i m[4];
+        for (int i = 0; i < 4; ++i) {
+            m[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), mask);
+        }
+        __m128i e[2] = {e0, e0};
+        sha1_shani_rounds(abcd, e, m, std::make_integer_sequence<int, 20>{});
+        e0 = _mm_sha1nexte_epu32(e[0], e0);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+}
+
+template <int G>
+TB_TARGET("sha,sse4.1,ssse3") TB_INLINE
+void sha256_shani_group(__m128i& abef, __m128i& cdgh, __m128i (&w)[4])
+{
+    const __m128i msg = _mm_add_epi32(w[G & 3], _mm_load_si128(reinterpret_cast<const __m128i*>(sha256_k + 4 * G)));
+    cdgh = _mm_sha256rnds2_epu32(cdgh, abef, msg);
+    abef = _mm_sha256rnds2_epu32(abef, cdgh, _mm_shuffle_epi32(msg, 0x0e));
+    if constexpr (G < 12) {
+        __m128i t = _mm_sha256msg1_epu32(w[G & 3], w[(G + 1) & 3]);
+        t = _mm_add_epi32(t, _mm_alignr_epi8(w[(G + 3) & 3], w[(G + 2) & 3], 4));
+        w[G & 3] = _mm_sha256msg2_epu32(t, w[(G + 3) & 3]);
+    }
+}
+
+template <int... G>
+TB_TARGET("sha,sse4.1,ssse3") TB_INLINE
+void sha256_shani_rounds(__m128i& abef, __m128i& cdgh, __m128i (&w)[4], std::integer_sequence<int, G...>)
+{
+    (sha256_shani_group<G>(abef, cdgh, w), ...);
+}
+
+TB_TARGET("sha,sse4.1,ssse3")
+void sha256_blocks_shani(uint32_t state[8], const unsigned char* data, int64_t blocks)
+{
+    const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state)), 0xb1);
+    __m128i cdgh = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(state + 4)), 0x1b);
+    __m128i abef = _mm_alignr_epi8(tmp, cdgh, 8);
+    cdgh = _mm_blend_epi16(cdgh, tmp, 0xf0);
+
+    for (; blocks > 0; --blocks, data += 64) {
+        const __m128i abef_save = abef;
+        const __m128i cdgh_save = cdgh;
+        __m128i w[4];
+        for (int i = 0; i < 4; ++i) {
+            w[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * i)), mask);
+        }
+        sha256_shani_rounds(abef, cdgh, w, std::make_integer_sequence<int, 16>{});
+        abef = _mm_add_epi32(abef, abef_save);
+        cdgh = _mm_add_epi32(cdgh, cdgh_save);
+    }
+
+    tmp = _mm_shuffle_epi32(abef, 0x1b);
+    cdgh = _mm_shuffle_epi32(cdgh, 0xb1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_blend_epi16(tmp, cdgh, 0xf0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(state + 4), _mm_alignr_epi8(cdgh, tmp, 8));
+}
+
+template <typename Digest, int Words, typename Blocks>
+Digest shani_digest(const uint32_t (&init)[Words], Blocks blocks, const char* data, int64_t size)
+{
+    uint32_t state[Words];
+    std::copy(init, init + Words, state);
+    blocks(state, reinterpret_cast<const unsigned char*>(data), size / 64);
+    unsigned char tail[128];
+    blocks(state, tail, pad_tail(data, size, tail));
+    Digest out;
+    for (int i = 0; i < Words; ++i) store_be32(out.data() + 4 * i, state[i]);
+    return out;
+}
+
+lt::sha1_hash shani_sha1(const char* data, int64_t size)
+{
+    return shani_digest<lt::sha1_hash>(sha1_init, sha1_blocks_shani, data, size);
+}
+
+lt::sha256_hash shani_sha256(const char* data, int64_t size)
+{
+    return shani_digest<lt::sha256_hash>(sha256_init, sha256_blocks_shani, data, size);
+}
+
+// ─── Multi-buffer AVX2 / AVX-512 ──────────────────────────────
+// Lane l of every vector belongs to message l. The round code is written once
+// with GCC vector extensions and compiled for 8 and 16 lanes by inlining it
+// into the AVX2 and AVX-512 entry points below.
+
+typedef uint32_t v8u __attribute__((vector_size(32)));
+typedef uint32_t v16u __attribute__((vector_size(64)));
+
+#define TB_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define TB_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+template <typename V>
+TB_INLINE void sha1_mb_block(V* state, V* w)
+{
+    V a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+#pragma GCC unroll 80
+    for (int t = 0; t < 80; ++t) {
+        if (t >= 16) {
+            const V x = w[(t - 3) & 15] ^ w[(t - 8) & 15] ^ w[(t - 14) & 15] ^ w[t & 15];
+            w[t & 15] = TB_ROTL(x, 1);
+        }
+        V f;
+        uint32_t k;
+        if (t < 20) {
+            f = (b & c) ^ (~b & d);
+            k = 0x5a827999;
+        } else if (t < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (t < 60) {
+            f = (b & c) | (d & (b | c));
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        const V tmp = TB_ROTL(a, 5) + f + e + k + w[t & 15];
+        e = d;
+        d = c;
+        c = TB_ROTL(b, 30);
+        b = a;
+        a = tmp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+template <typename V>
+TB_INLINE void sha256_mb_block(V* state, V* w)
+{
+    V a = state[0], b = state[1], c = state[2], d = state[3];
+    V e = state[4], f = state[5], g = state[6], h = state[7];
+#pragma GCC unroll 64
+    for (int t = 0; t < 64; ++t) {
+        if (t >= 16) {
+            const V w15 = w[(t - 15) & 15];
+            const V w2 = w[(t - 2) & 15];
+            const V s0 = TB_ROTR(w15, 7) ^ TB_ROTR(w15, 18) ^ (w15 >> 3);
+            const V s1 = TB_ROTR(w2, 17) ^ TB_ROTR(w2, 19) ^ (w2 >> 10);
+            w[t & 15] += s0 + w[(t - 7) & 15] + s1;
+        }
+        const V t1 = h + (TB_ROTR(e, 6) ^ TB_ROTR(e, 11) ^ TB_ROTR(e, 25)) + ((e & f) ^ (~e & g))
+                     + sha256_k[t] + w[t & 15];
+        const V t2 = (TB_ROTR(a, 2) ^ TB_ROTR(a, 13) ^ TB_ROTR(a, 22)) + ((a & b) | (c & (a | b)));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+#undef TB_ROTL
+#undef TB_ROTR
+
+TB_TARGET("avx2") TB_INLINE
+void transpose8(__m256i (&r)[8])
+{
+    __m256i t[8], u[8];
+    for (int i = 0; i < 8; i += 2) {
+        t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+        t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (int i = 0; i < 8; i += 4) {
+        u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+        u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+        u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+        u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    for (int i = 0; i < 4; ++i) {
+        r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+        r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+}
+
+// Loads 8 consecutive big-endian words at @p offset of 8 lanes, one word per vector.
+TB_TARGET("avx2") TB_INLINE
+void load_transposed8(const unsigned char* const* lanes, int64_t offset, __m256i (&r)[8])
+{
+    const __m256i bswap = _mm256_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                          12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    for (int l = 0; l < 8; ++l) {
+        r[l] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes[l] + offset));
+    }
+    transpose8(r);
+    for (int i = 0; i < 8; ++i) r[i] = _mm256_shuffle_epi8(r[i], bswap);
+}
+
+// Message words of one block for every lane. Deliberately not always_inline:
+// the vector templates that call it are compiled for the default target.
+TB_TARGET("avx2")
+void load_block_x8(const unsigned char* const* lanes, int64_t offset, v8u* w)
+{
+    for (int half = 0; half < 2; ++half) {
+        __m256i r[8];
+        load_transposed8(lanes, offset + 32 * half, r);
+        for (int i = 0; i < 8; ++i) w[8 * half + i] = reinterpret_cast<v8u>(r[i]);
+    }
+}
+
+TB_TARGET("avx512f,avx2")
+void load_block_x16(const unsigned char* const* lanes, int64_t offset, v16u* w)
+{
+    for (int half = 0; half < 2; ++half) {
+        __m256i lo[8], hi[8];
+        load_transposed8(lanes, offset + 32 * half, lo);
+        load_transposed8(lanes + 8, offset + 32 * half, hi);
+        for (int i = 0; i < 8; ++i) {
+            auto* words = reinterpret_cast<__m256i*>(&w[8 * half + i]);
+            _mm256_storeu_si256(words, lo[i]);
+            _mm256_storeu_si256(words + 1, hi[i]);
+        }
+    }
+}
+
+template <int Words, typename V>
+TB_INLINE void mb_block(V* state, V* w)
+{
+    if constexpr (Words == 5) {
+        sha1_mb_block(state, w);
+    } else {
+        sha256_mb_block(state, w);
+    }
+}
+
+// Hashes up to Lanes messages of identical length; unused lanes repeat message 0.
+template <typename V, int Lanes, int Words, typename Digest>
+TB_INLINE void mb_digest(const uint32_t (&init)[Words], void (*load)(const unsigned char* const*, int64_t, V*),
+                         const HashInput* in, int n, Digest* out)
+{
+    const unsigned char* lanes[Lanes];
+    for (int l = 0; l < Lanes; ++l) {
+        lanes[l] = reinterpret_cast<const unsigned char*>(in[l < n ? l : 0].data);
+    }
+    V state[Words];
+    for (int i = 0; i < Words; ++i) state[i] = V{} + init[i];
+
+    V w[16];
+    const int64_t size = in[0].size;
+    for (int64_t b = 0; b < size / 64; ++b) {
+        load(lanes, b * 64, w);
+        mb_block<Words>(state, w);
+    }
+
+    unsigned char tails[Lanes][128];
+    int tail_blocks = 1;
+    for (int l = 0; l < Lanes; ++l) {
+        tail_blocks = pad_tail(in[l < n ? l : 0].data, size, tails[l]);
+        lanes[l] = tails[l];
+    }
+    for (int b = 0; b < tail_blocks; ++b) {
+        load(lanes, b * 64, w);
+        mb_block<Words>(state, w);
+    }
+
+    for (int l = 0; l < n; ++l) {
+        for (int i = 0; i < Words; ++i) store_be32(out[l].data() + 4 * i, state[i][l]);
+    }
+}
+
+TB_TARGET("avx2")
+void sha1_x8(const HashInput* in, int n, lt::sha1_hash* out)
+{
+    mb_digest<v8u, 8>(sha1_init, load_block_x8, in, n, out);
+}
+
+TB_TARGET("avx2")
+void sha256_x8(const HashInput* in, int n, lt::sha256_hash* out)
+{
+    mb_digest<v8u, 8>(sha256_init, load_block_x8, in, n, out);
+}
+
+TB_TARGET("avx512f,avx2")
+void sha1_x16(const HashInput* in, int n, lt::sha1_hash* out)
+{
+    mb_digest<v16u, 16>(sha1_init, load_block_x16, in, n, out);
+}
+
+TB_TARGET("avx512f,avx2")
+void sha256_x16(const HashInput* in, int n, lt::sha256_hash* out)
+{
+    mb_digest<v16u, 16>(sha256_init, load_block_x16, in, n, out);
+}
+
+#endif // TB_HAVE_X86_KERNELS
+
+template <typename Digest>
+using MultiBuffer = void (*)(const HashInput*, int, Digest*);
+
+template <typename Digest>
+struct KernelTable {
+    Digest (*generic)(const char*, int64_t);
+    Digest (*shani)(const char*, int64_t);
+    MultiBuffer<Digest> x8;
+    MultiBuffer<Digest> x16;
+};
+
+const KernelTable<lt::sha1_hash>& sha1_table()
+{
+#ifdef TB_HAVE_X86_KERNELS
+    static const KernelTable<lt::sha1_hash> table{generic_sha1, shani_sha1, sha1_x8, sha1_x16};
+#else
+    static const KernelTable<lt::sha1_hash> table{generic_sha1, nullptr, nullptr, nullptr};
+#endif
+    return table;
+}
+
+const KernelTable<lt::sha256_hash>& sha256_table()
+{
+#ifdef TB_HAVE_X86_KERNELS
+    static const KernelTable<lt::sha256_hash> table{generic_sha256, shani_sha256, sha256_x8, sha256_x16};
+#else
+    static const KernelTable<lt::sha256_hash> table{generic_sha256, nullptr, nullptr, nullptr};
+#endif
+    return table;
+}
+
+template <typename Digest>
+void run_batch(HashKernel kernel, const KernelTable<Digest>& table,
+               const HashInput* in, Digest* out, int count)
+{
+    // Lone messages in the multi-buffer kernels still use SHA-NI when the CPU has it.
+    auto single = (kernel == HashKernel::SHA_NI || hash_backend::supported(HashKernel::SHA_NI))
+                      ? table.shani : table.generic;
+    if (kernel == HashKernel::GENERIC || !single) single = table.generic;
+
+    if (kernel != HashKernel::AVX2 && kernel != HashKernel::AVX512) {
+        for (int i = 0; i < count; ++i) out[i] = single(in[i].data, in[i].size);
+        return;
+    }
+
+    // Equal-length messages share a group of lanes; group them by size.
+    std::vector<int> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [in](int a, int b) { return in[a].size < in[b].size; });
+
+    const int max_lanes = kernel == HashKernel::AVX512 ? 16 : 8;
+    HashInput lane_in[16];
+    Digest lane_out[16];
+    for (int i = 0; i < count;) {
+        int n = 1;
+        while (i + n < count && n < max_lanes && in[order[i + n]].size == in[order[i]].size) ++n;
+
+        if (n == 1) {
+            out[order[i]] = single(in[order[i]].data, in[order[i]].size);
+        } else {
+            for (int l = 0; l < n; ++l) lane_in[l] = in[order[i + l]];
+            (n > 8 ? table.x16 : table.x8)(lane_in, n, lane_out);
+            for (int l = 0; l < n; ++l) out[order[i + l]] = lane_out[l];
+        }
+        i += n;
+    }
+}
+
+template <typename Digest>
+void cross_check(const EVP_MD* md, const char* algorithm, const HashInput* in, const Digest* out, int count)
+{
+    unsigned char expected[EVP_MAX_MD_SIZE];
+    for (int i = 0; i < count; ++i) {
+        unsigned int len = 0;
+        if (EVP_Digest(in[i].data, static_cast<size_t>(in[i].size), expected, &len, md, nullptr) != 1) {
+            throw std::runtime_error(std::string("OpenSSL ") + algorithm + " failed");
+        }
+        if (std::memcmp(expected, out[i].data(), len) != 0) {
+            std::string msg = std::string(algorithm) + " mismatch between the "
+                              + hash_backend::kernel_name(hash_backend::active())
+                              + " kernel and OpenSSL for a " + std::to_string(in[i].size) + "-byte message";
+            log_message(msg, LogLevel::ERR);
+            throw std::runtime_error(msg);
+        }
+    }
+}
+
+bool env_flag(const char* name)
+{
+    const char* value = std::getenv(name);
+    return value && *value && std::string(value) != "0";
+}
+
+HashKernel initial_kernel()
+{
+    HashKernel kernel = hash_backend::detect();
+    if (const char* name = std::getenv("TB_HASH_KERNEL"); name && *name) {
+        try {
+            HashKernel requested = hash_backend::parse_kernel(name);
+            if (hash_backend::supported(requested)) {
+                kernel = requested;
+            } else {
+                log_message("TB_HASH_KERNEL=" + std::string(name) + " is not supported on this CPU, using "
+                                + hash_backend::kernel_name(kernel),
+                            LogLevel::WARNING);
+            }
+        } catch (const std::invalid_argument& e) {
+            log_message(e.what(), LogLevel::WARNING);
+        }
+    }
+    log_message("Hashing with " + hash_backend::kernel_name(kernel) + " kernels", LogLevel::INFO);
+    return kernel;
+}
+
+std::atomic<HashKernel>& active_kernel()
+{
+    static std::atomic<HashKernel> kernel{initial_kernel()};
+    return kernel;
+}
+
+std::atomic<bool>& verify_flag()
+{
+    static std::atomic<bool> flag{env_flag("TB_HASH_VERIFY")};
+    return flag;
+}
+
+} // namespace
+
+namespace hash_backend
+{
+
+bool supported(HashKernel kernel)
+{
+    switch (kernel) {
+    case HashKernel::GENERIC:
+        return true;
+#ifdef TB_HAVE_X86_KERNELS
+    case HashKernel::SHA_NI:
+        return cpu().sha_ni;
+    case HashKernel::AVX2:
+        return cpu().avx2;
+    case HashKernel::AVX512:
+        return cpu().avx512;
+#endif
+    default:
+        return false;
+    }
+}
+
+HashKernel detect()
+{
+    // Sixteen AVX-512 lanes outrun SHA-NI on batches; eight AVX2 lanes do not for SHA-256.
+    for (HashKernel kernel : {HashKernel::AVX512, HashKernel::SHA_NI, HashKernel::AVX2}) {
+        if (supported(kernel)) return kernel;
+    }
+    return HashKernel::GENERIC;
+}
+
+HashKernel active()
+{
+    return active_kernel().load(std::memory_order_relaxed);
+}
+
+void set_active(HashKernel kernel)
+{
+    if (!supported(kernel)) {
+        throw std::runtime_error("Hash kernel not supported on this CPU: " + kernel_name(kernel));
+    }
+    active_kernel().store(kernel, std::memory_order_relaxed);
+}
+
+HashKernel parse_kernel(const std::string& name)
+{
+    std::string lower;
+    for (char c : name) lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (lower == "generic") return HashKernel::GENERIC;
+    if (lower == "shani" || lower == "sha-ni") return HashKernel::SHA_NI;
+    if (lower == "avx2") return HashKernel::AVX2;
+    if (lower == "avx512" || lower == "avx-512") return HashKernel::AVX512;
+    throw std::invalid_argument("Unknown hash kernel: " + name + " (expected generic, shani, avx2 or avx512)");
+}
+
+std::string kernel_name(HashKernel kernel)
+{
+    switch (kernel) {
+    case HashKernel::SHA_NI:
+        return "SHA-NI";
+    case HashKernel::AVX2:
+        return "AVX2";
+    case HashKernel::AVX512:
+        return "AVX-512";
+    default:
+        return "generic";
+    }
+}
+
+int batch_size()
+{
+    switch (active()) {
+    case HashKernel::AVX512:
+        return 16;
+    case HashKernel::AVX2:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+void set_verify(bool enabled)
+{
+    verify_flag().store(enabled, std::memory_order_relaxed);
+}
+
+bool verify()
+{
+    return verify_flag().load(std::memory_order_relaxed);
+}
+
+void sha1(const HashInput* inputs, lt::sha1_hash* out, int count)
+{
+    run_batch(active(), sha1_table(), inputs, out, count);
+    if (verify()) cross_check(EVP_sha1(), "SHA-1", inputs, out, count);
+}
+
+void sha256(const HashInput* inputs, lt::sha256_hash* out, int count)
+{
+    run_batch(active(), sha256_table(), inputs, out, count);
+    if (verify()) cross_check(EVP_sha256(), "SHA-256", inputs, out, count);
+}
+
+lt::sha1_hash sha1(const char* data, int64_t size)
+{
+    HashInput in{data, size};
+    lt::sha1_hash out;
+    sha1(&in, &out, 1);
+    return out;
+}
+
+lt::sha256_hash sha256(const char* data, int64_t size)
+{
+    HashInput in{data, size};
+    lt::sha256_hash out;
+    sha256(&in, &out, 1);
+    return out;
+}
+
+} // namespace hash_backend
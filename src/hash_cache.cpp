@@ -0,0 +1,442 @@
+#include "hash_cache.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// File layout: a 16-byte header, then records aligned to 8 bytes, each a
+// RecordHeader followed by its payload. Records are only ever appended; a
+// key stored twice resolves to the later record.
+constexpr char file_magic[8] = {'T', 'B', 'H', 'C', 'A', 'C', 'H', 'E'};
+constexpr uint32_t file_version = 1;
+constexpr int64_t file_header_size = 16;
+constexpr uint32_t record_magic = 0x52484254;  // "TBHR"
+
+struct RecordHeader {
+    uint32_t magic;
+    uint32_t size;        // Payload bytes
+    uint8_t key[32];
+    int64_t last_used;    // Nanoseconds since the epoch; rewritten in place on every hit
+    uint64_t checksum;    // Over key, size and payload (not last_used)
+};
+static_assert(sizeof(RecordHeader) == 56);
+
+int64_t record_size(uint32_t payload)
+{
+    return (static_cast<int64_t>(sizeof(RecordHeader)) + payload + 7) & ~int64_t{7};
+}
+
+// FNV-1a: cheap, and only has to catch torn or stale bytes, not adversaries.
+uint64_t checksum(const uint8_t* key, uint32_t size, const char* payload)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto mix = [&h](const void* data, size_t len) {
+        const auto* p = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; ++i) {
+            h = (h ^ p[i]) * 0x100000001b3ULL;
+        }
+    };
+    mix(key, 32);
+    mix(&size, sizeof(size));
+    mix(payload, size);
+    return h;
+}
+
+int64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+std::string error_text(int err)
+{
+    return std::system_category().message(err);
+}
+
+#ifndef _WIN32
+
+// Exclusive advisory lock on "<cache>.lock", serializing writers across
+// processes. The lock file is never replaced, unlike the cache file itself.
+class FileLock
+{
+public:
+    explicit FileLock(const fs::path& cache_path)
+    {
+        const std::string lock_path = cache_path.string() + ".lock";
+        fd_ = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ >= 0 && ::flock(fd_, LOCK_EX) != 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+    ~FileLock()
+    {
+        if (fd_ >= 0) ::close(fd_);  // Closing releases the lock
+    }
+    bool held() const { return fd_ >= 0; }
+
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd_ = -1;
+};
+
+#endif
+
+}
+
+size_t HashCache::KeyHash::operator()(const Key& key) const
+{
+    // Keys are SHA-256 digests: any eight bytes are already well mixed.
+    size_t h;
+    std::memcpy(&h, key.data(), sizeof(h));
+    return h;
+}
+
+fs::path HashCache::default_path()
+{
+#ifdef _WIN32
+    if (const char* local = std::getenv("LOCALAPPDATA"); local && *local) {
+        return fs::path(local) / "torrent-builder" / "piece-hashes.bin";
+    }
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return fs::path(xdg) / "torrent-builder" / "piece-hashes.bin";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return fs::path(home) / ".cache" / "torrent-builder" / "piece-hashes.bin";
+    }
+#endif
+    return {};
+}
+
+std::shared_ptr<HashCache> HashCache::shared()
+{
+    static const std::shared_ptr<HashCache> instance = []() -> std::shared_ptr<HashCache> {
+        if (const char* e = std::getenv("TB_HASH_CACHE")) {
+            const std::string value(e);
+            if (value == "0" || value == "off" || value == "false") return nullptr;
+        }
+#ifdef _WIN32
+        return nullptr;
+#else
+        const fs::path path = default_path();
+        if (path.empty()) return nullptr;
+
+        int64_t max_bytes = kDefaultMaxBytes;
+        if (const char* e = std::getenv("TB_HASH_CACHE_MB"); e && *e) {
+            const long long mb = std::atoll(e);
+            if (mb > 0) max_bytes = static_cast<int64_t>(mb) * 1024 * 1024;
+        }
+        auto cache = std::make_shared<HashCache>(path, max_bytes);
+        if (cache->fd_ < 0) return nullptr;
+        log_message("Piece hash cache: " + path.string() + " (" + std::to_string(cache->entries())
+                    + " records, " + std::to_string(cache->file_size() / 1024) + " KB)", LogLevel::INFO);
+        return cache;
+#endif
+    }();
+    return instance;
+}
+
+#ifdef _WIN32
+
+HashCache::HashCache(fs::path path, int64_t max_bytes)
+    : path_(std::move(path)), max_bytes_(max_bytes)
+{
+}
+
+HashCache::~HashCache() = default;
+
+bool HashCache::lookup(const Key&, std::vector<char>&)
+{
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void HashCache::store(const Key&, const char*, size_t) {}
+
+size_t HashCache::entries() const { return 0; }
+
+int64_t HashCache::file_size() const { return 0; }
+
+#else
+
+HashCache::HashCache(fs::path path, int64_t max_bytes)
+    : path_(std::move(path)), max_bytes_(max_bytes)
+{
+    std::error_code ec;
+    if (path_.has_parent_path()) {
+        fs::create_directories(path_.parent_path(), ec);
+    }
+    std::lock_guard<std::mutex> guard(mutex_);
+    FileLock lock(path_);
+    if (!lock.held() || !open_locked()) {
+        log_message("Piece hash cache disabled: cannot open " + path_.string(), LogLevel::WARNING);
+        close_locked();
+    }
+}
+
+HashCache::~HashCache()
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    close_locked();
+}
+
+// Opens the cache file, writing a fresh header if it is new or foreign.
+// Writers must hold the FileLock; readers reopening a replaced file need not,
+// since a replacement always has a valid header.
+bool HashCache::open_locked()
+{
+    fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd_ < 0) return false;
+
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) return false;
+    inode_ = static_cast<uint64_t>(st.st_ino);
+
+    char header[file_header_size] = {};
+    bool valid = st.st_size >= file_header_size
+        && ::pread(fd_, header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header))
+        && std::memcmp(header, file_magic, sizeof(file_magic)) == 0;
+    if (valid) {
+        uint32_t version;
+        std::memcpy(&version, header + 8, sizeof(version));
+        valid = version == file_version;
+    }
+    if (!valid) {
+        std::memset(header, 0, sizeof(header));
+        std::memcpy(header, file_magic, sizeof(file_magic));
+        std::memcpy(header + 8, &file_version, sizeof(file_version));
+        if (::ftruncate(fd_, 0) != 0
+            || ::pwrite(fd_, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+            return false;
+        }
+    }
+
+    index_.clear();
+    scanned_ = file_header_size;
+    if (!remap_locked()) return false;
+    scan_locked();
+    return true;
+}
+
+void HashCache::close_locked()
+{
+    if (map_) ::munmap(map_, static_cast<size_t>(mapped_));
+    if (fd_ >= 0) ::close(fd_);
+    map_ = nullptr;
+    mapped_ = 0;
+    fd_ = -1;
+    index_.clear();
+    scanned_ = file_header_size;
+}
+
+// Maps the whole file again if another writer (or this one) extended it.
+bool HashCache::remap_locked()
+{
+    struct stat st;
+    if (::fstat(fd_, &st) != 0) return false;
+    const int64_t size = static_cast<int64_t>(st.st_size);
+    if (size == mapped_ && map_) return true;
+
+    if (map_) ::munmap(map_, static_cast<size_t>(mapped_));
+    map_ = nullptr;
+    mapped_ = 0;
+    if (size == 0) return true;
+
+    void* base = ::mmap(nullptr, static_cast<size_t>(size), PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (base == MAP_FAILED) {
+        log_message("Piece hash cache: mmap failed: " + error_text(errno), LogLevel::WARNING);
+        return false;
+    }
+    map_ = static_cast<char*>(base);
+    mapped_ = size;
+    return true;
+}
+
+// Indexes records appended since the last scan. Stops at the first record
+// that is incomplete or fails its checksum: either a writer is still busy
+// there or a crash left it torn, and the next writer truncates it.
+void HashCache::scan_locked()
+{
+    int64_t offset = scanned_;
+    while (offset + static_cast<int64_t>(sizeof(RecordHeader)) <= mapped_) {
+        RecordHeader header;
+        std::memcpy(&header, map_ + offset, sizeof(header));
+        if (header.magic != record_magic) break;
+        const int64_t size = record_size(header.size);
+        if (offset + size > mapped_) break;
+        if (checksum(header.key, header.size, map_ + offset + sizeof(RecordHeader)) != header.checksum) break;
+
+        Key key;
+        std::memcpy(key.data(), header.key, sizeof(header.key));
+        index_[key] = offset;
+        offset += size;
+    }
+    scanned_ = offset;
+}
+
+// After another process compacted the cache, the path names a new file.
+bool HashCache::reopen_if_replaced_locked()
+{
+    struct stat st;
+    if (::stat(path_.c_str(), &st) != 0) return false;
+    if (static_cast<uint64_t>(st.st_ino) == inode_ && fd_ >= 0) return true;
+    close_locked();
+    return open_locked();
+}
+
+bool HashCache::lookup(const Key& key, std::vector<char>& payload)
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (fd_ < 0) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        // Pick up records other processes added since the last look
+        if (reopen_if_replaced_locked() && remap_locked()) {
+            scan_locked();
+            it = index_.find(key);
+        }
+        if (it == index_.end()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+
+    char* record = map_ + it->second;
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    payload.assign(record + sizeof(RecordHeader), record + sizeof(RecordHeader) + header.size);
+
+    const int64_t stamp = now_ns();
+    std::memcpy(record + offsetof(RecordHeader, last_used), &stamp, sizeof(stamp));
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void HashCache::store(const Key& key, const char* data, size_t size)
+{
+    if (static_cast<int64_t>(size) > max_bytes_ / 4 || size > UINT32_MAX) return;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    FileLock lock(path_);
+    if (!lock.held() || !reopen_if_replaced_locked() || !remap_locked()) return;
+    scan_locked();
+
+    // Drop a torn tail; no other writer can be mid-append while we hold the lock.
+    if (scanned_ < mapped_ && ::ftruncate(fd_, scanned_) != 0) return;
+
+    RecordHeader header{};
+    header.magic = record_magic;
+    header.size = static_cast<uint32_t>(size);
+    std::memcpy(header.key, key.data(), sizeof(header.key));
+    header.last_used = now_ns();
+    header.checksum = checksum(header.key, header.size, data);
+
+    std::vector<char> record(static_cast<size_t>(record_size(header.size)), '\0');
+    std::memcpy(record.data(), &header, sizeof(header));
+    std::memcpy(record.data() + sizeof(header), data, size);
+    const ssize_t written = ::pwrite(fd_, record.data(), record.size(), scanned_);
+    if (written != static_cast<ssize_t>(record.size())) {
+        log_message("Piece hash cache: write failed: " + error_text(errno), LogLevel::WARNING);
+        if (::ftruncate(fd_, scanned_) != 0) return;
+        remap_locked();
+        return;
+    }
+    if (!remap_locked()) return;
+    scan_locked();
+
+    if (mapped_ > max_bytes_) {
+        compact_locked();
+    }
+}
+
+// Rewrites the cache with the most recently used records, filling it to
+// three quarters of the cap so compaction does not run on every store.
+void HashCache::compact_locked()
+{
+    struct Live {
+        int64_t offset;
+        int64_t last_used;
+    };
+    std::vector<Live> live;
+    live.reserve(index_.size());
+    for (const auto& [key, offset] : index_) {
+        int64_t last_used;
+        std::memcpy(&last_used, map_ + offset + offsetof(RecordHeader, last_used), sizeof(last_used));
+        live.push_back({offset, last_used});
+    }
+    std::sort(live.begin(), live.end(), [](const Live& a, const Live& b) { return a.last_used > b.last_used; });
+
+    const fs::path tmp_path = path_.string() + ".tmp";
+    const int tmp = ::open(tmp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (tmp < 0) return;
+
+    const int64_t target = max_bytes_ / 4 * 3;
+    int64_t out = file_header_size;
+    size_t kept = 0;
+    bool ok = ::pwrite(tmp, map_, file_header_size, 0) == file_header_size;
+    for (const Live& rec : live) {
+        if (!ok) break;
+        RecordHeader header;
+        std::memcpy(&header, map_ + rec.offset, sizeof(header));
+        const int64_t size = record_size(header.size);
+        if (out + size > target) break;
+        ok = ::pwrite(tmp, map_ + rec.offset, static_cast<size_t>(size), out) == size;
+        out += size;
+        ++kept;
+    }
+    ::close(tmp);
+
+    std::error_code ec;
+    if (ok) fs::rename(tmp_path, path_, ec);
+    if (!ok || ec) {
+        fs::remove(tmp_path, ec);
+        log_message("Piece hash cache: compaction failed", LogLevel::WARNING);
+        return;
+    }
+
+    log_message("Piece hash cache: evicted " + std::to_string(live.size() - kept) + " least recently used record(s)",
+                LogLevel::INFO);
+    close_locked();
+    if (!open_locked()) close_locked();
+}
+
+size_t HashCache::entries() const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return index_.size();
+}
+
+int64_t HashCache::file_size() const
+{
+    std::lock_guard<std::mutex> guard(mutex_);
+    return mapped_;
+}
+
+#endif
@@ -0,0 +1,134 @@
+#include "hash_executor.hpp"
+#include "logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <string>
+
+namespace
+{
+
+std::atomic<int> configured_threads{0};
+std::atomic<bool> shared_started{false};
+
+int default_thread_count()
+{
+    if (int configured = configured_threads.load(); configured > 0) return configured;
+    if (const char* e = std::getenv("TB_HASH_THREADS"); e && *e) {
+        const long threads = std::strtol(e, nullptr, 10);
+        if (threads > 0) return static_cast<int>(threads);
+        log_message("Ignoring invalid TB_HASH_THREADS: " + std::string(e), LogLevel::WARNING);
+    }
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+}
+
+void HashExecutor::Group::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(executor_.mutex_);
+        tasks_.push_back(std::move(task));
+        ++outstanding_;
+        if (!listed_) {
+            listed_ = true;
+            executor_.ready_.push_back(this);
+        }
+    }
+    executor_.cv_.notify_one();
+}
+
+void HashExecutor::Group::wait()
+{
+    std::unique_lock<std::mutex> lock(executor_.mutex_);
+    done_.wait(lock, [this] { return outstanding_ == 0; });
+}
+
+HashExecutor::Group::~Group()
+{
+    wait();
+}
+
+HashExecutor::HashExecutor(int threads)
+{
+    threads = std::max(1, threads);
+    threads_.reserve(threads);
+    for (int i = 0; i < threads; ++i) {
+        threads_.emplace_back([this]() { run(); });
+    }
+}
+
+HashExecutor::~HashExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+HashExecutor& HashExecutor::shared()
+{
+    static HashExecutor instance([] {
+        shared_started.store(true);
+        const int threads = default_thread_count();
+        log_message("Hashing executor: " + std::to_string(threads) + " thread(s)", LogLevel::INFO);
+        return threads;
+    }());
+    return instance;
+}
+
+void HashExecutor::set_default_threads(int threads)
+{
+    if (shared_started.load()) {
+        log_message("Hashing executor already running; thread budget unchanged", LogLevel::WARNING);
+        return;
+    }
+    configured_threads.store(std::max(0, threads));
+}
+
+std::unique_ptr<HashExecutor::Group> HashExecutor::make_group()
+{
+    return std::unique_ptr<Group>(new Group(*this));
+}
+
+// Takes one task from the group at the front of the ready list and moves the
+// group to the back while it still has work, so groups alternate task by task.
+void HashExecutor::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+        if (ready_.empty()) return;
+
+        Group* group = ready_.front();
+        ready_.pop_front();
+        std::function<void()> task = std::move(group->tasks_.front());
+        group->tasks_.pop_front();
+        if (group->tasks_.empty()) {
+            group->listed_ = false;
+        } else {
+            ready_.push_back(group);
+        }
+
+        lock.unlock();
+        try {
+            task();
+        } catch (const std::exception& e) {
+            log_message(std::string("Hashing task failed: ") + e.what(), LogLevel::ERR);
+        } catch (...) {
+            log_message("Hashing task failed", LogLevel::ERR);
+        }
+        task = nullptr;
+        lock.lock();
+
+        if (--group->outstanding_ == 0) {
+            group->done_.notify_all();
+        }
+    }
+}
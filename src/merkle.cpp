@@ -0,0 +1,108 @@
+#include "merkle.hpp"
+#include "hash_backend.hpp"
+#include <libtorrent/hasher.hpp>
+
+#include <algorithm>
+
+namespace
+{
+
+lt::sha256_hash hash_pair(const lt::sha256_hash& left, const lt::sha256_hash& right)
+{
+    lt::hasher256 h;
+    h.update(left.data(), static_cast<int>(left.size()));
+    h.update(right.data(), static_cast<int>(right.size()));
+    return h.final();
+}
+
+// Hashes the pairs in[2i], in[2i+1] into out[i]. Siblings are adjacent in
+// memory, so each pair is one 64-byte message and a level goes to the hash
+// backend in batches. In place (in == out) is safe: a batch is read before it
+// is written, and output i never lands on an input of a later batch.
+static_assert(sizeof(lt::sha256_hash) == 32, "sibling hashes must be contiguous");
+
+void reduce_pairs(const lt::sha256_hash* in, lt::sha256_hash* out, size_t count)
+{
+    constexpr size_t batch = 64;
+    HashInput inputs[batch];
+    lt::sha256_hash digests[batch];
+    for (size_t i = 0; i < count; i += batch) {
+        const size_t n = std::min(batch, count - i);
+        for (size_t j = 0; j < n; ++j) {
+            inputs[j] = {in[2 * (i + j)].data(), 2 * static_cast<int64_t>(sizeof(lt::sha256_hash))};
+        }
+        hash_backend::sha256(inputs, digests, static_cast<int>(n));
+        std::copy(digests, digests + n, out + i);
+    }
+}
+
+} // namespace
+
+namespace merkle
+{
+
+int num_leafs(int blocks)
+{
+    int leafs = 1;
+    while (leafs < blocks) leafs *= 2;
+    return leafs;
+}
+
+lt::sha256_hash pad_hash(int num_leafs)
+{
+    lt::sha256_hash pad;
+    for (int width = num_leafs; width > 1; width /= 2) {
+        pad = hash_pair(pad, pad);
+    }
+    return pad;
+}
+
+lt::sha256_hash root(std::vector<lt::sha256_hash> nodes, int width, const lt::sha256_hash& pad)
+{
+    if (nodes.empty()) return lt::sha256_hash();
+
+    lt::sha256_hash level_pad = pad;
+    size_t count = nodes.size();
+    while (width > 1) {
+        // Only the populated prefix is reduced; an odd tail pairs with the pad.
+        if (count % 2 == 1) {
+            nodes.resize(count + 1);
+            nodes[count] = level_pad;
+            ++count;
+        }
+        const size_t out = count / 2;
+        reduce_pairs(nodes.data(), nodes.data(), out);
+        nodes.resize(out);
+        count = out;
+        level_pad = hash_pair(level_pad, level_pad);
+        width /= 2;
+    }
+    return nodes.front();
+}
+
+lt::sha256_hash piece_root(const char* data, int len, int num_leafs)
+{
+    const int blocks = (len + block_size - 1) / block_size;
+    std::vector<HashInput> inputs(blocks);
+    for (int b = 0; b < blocks; ++b) {
+        inputs[b] = {data + static_cast<int64_t>(b) * block_size, std::min(block_size, len - b * block_size)};
+    }
+    std::vector<lt::sha256_hash> leaves(blocks);
+    hash_backend::sha256(inputs.data(), leaves.data(), blocks);
+    return root(std::move(leaves), num_leafs);
+}
+
+int piece_leafs(int64_t file_size, int piece_length)
+{
+    if (file_size > piece_length) return piece_length / block_size;
+    return num_leafs(static_cast<int>((file_size + block_size - 1) / block_size));
+}
+
+lt::sha256_hash layer_root(std::vector<lt::sha256_hash> piece_layer, int piece_length)
+{
+    if (piece_layer.size() <= 1) return piece_layer.empty() ? lt::sha256_hash() : piece_layer.front();
+    const int width = num_leafs(static_cast<int>(piece_layer.size()));
+    return root(std::move(piece_layer), width, pad_hash(piece_length / block_size));
+}
+
+} // namespace merkle
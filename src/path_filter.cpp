@@ -0,0 +1,278 @@
+#include "path_filter.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdint>
+
+namespace
+{
+
+// One glob token. Each token owns the NFA state in front of it ('**/' owns
+// two); a pattern's last state accepts.
+enum class TokenKind {
+    LITERAL,       // one byte (both cases for ASCII letters)
+    ONE,           // '?': one byte other than '/'
+    STAR,          // '*': zero or more bytes other than '/'
+    DOUBLE_STAR,   // '**': zero or more bytes other than line breaks
+    LEADING_DIRS   // '**/': empty, or bytes ending in '/'
+};
+
+struct Token {
+    TokenKind kind;
+    char literal;
+};
+
+// Tokenizes exactly like utils::glob_to_regex scans its input.
+std::vector<Token> tokenize(const std::string& pattern)
+{
+    std::vector<Token> tokens;
+    size_t i = 0;
+    while (i < pattern.size()) {
+        const char c = pattern[i];
+        if (c == '*' && i + 1 < pattern.size() && pattern[i + 1] == '*') {
+            if (i + 2 < pattern.size() && pattern[i + 2] == '/') {
+                tokens.push_back({TokenKind::LEADING_DIRS, 0});
+                i += 3;
+            } else {
+                tokens.push_back({TokenKind::DOUBLE_STAR, 0});
+                i += 2;
+            }
+        } else if (c == '*') {
+            tokens.push_back({TokenKind::STAR, 0});
+            ++i;
+        } else if (c == '?') {
+            tokens.push_back({TokenKind::ONE, 0});
+            ++i;
+        } else {
+            tokens.push_back({TokenKind::LITERAL, c});
+            ++i;
+        }
+    }
+    return tokens;
+}
+
+// std::regex's ECMAScript '.' (which glob_to_regex emits for '**') does not
+// match line terminators; '[^/]' does.
+bool any_char(unsigned char b) { return b != '\n' && b != '\r'; }
+bool not_slash(unsigned char b) { return b != '/'; }
+
+}
+
+// State sets are bit vectors of `words` 64-bit words. For each input byte,
+// states whose token consumes it move one bit up (`step`), looping tokens
+// keep their bit (`loop`), and the result is closed over tokens that may
+// match nothing: `skip1` moves a bit up by one state, `skip2` by two (the
+// empty branch of '**/', which jumps over its inner looping state).
+struct PathFilter::Automaton {
+    size_t words = 0;
+    int max_skip_run = 0;
+    std::vector<uint64_t> start;
+    std::vector<uint64_t> step;  // 256 * words
+    std::vector<uint64_t> loop;  // 256 * words
+    std::vector<uint64_t> skip1;
+    std::vector<uint64_t> skip2;
+    std::vector<uint64_t> exclude_accept;
+    std::vector<uint64_t> include_accept;
+
+    static void set(std::vector<uint64_t>& bits, size_t offset, size_t state)
+    {
+        bits[offset + state / 64] |= uint64_t{1} << (state % 64);
+    }
+
+    void close_over_skips(uint64_t* s) const
+    {
+        for (int run = 0; run < max_skip_run; ++run) {
+            uint64_t carry1 = 0;
+            uint64_t carry2 = 0;
+            bool changed = false;
+            for (size_t w = 0; w < words; ++w) {
+                const uint64_t by1 = s[w] & skip1[w];
+                const uint64_t by2 = s[w] & skip2[w];
+                const uint64_t add = (by1 << 1) | carry1 | (by2 << 2) | carry2;
+                carry1 = by1 >> 63;
+                carry2 = by2 >> 62;
+                changed |= (add & ~s[w]) != 0;
+                s[w] |= add;
+            }
+            if (!changed) break;
+        }
+    }
+
+    // Advances `s` by one byte in place; returns false once no state is alive.
+    bool advance(uint64_t* s, unsigned char byte) const
+    {
+        const uint64_t* st = step.data() + byte * words;
+        const uint64_t* lp = loop.data() + byte * words;
+        uint64_t carry = 0;
+        uint64_t alive = 0;
+        for (size_t w = 0; w < words; ++w) {
+            const uint64_t moving = s[w] & st[w];
+            const uint64_t next = (moving << 1) | carry | (s[w] & lp[w]);
+            carry = moving >> 63;
+            s[w] = next;
+            alive |= next;
+        }
+        if (alive == 0) return false;
+        close_over_skips(s);
+        return true;
+    }
+
+    static bool any(const uint64_t* s, const std::vector<uint64_t>& mask)
+    {
+        for (size_t w = 0; w < mask.size(); ++w) {
+            if (s[w] & mask[w]) return true;
+        }
+        return false;
+    }
+};
+
+namespace
+{
+
+// Small state sets live on the stack; only very large pattern lists allocate.
+class StateSet
+{
+public:
+    explicit StateSet(const std::vector<uint64_t>& start)
+    {
+        if (start.size() > inline_words) {
+            heap_.assign(start.begin(), start.end());
+            data_ = heap_.data();
+        } else {
+            std::copy(start.begin(), start.end(), inline_.begin());
+            data_ = inline_.data();
+        }
+    }
+
+    uint64_t* data() { return data_; }
+
+private:
+    static constexpr size_t inline_words = 16;
+    std::array<uint64_t, inline_words> inline_{};
+    std::vector<uint64_t> heap_;
+    uint64_t* data_;
+};
+
+}
+
+PathFilter::PathFilter()
+    : PathFilter({}, {})
+{
+}
+
+PathFilter::PathFilter(std::vector<std::string> exclude_patterns, std::vector<std::string> include_patterns)
+    : exclude_patterns_(std::move(exclude_patterns)),
+      include_patterns_(std::move(include_patterns))
+{
+    std::vector<std::vector<Token>> compiled;
+    size_t states = 0;
+    for (const auto* list : {&exclude_patterns_, &include_patterns_}) {
+        for (const auto& p : *list) {
+            compiled.push_back(tokenize(p));
+            states += compiled.back().size() + 1;
+            states += static_cast<size_t>(std::count_if(compiled.back().begin(), compiled.back().end(),
+                [](const Token& t) { return t.kind == TokenKind::LEADING_DIRS; }));
+        }
+    }
+
+    auto a = std::make_shared<Automaton>();
+    a->words = std::max<size_t>(1, (states + 63) / 64);
+    a->start.assign(a->words, 0);
+    a->step.assign(256 * a->words, 0);
+    a->loop.assign(256 * a->words, 0);
+    a->skip1.assign(a->words, 0);
+    a->skip2.assign(a->words, 0);
+    a->exclude_accept.assign(a->words, 0);
+    a->include_accept.assign(a->words, 0);
+
+    size_t state = 0;
+    for (size_t p = 0; p < compiled.size(); ++p) {
+        Automaton::set(a->start, 0, state);
+        int skip_run = 0;
+        for (const Token& t : compiled[p]) {
+            if (t.kind == TokenKind::LEADING_DIRS) {
+                // (?:.*/)? as an entry state that either skips the group or
+                // enters an inner state looping on any byte until a '/' leaves.
+                Automaton::set(a->skip1, 0, state);
+                Automaton::set(a->skip2, 0, state);
+                for (int b = 0; b < 256; ++b) {
+                    const auto byte = static_cast<unsigned char>(b);
+                    if (any_char(byte)) Automaton::set(a->loop, b * a->words, state + 1);
+                    if (byte == '/') Automaton::set(a->step, b * a->words, state + 1);
+                }
+                a->max_skip_run = std::max(a->max_skip_run, ++skip_run);
+                state += 2;
+                continue;
+            }
+            for (int b = 0; b < 256; ++b) {
+                const auto byte = static_cast<unsigned char>(b);
+                bool steps = false;
+                bool loops = false;
+                switch (t.kind) {
+                    case TokenKind::LITERAL:
+                        steps = std::tolower(byte) == std::tolower(static_cast<unsigned char>(t.literal));
+                        break;
+                    case TokenKind::ONE:
+                        steps = not_slash(byte);
+                        break;
+                    case TokenKind::STAR:
+                        loops = not_slash(byte);
+                        break;
+                    case TokenKind::DOUBLE_STAR:
+                        loops = any_char(byte);
+                        break;
+                    case TokenKind::LEADING_DIRS:
+                        break;
+                }
+                if (steps) Automaton::set(a->step, b * a->words, state);
+                if (loops) Automaton::set(a->loop, b * a->words, state);
+            }
+            if (t.kind == TokenKind::STAR || t.kind == TokenKind::DOUBLE_STAR) {
+                Automaton::set(a->skip1, 0, state);
+                a->max_skip_run = std::max(a->max_skip_run, ++skip_run);
+            } else {
+                skip_run = 0;
+            }
+            ++state;
+        }
+        Automaton::set(p < exclude_patterns_.size() ? a->exclude_accept : a->include_accept, 0, state);
+        ++state;
+    }
+
+    a->close_over_skips(a->start.data());
+    automaton_ = std::move(a);
+}
+
+bool PathFilter::should_include_file(std::string_view relative_path) const
+{
+    if (empty()) return true;
+
+    const Automaton& a = *automaton_;
+    StateSet s(a.start);
+    for (char c : relative_path) {
+        if (!a.advance(s.data(), static_cast<unsigned char>(c))) {
+            // No pattern can match any more: nothing includes, nothing excludes.
+            return include_patterns_.empty();
+        }
+    }
+
+    if (!include_patterns_.empty()) {
+        return Automaton::any(s.data(), a.include_accept);
+    }
+    return !Automaton::any(s.data(), a.exclude_accept);
+}
+
+bool PathFilter::should_prune_directory(std::string_view relative_path) const
+{
+    if (!include_patterns_.empty() || exclude_patterns_.empty()) return false;
+
+    const Automaton& a = *automaton_;
+    StateSet s(a.start);
+    for (char c : relative_path) {
+        if (!a.advance(s.data(), static_cast<unsigned char>(c))) return false;
+    }
+    // "dir" and then "dir/" in the same pass.
+    if (Automaton::any(s.data(), a.exclude_accept)) return true;
+    return a.advance(s.data(), '/') && Automaton::any(s.data(), a.exclude_accept);
+}
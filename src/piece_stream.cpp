@@ -0,0 +1,701 @@
+#include "piece_stream.hpp"
+#include "content_reader.hpp"
+#include "logger.hpp"
+#include <libtorrent/file_storage.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <list>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define TB_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+std::string error_text(int err)
+{
+    return std::system_category().message(err);
+}
+
+// Records a range that could not be read: zero-filled so hashes stay deterministic.
+void mark_missing(StreamPiece* piece, char* dst, int64_t len, const std::string& error)
+{
+    std::memset(dst, 0, static_cast<size_t>(len));
+    piece->missing += len;
+    if (piece->error.empty()) piece->error = error;
+}
+
+// Bytes of consecutive pieces a synchronous reader claims at a time.
+constexpr int64_t sequential_run_bytes = 8 * 1024 * 1024;
+
+// Files one synchronous reader keeps open; the least recently used is closed first.
+constexpr size_t reader_open_files = 16;
+
+// Open files of one reader thread, with their open errors, in LRU order. A
+// file is opened once however many pieces and prefetches touch it while it
+// stays among the most recently used.
+class ReaderFiles
+{
+public:
+    explicit ReaderFiles(const std::vector<fs::path>& paths) : paths_(paths) {}
+
+    // Reader for @p file, or null with @p error set if it could not be opened
+    ContentReader* get(int file, std::string& error)
+    {
+        auto it = index_.find(file);
+        if (it != index_.end()) {
+            entries_.splice(entries_.begin(), entries_, it->second);
+        } else {
+            if (entries_.size() >= reader_open_files) {
+                index_.erase(entries_.back().file);
+                entries_.pop_back();
+            }
+            Entry entry{file, nullptr, {}};
+            try {
+                entry.reader = ContentReader::open(paths_[file]);
+            } catch (const std::exception& e) {
+                entry.error = e.what();
+            }
+            entries_.push_front(std::move(entry));
+            index_[file] = entries_.begin();
+        }
+        error = entries_.front().error;
+        return entries_.front().reader.get();
+    }
+
+    // Hint the ranges of @p spans to the kernel, merging adjacent ones. Only
+    // the first half of the cache's worth of files is touched, so prefetching
+    // a run of many small files does not evict the ones about to be read.
+    void prefetch(const std::vector<ReadSpan>& spans)
+    {
+        size_t opened = 0;
+        for (size_t i = 0; i < spans.size() && opened < reader_open_files / 2;) {
+            const ReadSpan& first = spans[i];
+            int64_t end = first.offset + first.length;
+            size_t j = i + 1;
+            while (j < spans.size() && spans[j].file == first.file && spans[j].offset == end) {
+                end += spans[j++].length;
+            }
+            if (first.file >= 0) {
+                std::string error;
+                if (ContentReader* file = get(first.file, error)) {
+                    file->prefetch(first.offset, end - first.offset);
+                }
+                ++opened;
+            }
+            i = j;
+        }
+    }
+
+private:
+    struct Entry {
+        int file;
+        std::unique_ptr<ContentReader> reader;
+        std::string error;
+    };
+
+    const std::vector<fs::path>& paths_;
+    std::list<Entry> entries_;  // Most recently used first
+    std::unordered_map<int, std::list<Entry>::iterator> index_;
+};
+
+#ifdef TB_HAVE_IO_URING
+
+// Minimal io_uring wrapper over the raw syscalls, so no liburing dependency is needed.
+class Uring
+{
+public:
+    ~Uring()
+    {
+        if (sqes_) ::munmap(sqes_, sqes_size_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_) ::munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_) ::munmap(sq_ptr_, sq_size_);
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    bool init(unsigned entries)
+    {
+        io_uring_params p{};
+        fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+        if (fd_ < 0) return false;
+
+        sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single_mmap) sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+
+        sq_ptr_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+        if (sq_ptr_ == MAP_FAILED) { sq_ptr_ = nullptr; return false; }
+        if (single_mmap) {
+            cq_ptr_ = sq_ptr_;
+        } else {
+            cq_ptr_ = ::mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+            if (cq_ptr_ == MAP_FAILED) { cq_ptr_ = nullptr; return false; }
+        }
+        sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED) return false;
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+        auto* sq = static_cast<char*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+        auto* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+        entries_ = p.sq_entries;
+        sqe_tail_ = *sq_tail_;
+        return true;
+    }
+
+    // Pins the buffers for IORING_OP_READ_FIXED; fails under a low RLIMIT_MEMLOCK.
+    bool register_buffers(const std::vector<iovec>& iovecs)
+    {
+        return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+                         iovecs.data(), static_cast<unsigned>(iovecs.size())) == 0;
+    }
+
+    unsigned entries() const { return entries_; }
+
+    // Next free submission slot, or nullptr when the queue is full.
+    io_uring_sqe* get_sqe()
+    {
+        unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if (sqe_tail_ - head >= entries_) return nullptr;
+        unsigned idx = sqe_tail_ & sq_mask_;
+        sq_array_[idx] = idx;
+        ++sqe_tail_;
+        io_uring_sqe* sqe = &sqes_[idx];
+        std::memset(sqe, 0, sizeof(*sqe));
+        return sqe;
+    }
+
+    // Submits queued entries and waits for at least `wait_nr` completions.
+    int submit_and_wait(unsigned wait_nr)
+    {
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+        for (;;) {
+            unsigned to_submit = sqe_tail_ - submitted_;
+            long ret = ::syscall(__NR_io_uring_enter, fd_, to_submit, wait_nr,
+                                 wait_nr ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+            if (ret >= 0) {
+                submitted_ += static_cast<unsigned>(ret);
+                return 0;
+            }
+            if (errno != EINTR) return -errno;
+        }
+    }
+
+    // Takes back the entries queued since the last successful submit, which
+    // the kernel has not seen, passing each one's user data to `handle`.
+    template <typename F>
+    void withdraw(F&& handle)
+    {
+        while (sqe_tail_ != submitted_) {
+            --sqe_tail_;
+            handle(sqes_[sqe_tail_ & sq_mask_].user_data);
+        }
+        __atomic_store_n(sq_tail_, sqe_tail_, __ATOMIC_RELEASE);
+    }
+
+    template <typename F>
+    void reap(F&& handle)
+    {
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        while (head != tail) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            handle(cqe.user_data, cqe.res);
+            ++head;
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    size_t sqes_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned cq_mask_ = 0;
+    unsigned entries_ = 0;
+    unsigned sqe_tail_ = 0;
+    unsigned submitted_ = 0;
+};
+
+// One read of a span (or the unread remainder of a span after a short completion).
+struct UringRequest
+{
+    StreamPiece* piece;
+    int file;
+    int64_t offset;
+    char* dst;
+    int64_t len;
+    iovec iov;
+};
+
+#endif
+
+} // namespace
+
+PieceStream::PieceStream(std::vector<fs::path> files, int num_pieces, Layout layout,
+                         int buffer_size, int buffer_count)
+    : files_(std::move(files)), num_pieces_(num_pieces), layout_(std::move(layout))
+{
+    buffer_count = std::max(1, buffer_count);
+    buffers_.reserve(buffer_count);
+    for (int i = 0; i < buffer_count; ++i) {
+        buffers_.push_back(std::make_unique<StreamPiece>());
+        buffers_.back()->data.resize(buffer_size);
+        buffers_.back()->buffer_index = i;
+        free_.push_back(buffers_.back().get());
+    }
+}
+
+PieceStream::~PieceStream() = default;
+
+std::unique_ptr<PieceStream> PieceStream::for_storage(const lt::file_storage& files,
+                                                      const std::string& save_path,
+                                                      int buffer_count,
+                                                      std::vector<int> pieces)
+{
+    std::vector<fs::path> paths;
+    paths.reserve(files.num_files());
+    for (lt::file_index_t i : files.file_range()) {
+        paths.emplace_back(files.pad_file_at(i) ? std::string() : files.file_path(i, save_path));
+    }
+
+    const int count = pieces.empty() ? files.num_pieces() : static_cast<int>(pieces.size());
+    auto layout = [&files, pieces = std::move(pieces)](int piece, std::vector<ReadSpan>& spans) {
+        const lt::piece_index_t p(pieces.empty() ? piece : pieces[piece]);
+        const int size = files.piece_size(p);
+        for (const auto& slice : files.map_block(p, 0, size)) {
+            int file = files.pad_file_at(slice.file_index) ? -1 : static_cast<int>(slice.file_index);
+            spans.push_back({file, slice.offset, slice.size});
+        }
+        return size;
+    };
+
+    return std::make_unique<PieceStream>(std::move(paths), count, std::move(layout),
+                                         files.piece_length(), buffer_count);
+}
+
+bool PieceStream::async_available()
+{
+#ifdef TB_HAVE_IO_URING
+    static const bool available = [] {
+        if (const char* e = std::getenv("TB_NO_IO_URING")) {
+            if (*e && std::string(e) != "0") return false;
+        }
+        Uring probe;
+        return probe.init(4);
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+StreamPiece* PieceStream::acquire(const std::atomic<bool>& cancel, bool wait)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (free_.empty()) {
+        if (!wait || cancel.load()) return nullptr;
+        // Cancellation is only signalled through the flag, so poll it while waiting
+        cv_.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    StreamPiece* piece = free_.back();
+    free_.pop_back();
+    return piece;
+}
+
+void PieceStream::release(StreamPiece* piece)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(piece);
+    }
+    cv_.notify_one();
+}
+
+void PieceStream::prepare(StreamPiece* piece, int index, std::vector<ReadSpan>& spans)
+{
+    spans.clear();
+    piece->index = index;
+    piece->size = layout_(index, spans);
+    piece->missing = 0;
+    piece->error.clear();
+    piece->pending.store(0);
+    piece->spans_left = 0;
+
+    int64_t pos = 0;
+    for (const auto& span : spans) {
+        if (span.file < 0) {
+            std::memset(piece->data.data() + pos, 0, static_cast<size_t>(span.length));
+        } else {
+            ++piece->spans_left;
+        }
+        pos += span.length;
+    }
+}
+
+void PieceStream::run(const std::function<void(StreamPiece*)>& on_ready, const std::atomic<bool>& cancel,
+                      int sync_readers)
+{
+    used_async_ = false;
+    peak_inflight_ = 0;
+    if (allow_async_ && async_available() && run_async(on_ready, cancel)) {
+        used_async_ = true;
+        return;
+    }
+    run_sync(on_ready, cancel, sync_readers);
+}
+
+void PieceStream::run_sync(const std::function<void(StreamPiece*)>& on_ready, const std::atomic<bool>& cancel,
+                           int readers)
+{
+    readers = std::max(1, std::min({readers, num_pieces_, static_cast<int>(buffers_.size())}));
+
+    // Each reader claims a run of consecutive pieces, so every descriptor
+    // sees front-to-back reads (which kernel read-ahead follows) instead of
+    // every readers-th piece; runs leave enough buffers for the other readers.
+    const int64_t buffer_size = std::max<int64_t>(1, static_cast<int64_t>(buffers_.front()->data.size()));
+    const int max_run = std::max(1, static_cast<int>(buffers_.size()) / (2 * readers));
+    const int run_length = static_cast<int>(std::clamp<int64_t>(sequential_run_bytes / buffer_size, 1, max_run));
+    std::atomic<int> next_run{0};
+
+    auto reader = [&]() {
+        std::vector<ReadSpan> spans;
+        std::vector<ReadSpan> run_spans;
+        ReaderFiles files(files_);
+        int p = 0;
+        int run_end = 0;
+
+        while (!cancel.load()) {
+            StreamPiece* piece = acquire(cancel, true);
+            if (!piece) break;
+
+            if (p >= run_end) {
+                p = next_run.fetch_add(run_length);
+                if (p >= num_pieces_) {
+                    release(piece);
+                    break;
+                }
+                run_end = std::min(p + run_length, num_pieces_);
+
+                // Start the kernel on the rest of the run while this piece is read
+                run_spans.clear();
+                for (int q = p; q < run_end; ++q) layout_(q, run_spans);
+                files.prefetch(run_spans);
+            }
+
+            prepare(piece, p++, spans);
+            int64_t pos = 0;
+            for (const auto& span : spans) {
+                char* dst = piece->data.data() + pos;
+                pos += span.length;
+                if (span.file < 0) continue;
+
+                std::string open_error;
+                ContentReader* file = files.get(span.file, open_error);
+                if (!file) {
+                    mark_missing(piece, dst, span.length, open_error);
+                    continue;
+                }
+
+                int64_t got = 0;
+                std::string read_error;
+                try {
+                    got = file->read(span.offset, dst, span.length);
+                } catch (const std::exception& e) {
+                    read_error = e.what();
+                }
+                if (got < span.length) {
+                    mark_missing(piece, dst + got, span.length - got,
+                                 read_error.empty() ? "Short read: " + files_[span.file].string() : read_error);
+                }
+            }
+
+            if (cancel.load()) {
+                release(piece);
+                break;
+            }
+            on_ready(piece);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(readers);
+    for (int i = 0; i < readers; ++i) {
+        threads.emplace_back(reader);
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+bool PieceStream::run_async(const std::function<void(StreamPiece*)>& on_ready, const std::atomic<bool>& cancel)
+{
+#ifdef TB_HAVE_IO_URING
+    // Enough submission slots for every buffer plus pieces that span several files
+    unsigned entries = 32;
+    while (entries < std::min<size_t>(buffers_.size() * 2, 1024)) entries *= 2;
+
+    Uring ring;
+    if (!ring.init(entries)) {
+        log_message("io_uring setup failed, using synchronous reads", LogLevel::INFO);
+        return false;
+    }
+
+    std::vector<iovec> iovecs;
+    iovecs.reserve(buffers_.size());
+    for (const auto& buffer : buffers_) {
+        iovecs.push_back({buffer->data.data(), buffer->data.size()});
+    }
+    const bool fixed = ring.register_buffers(iovecs);
+    log_message(std::string("Reading with io_uring (") + std::to_string(ring.entries()) + " entries, "
+                    + (fixed ? "fixed" : "unregistered") + " buffers)", LogLevel::INFO);
+
+    struct OpenFile { int fd; int refs; std::string error; };
+    std::unordered_map<int, OpenFile> open_files;
+    std::deque<std::unique_ptr<UringRequest>> backlog;
+    std::vector<ReadSpan> spans;
+    unsigned inflight = 0;
+    int next_piece = 0;
+
+    // Delivers a piece once its last span finished; after cancel the buffer just goes back.
+    auto span_done = [&](StreamPiece* piece) {
+        if (--piece->spans_left == 0) {
+            if (cancel.load()) release(piece);
+            else on_ready(piece);
+        }
+    };
+
+    auto finish_request = [&](std::unique_ptr<UringRequest> req) {
+        auto it = open_files.find(req->file);
+        if (it != open_files.end()) --it->second.refs;
+        span_done(req->piece);
+    };
+
+    // Files behind the lowest file still needed are closed once idle, which bounds
+    // descriptor usage for storages with many small files.
+    auto close_idle_files = [&](int lowest_needed) {
+        for (auto it = open_files.begin(); it != open_files.end();) {
+            if (it->first < lowest_needed && it->second.refs == 0) {
+                if (it->second.fd >= 0) ::close(it->second.fd);
+                it = open_files.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    };
+
+    auto open_file = [&](int file) -> OpenFile& {
+        auto it = open_files.find(file);
+        if (it == open_files.end()) {
+            int fd = ::open(files_[file].c_str(), O_RDONLY | O_CLOEXEC);
+            std::string error = fd < 0 ? "Failed to open file: " + files_[file].string() + ": " + error_text(errno) : "";
+            it = open_files.emplace(file, OpenFile{fd, 0, std::move(error)}).first;
+        }
+        return it->second;
+    };
+
+    // Fails every outstanding read with `error` before the ring is given up.
+    // Requests the kernel never saw are withdrawn; the rest are cancelled where
+    // the kernel allows it and waited for, so no buffer goes back to the pool
+    // (or is freed) while a read can still land in it.
+    auto abandon = [&](const std::string& error) {
+        auto fail_request = [&](__u64 user_data) {
+            std::unique_ptr<UringRequest> req(reinterpret_cast<UringRequest*>(user_data));
+            --inflight;
+            mark_missing(req->piece, req->dst, req->len, error);
+            finish_request(std::move(req));
+        };
+        while (!backlog.empty()) {
+            auto req = std::move(backlog.front());
+            backlog.pop_front();
+            mark_missing(req->piece, req->dst, req->len, error);
+            span_done(req->piece);
+        }
+        ring.withdraw(fail_request);
+#ifdef IORING_ASYNC_CANCEL_ANY
+        if (inflight > 0) {
+            if (io_uring_sqe* sqe = ring.get_sqe()) {
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+                sqe->user_data = 0;
+                if (ring.submit_and_wait(0) < 0) ring.withdraw([](__u64) {});
+            }
+        }
+#endif
+        while (inflight > 0) {
+            // Completions are posted even while io_uring_enter keeps failing
+            if (ring.submit_and_wait(1) < 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            ring.reap([&](__u64 user_data, int) {
+                if (user_data != 0) fail_request(user_data); // 0 is the cancel request itself
+            });
+        }
+        close_idle_files(std::numeric_limits<int>::max());
+    };
+
+    // Moves queued requests into the submission queue until either runs out.
+    auto fill_queue = [&]() {
+        while (!backlog.empty()) {
+            UringRequest& front = *backlog.front();
+            OpenFile& file = open_file(front.file);
+            if (file.fd < 0) {
+                auto req = std::move(backlog.front());
+                backlog.pop_front();
+                mark_missing(req->piece, req->dst, req->len, file.error);
+                finish_request(std::move(req));
+                continue;
+            }
+
+            io_uring_sqe* sqe = ring.get_sqe();
+            if (!sqe) break;
+
+            auto req = std::move(backlog.front());
+            backlog.pop_front();
+            sqe->fd = file.fd;
+            sqe->off = static_cast<__u64>(req->offset);
+            if (fixed) {
+                sqe->opcode = IORING_OP_READ_FIXED;
+                sqe->addr = reinterpret_cast<__u64>(req->dst);
+                sqe->len = static_cast<__u32>(req->len);
+                sqe->buf_index = static_cast<__u16>(req->piece->buffer_index);
+            } else {
+                req->iov = {req->dst, static_cast<size_t>(req->len)};
+                sqe->opcode = IORING_OP_READV;
+                sqe->addr = reinterpret_cast<__u64>(&req->iov);
+                sqe->len = 1;
+            }
+            ++file.refs;
+            sqe->user_data = reinterpret_cast<__u64>(req.release());
+            ++inflight;
+        }
+    };
+
+    for (;;) {
+        // Turn free buffers into read requests until the pool or the submission
+        // queue runs dry, so every free buffer is being read before we wait.
+        // Block for a buffer only when nothing is in flight; otherwise
+        // completions are what frees buffers up.
+        while (!cancel.load()) {
+            fill_queue();
+            if (!backlog.empty() || next_piece >= num_pieces_) break;
+
+            StreamPiece* piece = acquire(cancel, inflight == 0);
+            if (!piece) break;
+
+            prepare(piece, next_piece++, spans);
+            int64_t pos = 0;
+            int lowest_file = -1;
+            for (const auto& span : spans) {
+                char* dst = piece->data.data() + pos;
+                pos += span.length;
+                if (span.file < 0) continue;
+                if (lowest_file < 0) lowest_file = span.file;
+                backlog.push_back(std::make_unique<UringRequest>(
+                    UringRequest{piece, span.file, span.offset, dst, span.length, {}}));
+            }
+            if (lowest_file >= 0) close_idle_files(lowest_file);
+            if (piece->spans_left == 0) {
+                on_ready(piece); // Only padding
+            }
+        }
+
+        if (cancel.load()) {
+            // Stop reading: requests not yet submitted are dropped
+            while (!backlog.empty()) {
+                auto req = std::move(backlog.front());
+                backlog.pop_front();
+                mark_missing(req->piece, req->dst, req->len, "Cancelled");
+                span_done(req->piece);
+            }
+        }
+        peak_inflight_ = std::max(peak_inflight_, static_cast<int>(inflight));
+
+        if (inflight == 0) {
+            if (!backlog.empty()) continue;
+            if (cancel.load() || next_piece >= num_pieces_) break;
+            continue;
+        }
+
+        int ret = ring.submit_and_wait(1);
+        if (ret < 0 && ret != -EAGAIN && ret != -EBUSY) {
+            // Unrecoverable ring error (not seen in practice): give up on the job
+            // once the kernel holds none of the buffers
+            const std::string error = "io_uring_enter failed: " + error_text(-ret);
+            log_message(error, LogLevel::ERR);
+            abandon(error);
+            throw std::runtime_error(error);
+        }
+
+        ring.reap([&](__u64 user_data, int res) {
+            std::unique_ptr<UringRequest> req(reinterpret_cast<UringRequest*>(user_data));
+            --inflight;
+            if (res == -EINTR || res == -EAGAIN) {
+                --open_files[req->file].refs;
+                backlog.push_front(std::move(req));
+                return;
+            }
+            if (res < 0) {
+                mark_missing(req->piece, req->dst, req->len,
+                             "Read error: " + files_[req->file].string() + ": " + error_text(-res));
+            } else if (res == 0) {
+                mark_missing(req->piece, req->dst, req->len, "Short read: " + files_[req->file].string());
+            } else if (res < req->len) {
+                // Partial read: queue the remainder
+                --open_files[req->file].refs;
+                req->offset += res;
+                req->dst += res;
+                req->len -= res;
+                backlog.push_front(std::move(req));
+                return;
+            }
+            finish_request(std::move(req));
+        });
+    }
+
+    close_idle_files(std::numeric_limits<int>::max());
+    return true;
+#else
+    (void)on_ready;
+    (void)cancel;
+    return false;
+#endif
+}
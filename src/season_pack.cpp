@@ -1,4 +1,5 @@
 #include "season_pack.hpp"
+#include "content_index.hpp"
 #include "logger.hpp"
 #include <regex>
 #include <algorithm>
@@ -159,44 +160,30 @@ std::vector<int> extract_multi_episodes(const std::string &filename)
 
 SeasonPackInfo analyze(const fs::path &input_path)
 {
-    SeasonPackInfo info;
-
     std::error_code ec;
     if (!fs::exists(input_path, ec) || !fs::is_directory(input_path, ec))
     {
-        return info;
+        return SeasonPackInfo();
     }
 
-    std::vector<fs::path> files;
-    bool iteration_error = false;
-    for (const auto &entry : fs::recursive_directory_iterator(input_path, ec))
-    {
-        if (ec)
-        {
-            log_message("Directory iteration error: " + ec.message(), LogLevel::WARNING);
-            iteration_error = true;
-            break;
-        }
-        if (entry.is_regular_file(ec))
-        {
-            if (ec)
-            {
-                log_message("File access error: " + ec.message(), LogLevel::WARNING);
-                ec.clear();
-                continue;
-            }
-            files.push_back(entry.path());
-        }
-    }
+    return analyze(*ContentIndex::scan(input_path));
+}
 
-    if (iteration_error && files.empty())
+SeasonPackInfo analyze(const ContentIndex &index)
+{
+    SeasonPackInfo info;
+
+    if (!index.is_directory() || index.files().empty())
     {
         return info;
     }
 
-    if (files.empty())
+    const fs::path &input_path = index.root();
+    std::vector<fs::path> files;
+    files.reserve(index.files().size());
+    for (const auto &entry : index.files())
     {
-        return info;
+        files.push_back(index.full_path(entry));
     }
 
     int season = detect_season_number(input_path.filename().string());
@@ -308,7 +295,8 @@ std::string format_missing_episodes(const std::vector<int> &missing)
 std::optional<std::string> evaluate_season_warning(
     const fs::path &input_path,
     bool fail_on_warning,
-    int job_index)
+    int job_index,
+    const ContentIndex *index)
 {
     std::error_code ec;
     bool is_dir = fs::is_directory(input_path, ec);
@@ -321,7 +309,7 @@ std::optional<std::string> evaluate_season_warning(
         return std::nullopt;
     }
 
-    SeasonPackInfo sp_info = analyze(input_path);
+    SeasonPackInfo sp_info = index ? analyze(*index) : analyze(input_path);
 
     std::string prefix;
     if (job_index >= 0)
@@ -0,0 +1,108 @@
+#include "throughput_model.hpp"
+#include "hash_cache.hpp"
+#include "logger.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace
+{
+
+// Weight of the newest measurement in the moving average
+constexpr double kSmoothing = 0.3;
+
+}
+
+ThroughputModel::ThroughputModel(fs::path path) : path_(std::move(path))
+{
+    if (path_.empty()) return;
+    std::ifstream in(path_);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string key;
+        double rate = 0;
+        if (fields >> key >> rate && rate > 0) {
+            rates_[key] = rate;
+        }
+    }
+}
+
+fs::path ThroughputModel::default_path()
+{
+    const fs::path cache = HashCache::default_path();
+    return cache.empty() ? fs::path() : cache.parent_path() / "throughput.txt";
+}
+
+std::string ThroughputModel::device_key(const StorageDevice& device)
+{
+    return device.name.empty() ? std::string() : "dev:" + device.name;
+}
+
+std::string ThroughputModel::class_key(const StorageDevice& device)
+{
+    return device.rotational ? "hdd" : "ssd";
+}
+
+double ThroughputModel::estimate_seconds(const StorageDevice& device, int64_t bytes) const
+{
+    double rate = device.rotational ? kDefaultHddBytesPerSecond : kDefaultSsdBytesPerSecond;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (auto it = rates_.find(device_key(device)); it != rates_.end()) {
+            rate = it->second;
+        } else if (auto cls = rates_.find(class_key(device)); cls != rates_.end()) {
+            rate = cls->second;
+        }
+    }
+    return static_cast<double>(bytes) / rate;
+}
+
+void ThroughputModel::record(const StorageDevice& device, int64_t bytes, double seconds)
+{
+    if (bytes <= 0 || seconds < 1.0) return;
+    const double rate = static_cast<double>(bytes) / seconds;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const std::string& key : {device_key(device), class_key(device)}) {
+        if (key.empty()) continue;
+        auto [it, inserted] = rates_.try_emplace(key, rate);
+        if (!inserted) {
+            it->second += kSmoothing * (rate - it->second);
+        }
+    }
+}
+
+void ThroughputModel::save() const
+{
+    if (path_.empty()) return;
+
+    std::ostringstream out;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& [key, rate] : rates_) {
+            out << key << ' ' << static_cast<int64_t>(rate) << '\n';
+        }
+    }
+
+    // Write a sibling file and rename it over the old one so a crash never leaves half a file
+    std::error_code ec;
+    fs::create_directories(path_.parent_path(), ec);
+    const fs::path temp = path_.string() + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        file << out.str();
+        if (!file) {
+            log_message("Could not write throughput file " + temp.string(), LogLevel::WARNING);
+            return;
+        }
+    }
+    fs::rename(temp, path_, ec);
+    if (ec) {
+        log_message("Could not update throughput file " + path_.string() + ": " + ec.message(), LogLevel::WARNING);
+        fs::remove(temp, ec);
+    }
+}
@@ -12,7 +12,11 @@
 #include <optional>
 #include <cxxopts.hpp>
 #include <filesystem>
+#include <fstream>
 #include <cmath>
+#include <algorithm>
+#include <cctype>
+#include <memory>
 #include <random>
 #include <chrono>
 #include <ranges>
@@ -26,6 +30,8 @@
 #include "torrent_modifier.hpp"
 #include "torrent_checker.hpp"
 #include "season_pack.hpp"
+#include "hash_cache.hpp"
+#include "hash_executor.hpp"
 #include "output.hpp"
 #include "updater.hpp"
 
@@ -105,6 +111,13 @@ OverwriteDecision prompt_overwrite(const std::string &filepath)
         std::cout << "Error: Invalid input. Please enter 'y' or 'n'.\n";
     }
 }
+
+// One torrent of a fan-out invocation (--presets / --per-tracker)
+struct FanOutTarget
+{
+    std::optional<std::string> preset;  // Replaces --preset
+    std::optional<std::string> tracker; // Replaces the resolved tracker list
+};
 } // namespace
 
 // Get torrent configuration from user input (interactive mode)
@@ -428,9 +441,9 @@ get_version: // Label to jump to if overwrite is 'n' or empty
     // Get entropy flag
     bool entropy = prompt_yes_no("Add random entropy for unique info hash?");
 
-    // Compile glob patterns to regex once at config time. glob_to_regex() escapes
-    // all metacharacters so regex_error is unreachable — the catch is defense-in-depth.
-    std::vector<std::regex> exclude_regex_compiled;
+    // Glob patterns are compiled into one PathFilter below; every string is a
+    // valid glob, so there is nothing to reject here.
+    std::vector<std::string> exclude_globs;
     if (prompt_yes_no("Exclude files by pattern?"))
     {
         while (true)
@@ -440,19 +453,11 @@ get_version: // Label to jump to if overwrite is 'n' or empty
             std::getline(std::cin, pattern);
             if (pattern.empty())
                 break;
-            try
-            {
-                exclude_regex_compiled.push_back(utils::glob_to_regex(pattern));
-            }
-            catch (const std::regex_error &)
-            {
-                print_info(std::string("Error: Invalid glob pattern: ") + pattern + "\n");
-                log_message("Invalid glob pattern entered: " + pattern, LogLevel::WARNING);
-            }
+            exclude_globs.push_back(pattern);
         }
     }
 
-    std::vector<std::regex> include_regex_compiled;
+    std::vector<std::string> include_globs;
     if (prompt_yes_no("Include only matching files?"))
     {
         while (true)
@@ -462,15 +467,7 @@ get_version: // Label to jump to if overwrite is 'n' or empty
             std::getline(std::cin, pattern);
             if (pattern.empty())
                 break;
-            try
-            {
-                include_regex_compiled.push_back(utils::glob_to_regex(pattern));
-            }
-            catch (const std::regex_error &)
-            {
-                print_info(std::string("Error: Invalid glob pattern: ") + pattern + "\n");
-                log_message("Invalid glob pattern entered: " + pattern, LogLevel::WARNING);
-            }
+            include_globs.push_back(pattern);
         }
     }
 
@@ -483,20 +480,24 @@ get_version: // Label to jump to if overwrite is 'n' or empty
     if (use_builtin_excludes) {
         log_message("Applying built-in exclude patterns (interactive)", LogLevel::INFO);
     }
-    exclude_regex_compiled = utils::apply_builtin_excludes(exclude_regex_compiled, use_builtin_excludes);
+    PathFilter filter(utils::with_builtin_excludes(exclude_globs, use_builtin_excludes), std::move(include_globs));
 
-    return TorrentConfig(path, output, trackers, tv,
+    TorrentConfig config(path, output, trackers, tv,
                          comment.empty() ? std::nullopt : std::optional<std::string>(comment),
                          is_private, web_seeds, piece_size, creator_str, torrent_name,
                          include_creation_date, source, entropy,
-                         std::move(exclude_regex_compiled), std::move(include_regex_compiled),
+                         std::move(filter),
                          false, target_piece_count
     );
+    config.hash_cache = HashCache::shared();
+    return config;
 }
 
 // Parse command-line arguments into a TorrentConfig.
 // Returns std::nullopt if the user declines to overwrite an existing output file.
-std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &result, std::string &declined_path)
+// A fan-out target swaps in its own preset or single tracker for this output.
+std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &result, std::string &declined_path,
+                                                    const FanOutTarget &target = {})
 {
     if (!result.count("path"))
     {
@@ -505,8 +506,14 @@ std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &
 
     std::string input_path = result["path"].as<std::string>();
 
+    std::optional<std::string> preset_name = target.preset;
+    if (!preset_name && result.count("preset"))
+    {
+        preset_name = result["preset"].as<std::string>();
+    }
+
     ConfigValues preset_values;
-    if (result.count("preset"))
+    if (preset_name)
     {
         std::optional<fs::path> preset_file;
         if (result.count("preset-file")) {
@@ -515,8 +522,8 @@ std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &
         PresetLoader loader;
         auto path = PresetLoader::find_preset_file(preset_file);
         loader.load(path);
-        preset_values = loader.resolve(result["preset"].as<std::string>());
-        log_message("Applied preset values for: " + result["preset"].as<std::string>(), LogLevel::INFO);
+        preset_values = loader.resolve(*preset_name);
+        log_message("Applied preset values for: " + *preset_name, LogLevel::INFO);
     }
 
     // Get trackers (before output, needed for auto-naming)
@@ -546,6 +553,10 @@ std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &
             trackers.insert(trackers.end(), custom_trackers.begin(), custom_trackers.end());
         }
     }
+    if (target.tracker)
+    {
+        trackers = {*target.tracker};
+    }
 
     // Resolve output path (optional — auto-generate if not provided)
     std::string output_path;
@@ -718,6 +729,19 @@ std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &
         throw std::runtime_error("Conflicting piece size options");
     }
 
+    // Memory budget for piece buffers while hashing
+    int64_t hash_memory = 0;
+    if (result.count("hash-memory"))
+    {
+        int mb = result["hash-memory"].as<int>();
+        if (mb <= 0)
+        {
+            print_error("Error: --hash-memory must be a positive number of MB\n");
+            throw std::runtime_error("Invalid hash memory");
+        }
+        hash_memory = static_cast<int64_t>(mb) * 1024 * 1024;
+    }
+
     // Resolve creator (default: "Torrent Builder", unless --no-creator or preset)
     std::optional<std::string> creator_str = "Torrent Builder";
     if (result.count("no-creator")) {
@@ -763,44 +787,24 @@ std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &
         entropy = *preset_values.entropy;
     }
 
-    // Compile glob patterns to regex once at config time. glob_to_regex() escapes
-    // all metacharacters so regex_error is unreachable — the catch is defense-in-depth.
-    std::vector<std::regex> exclude_regex_compiled;
+    std::vector<std::string> exclude_globs;
     if (result.count("exclude"))
     {
-        auto patterns = result["exclude"].as<std::vector<std::string>>();
-        for (const auto &p : patterns)
-        {
-            try { exclude_regex_compiled.push_back(utils::glob_to_regex(p)); }
-            catch (const std::regex_error &) { throw std::runtime_error("Invalid exclude pattern: " + p); }
-        }
+        exclude_globs = result["exclude"].as<std::vector<std::string>>();
     }
     else if (preset_values.exclude_patterns)
     {
-        for (const auto &p : *preset_values.exclude_patterns)
-        {
-            try { exclude_regex_compiled.push_back(utils::glob_to_regex(p)); }
-            catch (const std::regex_error &) { throw std::runtime_error("Invalid exclude pattern: " + p); }
-        }
+        exclude_globs = *preset_values.exclude_patterns;
     }
 
-    std::vector<std::regex> include_regex_compiled;
+    std::vector<std::string> include_globs;
     if (result.count("include"))
     {
-        auto patterns = result["include"].as<std::vector<std::string>>();
-        for (const auto &p : patterns)
-        {
-            try { include_regex_compiled.push_back(utils::glob_to_regex(p)); }
-            catch (const std::regex_error &) { throw std::runtime_error("Invalid include pattern: " + p); }
-        }
+        include_globs = result["include"].as<std::vector<std::string>>();
     }
     else if (preset_values.include_patterns)
     {
-        for (const auto &p : *preset_values.include_patterns)
-        {
-            try { include_regex_compiled.push_back(utils::glob_to_regex(p)); }
-            catch (const std::regex_error &) { throw std::runtime_error("Invalid include pattern: " + p); }
-        }
+        include_globs = *preset_values.include_patterns;
     }
 
     // Built-in system-file exclusions (.DS_Store, Thumbs.db, etc.) are applied
@@ -814,7 +818,7 @@ std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &
         log_message(std::string("Built-in exclude patterns ") +
                     (use_builtin_excludes ? "enabled" : "disabled") + " via preset", LogLevel::INFO);
     }
-    exclude_regex_compiled = utils::apply_builtin_excludes(exclude_regex_compiled, use_builtin_excludes);
+    PathFilter filter(utils::with_builtin_excludes(exclude_globs, use_builtin_excludes), std::move(include_globs));
 
     try
     {
@@ -841,11 +845,15 @@ std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &
             log_message("No tracker rules file found, skipping rules enforcement", LogLevel::INFO);
         }
 
-        // Compute content size once for target resolution and/or tracker rule enforcement
-        bool need_content_size = (target_piece_count && !piece_size)
-            || (rules_loaded && !trackers.empty());
-        int64_t content_size = need_content_size
-            ? utils::compute_content_size(input_path) : 0;
+        // Scan the content once with the final patterns: target resolution, tracker
+        // rule enforcement, the season check and the torrent's file list all read
+        // from this snapshot. A missing path is reported by TorrentConfig below.
+        std::shared_ptr<const ContentIndex> content_index;
+        std::error_code exists_ec;
+        if (fs::exists(input_path, exists_ec)) {
+            content_index = ContentIndex::scan(input_path, filter);
+        }
+        int64_t content_size = content_index ? content_index->total_size() : 0;
 
         // Resolve target_piece_count → piece_size before tracker rule enforcement
         // so that rules can naturally cap/adjust the resolved piece size.
@@ -911,13 +919,19 @@ std::optional<TorrentConfig> get_commandline_config(const cxxopts::ParseResult &
             }
         }
 
-        return TorrentConfig(input_path, output_path, trackers, tv,
+        TorrentConfig config(input_path, output_path, trackers, tv,
                              comment, is_private, web_seeds, piece_size,
                              creator_str, torrent_name, include_creation_date,
                              source, entropy,
-                             std::move(exclude_regex_compiled), std::move(include_regex_compiled),
+                             std::move(filter),
                              false, target_piece_count
         );
+        config.hash_memory = hash_memory;
+        config.content_index = std::move(content_index);
+        if (!result.count("no-hash-cache")) {
+            config.hash_cache = HashCache::shared();
+        }
+        return config;
     }
     catch (const fs::filesystem_error &e)
     {
@@ -1270,6 +1284,12 @@ int handle_batch_command(const std::vector<std::string> &args)
         batch_options.add_options()
             ("h,help", "Show help")
             ("w,workers", "Number of parallel workers", cxxopts::value<int>()->default_value("1"), "N")
+            ("hash-memory", "Memory for piece buffers shared by all workers, in MB (default: 256)", cxxopts::value<int>(), "MB")
+            ("no-hash-cache", "Hash every piece instead of reusing cached piece hashes")
+            ("hash-threads", "Hashing threads shared by all workers (default: all cores)", cxxopts::value<int>(), "N")
+            ("resume", "Skip jobs an interrupted run already finished (per the journal beside the batch file)")
+            ("report", "Write one JSON line per job (phase times, bytes read, MB/s) to FILE", cxxopts::value<std::string>(), "FILE")
+            ("stream", "Read jobs one document at a time (multi-document YAML); implied for .ndjson/.jsonl and '-' (stdin)")
             ("path", "Batch YAML file", cxxopts::value<std::string>(), "FILE");
 
         batch_options.parse_positional({"path"});
@@ -1281,12 +1301,27 @@ int handle_batch_command(const std::vector<std::string> &args)
             print_info("Examples:\n");
             print_info("  torrent-builder batch batch.yaml\n");
             print_info("  torrent-builder batch batch.yaml --workers 4\n");
+            print_info("  torrent-builder batch batch.yaml --resume\n");
+            print_info("  torrent-builder batch batch.yaml --report nightly.ndjson\n");
+            print_info("  generate-jobs | torrent-builder batch - --workers 8\n");
             return 0;
         }
 
         set_verbosity(Verbosity::QUIET);
 
-        BatchConfig config = BatchProcessor::parse(result["path"].as<std::string>());
+        // Streamed job lists are read while jobs run instead of being loaded up front
+        const std::string batch_path = result["path"].as<std::string>();
+        std::string extension = fs::path(batch_path).extension().string();
+        std::ranges::transform(extension, extension.begin(), [](unsigned char c) { return std::tolower(c); });
+        std::unique_ptr<BatchJobStream> stream;
+        BatchConfig config;
+        if (result.count("stream") || batch_path == "-" || extension == ".ndjson" || extension == ".jsonl") {
+            stream = BatchJobStream::open(batch_path);
+            config = stream->settings();
+            if (batch_path != "-") config.journal = BatchJournal::path_for(batch_path);
+        } else {
+            config = BatchProcessor::parse(batch_path);
+        }
 
         if (result.count("workers")) {
             int w = result["workers"].as<int>();
@@ -1298,12 +1333,55 @@ int handle_batch_command(const std::vector<std::string> &args)
             }
         }
 
+        if (result.count("hash-memory")) {
+            int mb = result["hash-memory"].as<int>();
+            if (mb <= 0) {
+                print_error("Error: --hash-memory must be a positive number of MB\n");
+                return 1;
+            }
+            config.hash_memory = static_cast<int64_t>(mb) * 1024 * 1024;
+        }
+        if (result.count("no-hash-cache")) {
+            config.hash_cache = false;
+        }
+        if (result.count("hash-threads")) {
+            int threads = result["hash-threads"].as<int>();
+            if (threads <= 0) {
+                print_error("Error: --hash-threads must be >= 1\n");
+                return 1;
+            }
+            config.hash_threads = threads;
+        }
+        config.resume = result.count("resume") > 0;
+
+        std::ofstream report;
+        if (result.count("report")) {
+            const std::string report_path = result["report"].as<std::string>();
+            report.open(report_path, std::ios::binary | std::ios::trunc);
+            if (!report) {
+                throw std::runtime_error("Cannot open report file: " + report_path);
+            }
+        }
+
         BatchProcessor processor(std::move(config));
         auto batch_start = std::chrono::steady_clock::now();
+        if (stream) {
+            // Streamed jobs are reported as they finish, in completion order
+            auto summary = processor.run_stream(*stream, [&](const BatchResult &r) {
+                if (report.is_open()) BatchProcessor::write_report_line(report, r);
+            });
+            double batch_elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - batch_start).count();
+            BatchProcessor::print_summary(summary);
+            log_message("Batch completed in " + std::to_string(batch_elapsed) + "s", LogLevel::INFO);
+            return summary.failures.empty() ? 0 : 1;
+        }
         auto results = processor.run();
         auto batch_end = std::chrono::steady_clock::now();
         double batch_elapsed = std::chrono::duration<double>(batch_end - batch_start).count();
         BatchProcessor::print_summary(results);
+        if (report.is_open()) {
+            for (const auto &r : results) BatchProcessor::write_report_line(report, r);
+        }
         log_message("Batch completed in " + std::to_string(batch_elapsed) + "s", LogLevel::INFO);
 
         for (const auto &r : results)
@@ -1691,6 +1769,102 @@ static void maybe_check_for_updates_on_startup(const cxxopts::ParseResult &resul
     }
 }
 
+// Creates one torrent per --presets entry and/or per tracker. Outputs that
+// agree on piece size and version share one hashing pass.
+static int create_fan_out(const cxxopts::ParseResult &result)
+{
+    if (result.count("output"))
+    {
+        throw std::runtime_error("--output cannot be combined with --presets or --per-tracker "
+                                 "(outputs are auto-named; use --output-dir)");
+    }
+    if (result.count("presets") && result.count("preset"))
+    {
+        throw std::runtime_error("--preset and --presets are mutually exclusive");
+    }
+
+    std::vector<std::optional<std::string>> presets;
+    if (result.count("presets"))
+    {
+        for (const auto &name : result["presets"].as<std::vector<std::string>>())
+        {
+            presets.emplace_back(name);
+        }
+    }
+    else
+    {
+        presets.emplace_back(std::nullopt);
+    }
+
+    // Outputs are auto-named, so no overwrite prompt can decline them
+    std::string declined_path;
+    std::vector<TorrentConfig> configs;
+    for (const auto &preset : presets)
+    {
+        TorrentConfig config = get_commandline_config(result, declined_path, FanOutTarget{preset, std::nullopt}).value();
+        if (!result.count("per-tracker"))
+        {
+            configs.push_back(std::move(config));
+            continue;
+        }
+        if (config.trackers.empty())
+        {
+            throw std::runtime_error("--per-tracker needs at least one tracker"
+                                     + (preset ? " (preset " + *preset + " has none)" : std::string()));
+        }
+        for (const auto &tracker : config.trackers)
+        {
+            configs.push_back(get_commandline_config(result, declined_path, FanOutTarget{preset, tracker}).value());
+        }
+    }
+
+    std::vector<fs::path> outputs;
+    for (const auto &config : configs)
+    {
+        if (std::ranges::contains(outputs, config.output))
+        {
+            throw std::runtime_error("Two outputs would be written to " + config.output.string()
+                                     + "; use trackers or presets with distinct names");
+        }
+        outputs.push_back(config.output);
+    }
+
+    auto season_error = season_pack::evaluate_season_warning(
+        configs.front().path, result.count("fail-on-season-warning") > 0, -1,
+        configs.front().content_index.get());
+    if (season_error)
+    {
+        throw std::runtime_error(*season_error);
+    }
+    maybe_check_for_updates_on_startup(result);
+    TorrentCreator::create_torrents(std::move(configs));
+
+    if (is_json_mode())
+    {
+        try
+        {
+            std::string json = "[\n";
+            for (size_t i = 0; i < outputs.size(); ++i)
+            {
+                TorrentInspector inspector(outputs[i]);
+                std::string entry = TorrentInspector::format_metadata(inspector.inspect(), true);
+                std::string path_field = ",\n  \"output_path\": \"" + utils::escape_json(outputs[i].string()) + "\"\n";
+                entry.insert(entry.rfind('}'), path_field);
+                while (!entry.empty() && entry.back() == '\n') entry.pop_back();
+                json += entry + (i + 1 < outputs.size() ? ",\n" : "\n");
+            }
+            std::cout << json << "]\n";
+        }
+        catch (const std::exception &e)
+        {
+            log_message("JSON output generation error: " + std::string(e.what()), LogLevel::ERR);
+            print_error(std::string("Error generating JSON output: ") + e.what() + "\n");
+            return 1;
+        }
+    }
+    return 0;
+}
+
 int main(int argc, char *argv[])
 {
     // Check for subcommands
@@ -1764,7 +1938,11 @@ int main(int argc, char *argv[])
                    "16384, 32768)",
                    cxxopts::value<int>(), "SIZE")(
             "target-piece-count", "Target number of pieces (calculates optimal piece size)",
-            cxxopts::value<int>(), "N")("no-creator", "Omit creator field from torrent metadata")(
+            cxxopts::value<int>(), "N")(
+            "hash-memory", "Memory for piece buffers while hashing, in MB (default: 256)",
+            cxxopts::value<int>(), "MB")("no-hash-cache", "Hash every piece instead of reusing cached piece hashes")(
+            "hash-threads", "Hashing threads (default: all cores)", cxxopts::value<int>(), "N")(
+            "no-creator", "Omit creator field from torrent metadata")(
             "d,no-date", "Omit creation date from torrent metadata")("p,path", "Path to file or directory",
                                                   cxxopts::value<std::string>(), "PATH")(
             "o,output", "Output torrent file path (optional, auto-generated if omitted)", cxxopts::value<std::string>(), "OUTPUT")(
@@ -1831,6 +2009,10 @@ int main(int argc, char *argv[])
                          "--exclude \"*.txt\"\n";
             std::cout << "  ./torrent_builder --path /data/folder --include \"*.mkv\" "
                          "--include \"*.mp4\"\n";
+            std::cout << "  ./torrent_builder --path /data/folder --presets ptp,btn,ggn "
+                         "--output-dir /torrents\n";
+            std::cout << "  ./torrent_builder --path /data/folder --private --per-tracker "
+                         "--tracker \"https://a.example/announce\" --tracker \"https://b.example/announce\"\n";
             std::cout << "  ./torrent_builder --path /data/file --verbose\n";
             std::cout << "  ./torrent_builder --path /data/file --quiet\n";
             std::cout << "  ./torrent_builder --path /data/file --json\n";
@@ -1855,6 +2037,17 @@ int main(int argc, char *argv[])
             }
         }
 
+        if (result.count("hash-threads"))
+        {
+            int threads = result["hash-threads"].as<int>();
+            if (threads <= 0)
+            {
+                print_error("Error: --hash-threads must be >= 1\n");
+                return 1;
+            }
+            HashExecutor::set_default_threads(threads);
+        }
+
         // Run in interactive or command-line mode based on arguments
         if (result.count("interactive"))
         {
@@ -1866,6 +2059,10 @@ int main(int argc, char *argv[])
         }
         else
         {
+            if (result.count("presets") || result.count("per-tracker"))
+            {
+                return create_fan_out(result);
+            }
             std::string declined_path;
             auto config_opt = get_commandline_config(result, declined_path);
             if (!config_opt)
@@ -1879,7 +2076,8 @@ int main(int argc, char *argv[])
                 return 1;
             }
             auto season_error = season_pack::evaluate_season_warning(
-                config_opt->path, result.count("fail-on-season-warning") > 0);
+                config_opt->path, result.count("fail-on-season-warning") > 0, -1,
+                config_opt->content_index.get());
             if (season_error)
             {
                 throw std::runtime_error(*season_error);
@@ -2,6 +2,13 @@
 #include "logger.hpp"
 #include "utils.hpp"
 #include "output.hpp"
+#include "hash_backend.hpp"
+#include "content_index.hpp"
+#include "piece_stream.hpp"
+#include "work_queue.hpp"
+#include "hash_executor.hpp"
+#include "merkle.hpp"
+#include "constants.hpp"
 #include <libtorrent/torrent_info.hpp>
 #include <libtorrent/file_storage.hpp>
 #include <libtorrent/hasher.hpp>
@@ -10,17 +17,20 @@
 #include <sstream>
 #include <unordered_set>
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
 
 TorrentChecker::TorrentChecker(const fs::path &torrent_path) : torrent_path_(torrent_path)
 {
     load_torrent();
 }
 
-TorrentChecker::~TorrentChecker()
-{
-    close_all_files();
-}
+TorrentChecker::~TorrentChecker() = default;
 
 void TorrentChecker::load_torrent()
 {
@@ -56,65 +66,6 @@ void TorrentChecker::load_torrent()
     }
 }
 
-void TorrentChecker::close_all_files()
-{
-    for (auto &[path, stream] : open_files_)
-    {
-        if (stream.is_open())
-            stream.close();
-    }
-    open_files_.clear();
-}
-
-int TorrentChecker::find_file_for_piece(int64_t piece_offset, int64_t piece_end) const
-{
-    const auto &files = torrent_info_->files();
-    int lo = 0, hi = files.num_files() - 1;
-    int result = -1;
-
-    while (lo <= hi)
-    {
-        int mid = lo + (hi - lo) / 2;
-        auto const idx = lt::file_index_t{mid};
-        int64_t file_end = files.file_offset(idx) + files.file_size(idx);
-
-        if (file_end <= piece_offset)
-        {
-            lo = mid + 1;
-        }
-        else
-        {
-            result = mid;
-            hi = mid - 1;
-        }
-    }
-
-    return result;
-}
-
-std::ifstream &TorrentChecker::get_file_stream(const fs::path &file_path)
-{
-    auto key = file_path.string();
-    auto it = open_files_.find(key);
-    if (it != open_files_.end())
-    {
-        it->second.clear();
-        it->second.seekg(0);
-        return it->second;
-    }
-
-    if (open_files_.size() >= 64)
-    {
-        auto oldest = open_files_.begin();
-        if (oldest->second.is_open())
-            oldest->second.close();
-        open_files_.erase(oldest);
-    }
-
-    auto [inserted, ok] = open_files_.emplace(key, std::ifstream(file_path, std::ios::binary));
-    return inserted->second;
-}
-
 std::vector<CheckResult::MissingFile> TorrentChecker::check_missing_files(
     const fs::path &base_path, std::vector<CheckResult::FileResult> &file_results)
 {
@@ -175,215 +126,275 @@ std::vector<CheckResult::MissingFile> TorrentChecker::check_missing_files(
     return missing;
 }
 
-void TorrentChecker::read_piece_data(int piece_index, const int piece_length,
-                                      const int64_t total_size,
-                                      const lt::torrent_info &info,
-                                      const fs::path &base_path)
+bool TorrentChecker::verify_piece_v1(int piece_index, const lt::sha1_hash &computed) const
 {
-    const auto &files = info.files();
-    int64_t piece_start = static_cast<int64_t>(piece_index) * piece_length;
-    int64_t piece_end = std::min(piece_start + piece_length, total_size);
-    int64_t piece_size = piece_end - piece_start;
-
-    piece_buffer_.assign(piece_size, '\0');
+    lt::sha1_hash expected = torrent_info_->hash_for_piece(lt::piece_index_t(piece_index));
+    return computed == expected;
+}
 
-    int start_file = find_file_for_piece(piece_start, piece_end);
-    if (start_file < 0)
-        return;
+// Checks each file of a v2 or hybrid torrent against its own hash tree: a
+// file of one piece against its pieces root, a larger file piece by piece
+// against its piece layer, once that layer is shown to hash to the root.
+// v2 files start on piece boundaries, so no piece belongs to two files and
+// the files are checked in parallel.
+void TorrentChecker::verify_files_v2(const std::vector<lt::sha256_hash> &piece_roots,
+                                     std::vector<char> &corrupt) const
+{
+    const auto &files = torrent_info_->files();
+    const int piece_length = torrent_info_->piece_length();
+    const int num_files = files.num_files();
 
-    for (int i = start_file; i < files.num_files(); ++i)
-    {
+    auto verify_file = [&](int i) {
         auto const idx = lt::file_index_t{i};
-        int64_t file_start = files.file_offset(idx);
-        int64_t file_end = file_start + files.file_size(idx);
+        const int64_t size = files.file_size(idx);
+        if (files.pad_file_at(idx) || size == 0)
+            return;
 
-        if (file_start >= piece_end)
-            break;
+        const int first = static_cast<int>(files.file_offset(idx) / piece_length);
+        const int count = static_cast<int>((size + piece_length - 1) / piece_length);
+        const lt::sha256_hash root = files.root(idx);
 
-        if (file_end <= piece_start)
-            continue;
-
-        if (files.pad_file_at(idx))
-            continue;
-
-        int64_t read_start_in_file = std::max(file_start, piece_start) - file_start;
-        int64_t read_end_in_file = std::min(file_end, piece_end) - file_start;
-        int64_t read_size = read_end_in_file - read_start_in_file;
-        int64_t buf_pos = std::max(file_start, piece_start) - piece_start;
-
-        fs::path file_path = base_path / files.file_path(idx);
-
-        std::ifstream &f = get_file_stream(file_path);
-        if (!f.is_open())
+        if (count == 1)
         {
-            log_message("Cannot open file for piece " + std::to_string(piece_index)
-                            + ": " + file_path.string(),
-                        LogLevel::WARNING);
-            continue;
+            if (piece_roots[first] != root)
+                corrupt[first] = 1;
+            return;
         }
 
-        f.clear();
-        f.seekg(read_start_in_file);
-
-        if (read_end_in_file > files.file_size(idx))
+        const auto layer = torrent_info_->piece_layer(idx);
+        std::vector<lt::sha256_hash> expected;
+        if (static_cast<int64_t>(layer.size()) == static_cast<int64_t>(count) * 32)
         {
-            int64_t available = files.file_size(idx) - read_start_in_file;
-            if (available > 0)
-            {
-                f.read(piece_buffer_.data() + buf_pos, available);
-                auto got = f.gcount();
-                if (got < available)
-                {
-                    log_message("Short read for piece " + std::to_string(piece_index)
-                                    + " from file: " + file_path.string()
-                                    + " (read " + std::to_string(got)
-                                    + " of " + std::to_string(available) + " bytes)",
-                                LogLevel::WARNING);
-                }
-            }
-            continue;
+            expected.resize(count);
+            for (int k = 0; k < count; ++k)
+                std::memcpy(expected[k].data(), layer.data() + static_cast<int64_t>(k) * 32, 32);
         }
 
-        f.read(piece_buffer_.data() + buf_pos, read_size);
-
-        if (!f)
+        if (!expected.empty() && merkle::layer_root(expected, piece_length) == root)
         {
-            auto got = f.gcount();
-            log_message("Short read for piece " + std::to_string(piece_index)
-                            + " from file: " + file_path.string()
-                            + " (read " + std::to_string(got)
-                            + " of " + std::to_string(read_size) + " bytes)",
-                        LogLevel::WARNING);
+            for (int k = 0; k < count; ++k)
+            {
+                if (piece_roots[first + k] != expected[k])
+                    corrupt[first + k] = 1;
+            }
+            return;
         }
-    }
-}
-
-bool TorrentChecker::verify_piece_v1(int piece_index) const
-{
-    lt::hasher h;
-    h.update(piece_buffer_.data(), static_cast<int>(piece_buffer_.size()));
-    lt::sha1_hash computed = h.final();
-    lt::sha1_hash expected = torrent_info_->hash_for_piece(lt::piece_index_t(piece_index));
-    return computed == expected;
-}
-
-bool TorrentChecker::verify_piece_v2(int piece_index, const lt::torrent_info &info) const
-{
-    const auto &files = info.files();
-    int piece_length = info.piece_length();
-    int64_t piece_offset = static_cast<int64_t>(piece_index) * piece_length;
-    int64_t piece_end = piece_offset + piece_length;
-
-    int file_idx = find_file_for_piece(piece_offset, piece_end);
-    if (file_idx < 0)
-        return true;
 
-    for (int i = file_idx; i < files.num_files(); ++i)
+        // Without a usable piece layer only the file as a whole can be checked
+        log_message("No valid piece layer for " + files.file_path(idx)
+                        + "; verifying the file against its pieces root",
+                    LogLevel::WARNING);
+        std::vector<lt::sha256_hash> computed(piece_roots.begin() + first, piece_roots.begin() + first + count);
+        if (merkle::layer_root(std::move(computed), piece_length) != root)
+            std::fill_n(corrupt.begin() + first, count, 1);
+    };
+
+    HashExecutor &executor = HashExecutor::shared();
+    auto group = executor.make_group();
+    std::atomic<int> next_file{0};
+    const int tasks = std::max(1, std::min(executor.threads(), num_files));
+    for (int t = 0; t < tasks; ++t)
     {
-        auto const idx = lt::file_index_t{i};
-        if (files.pad_file_at(idx))
-            continue;
-
-        int64_t file_start = files.file_offset(idx);
-        int64_t file_size = files.file_size(idx);
-        int64_t file_end = file_start + file_size;
-
-        if (file_start >= piece_end)
-            break;
-
-        if (!(piece_offset >= file_start && piece_offset < file_end))
-            continue;
-
-        auto layer = info.piece_layer(idx);
-        if (layer.empty())
-            return true;
-
-        int64_t file_piece_offset = file_start / piece_length;
-        int local_index = piece_index - static_cast<int>(file_piece_offset);
-
-        if (local_index < 0 || local_index >= static_cast<int>(layer.size() / 32))
-            return true;
-
-        int64_t data_start = std::max(int64_t(0), file_start - piece_offset);
-        int64_t data_end = std::min(static_cast<int64_t>(piece_length), file_end - piece_offset);
-        int actual_size = static_cast<int>(data_end - data_start);
-
-        lt::hasher256 h;
-        h.update(piece_buffer_.data() + data_start, actual_size);
-        lt::sha256_hash computed = h.final();
-
-        lt::sha256_hash expected;
-        std::memcpy(expected.data(), layer.data() + local_index * 32, 32);
-
-        return computed == expected;
+        group->submit([&]() {
+            for (int i = next_file.fetch_add(1); i < num_files; i = next_file.fetch_add(1))
+                verify_file(i);
+        });
     }
-
-    return true;
+    group->wait();
 }
 
 std::vector<CheckResult::CorruptedPiece> TorrentChecker::verify_all_pieces(const fs::path &base_path,
                                                                             bool verbose)
 {
-    std::vector<CheckResult::CorruptedPiece> corrupted;
     int piece_length = torrent_info_->piece_length();
     int64_t total_size = torrent_info_->total_size();
     int num_pieces = torrent_info_->num_pieces();
 
+    // Torrents with v2 hashes (hybrids included) are checked against their
+    // per-file hash trees; v1 piece hashes are only used when there are none.
     const auto &info_hash = torrent_info_->info_hashes();
-    bool has_v1 = info_hash.has_v1();
+    const auto &files = torrent_info_->files();
     bool has_v2 = info_hash.has_v2();
+    bool has_v1 = info_hash.has_v1() && !has_v2;
 
     log_message("Starting verification for: " + torrent_path_.string()
                     + " (" + std::to_string(num_pieces) + " pieces)",
                 LogLevel::INFO);
 
     auto start_time = std::chrono::steady_clock::now();
-    int64_t bytes_processed = 0;
-
-    for (int i = 0; i < num_pieces; ++i)
-    {
-        int64_t piece_start = static_cast<int64_t>(i) * piece_length;
-        int64_t piece_size = std::min(static_cast<int64_t>(piece_length), total_size - piece_start);
-
-        read_piece_data(i, piece_length, total_size, *torrent_info_, base_path);
+    std::atomic<int64_t> bytes_processed{0};
+    std::atomic<int> pieces_done{0};
+
+    // Verification runs on the shared hashing pool, so pieces are checked on
+    // as many cores as the pool has while the stream keeps reading ahead.
+    HashExecutor &executor = HashExecutor::shared();
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int num_hashers = std::max(1, std::min(executor.threads(), num_pieces));
+    const int num_readers = std::max(1, std::min({cores / 4, 4, num_pieces}));
+
+    // Enough buffers for a batch per hasher with reads in flight behind them,
+    // within the default read-buffer budget
+    const int lanes = has_v1 ? hash_backend::batch_size() : 1;
+    const int64_t max_buffers = std::max<int64_t>(2, HashMemory::kDefaultBytes / piece_length);
+    const int depth = static_cast<int>(std::clamp<int64_t>(num_hashers * lanes + 2 * num_readers, 2, max_buffers));
+    const size_t batch = static_cast<size_t>(std::clamp(depth / num_hashers, 1, std::max(1, lanes)));
+    auto stream = PieceStream::for_storage(torrent_info_->files(), base_path.string(), depth);
+
+    // Each piece's verdict is written once, by whichever thread verified it
+    std::vector<char> corrupt(static_cast<size_t>(num_pieces), 0);
+    std::vector<lt::sha256_hash> piece_roots(has_v2 ? static_cast<size_t>(num_pieces) : 0);
+    WorkQueue<StreamPiece *> ready;
+    auto group = executor.make_group();
+    std::atomic<bool> cancel{false};
+    std::atomic<bool> finished{false};
+    std::mutex error_mutex;
+    std::exception_ptr error;
+
+    auto fail = [&](std::exception_ptr e) {
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+                error = e;
+        }
+        cancel.store(true);
+    };
+
+    // Each drain verifies up to a batch of pieces with its own digest buffers,
+    // so their v1 digests reach the hash backend together
+    auto drain = [&]() {
+        thread_local std::vector<StreamPiece *> pieces;
+        thread_local std::vector<HashInput> inputs;
+        thread_local std::vector<lt::sha1_hash> digests;
+        if (!ready.try_pop_batch(pieces, batch))
+            return;
+
+        // After a failure keep draining so buffers still return to the stream
+        if (!cancel.load())
+        {
+            try
+            {
+                if (has_v1)
+                {
+                    inputs.clear();
+                    for (StreamPiece *piece : pieces)
+                        inputs.push_back({piece->data.data(), piece->size});
+                    digests.resize(inputs.size());
+                    hash_backend::sha1(inputs.data(), digests.data(), static_cast<int>(inputs.size()));
+                }
 
-        bool piece_ok = true;
+                for (size_t k = 0; k < pieces.size(); ++k)
+                {
+                    StreamPiece *piece = pieces[k];
+                    int i = piece->index;
+
+                    if (!piece->complete())
+                    {
+                        log_message("Incomplete data for piece " + std::to_string(i) + " ("
+                                        + std::to_string(piece->missing) + " bytes unreadable): " + piece->error,
+                                    LogLevel::WARNING);
+                    }
+
+                    if (has_v1)
+                    {
+                        corrupt[i] = verify_piece_v1(i, digests[k]) ? 0 : 1;
+                    }
+                    else
+                    {
+                        // The subtree root of the piece's 16 KiB leaves, checked per file below
+                        auto const f = files.file_index_at_piece(lt::piece_index_t(i));
+                        const int64_t file_size = files.file_size(f);
+                        const int64_t offset = static_cast<int64_t>(i) * piece_length - files.file_offset(f);
+                        const int len = static_cast<int>(std::min<int64_t>(piece_length, file_size - offset));
+                        if (!files.pad_file_at(f) && len > 0)
+                        {
+                            piece_roots[i] = merkle::piece_root(piece->data.data(), len,
+                                                                merkle::piece_leafs(file_size, piece_length));
+                        }
+                    }
+                }
+            }
+            catch (...)
+            {
+                fail(std::current_exception());
+            }
+        }
 
-        if (has_v1)
+        for (StreamPiece *piece : pieces)
         {
-            if (!verify_piece_v1(i))
-                piece_ok = false;
+            bytes_processed.fetch_add(piece->size, std::memory_order_relaxed);
+            pieces_done.fetch_add(1, std::memory_order_relaxed);
+            stream->release(piece);
         }
+    };
 
-        if (piece_ok && has_v2)
+    // The stream threads read (io_uring where available); every completed
+    // piece is queued and one drain submitted for it
+    std::thread io_thread([&]() {
+        try
         {
-            if (!verify_piece_v2(i, *torrent_info_))
-                piece_ok = false;
+            stream->run(
+                [&](StreamPiece *piece) {
+                    ready.push(piece);
+                    group->submit(drain);
+                },
+                cancel, num_readers);
         }
-
-        if (!piece_ok)
+        catch (...)
         {
-            CheckResult::CorruptedPiece cp;
-            cp.index = i;
-            cp.offset = piece_start;
-            corrupted.push_back(cp);
-            log_message("Corrupted piece #" + std::to_string(i)
-                            + " at offset " + std::to_string(piece_start),
-                        LogLevel::WARNING);
+            fail(std::current_exception());
         }
+        ready.close();
+        group->wait();
+        finished.store(true);
+    });
+
+    auto report_progress = [&]() {
+        const int64_t processed = bytes_processed.load(std::memory_order_relaxed);
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        double speed = elapsed > 0 ? processed / elapsed : 0;
+        double remaining_bytes = static_cast<double>(total_size - processed);
+        double eta = speed > 0 ? remaining_bytes / speed : 0;
+
+        print_progress(pieces_done.load(std::memory_order_relaxed), num_pieces, speed, eta, processed, total_size);
+    };
+
+    // Progress is drawn from this thread only, from counters the verifiers
+    // advance after each piece's verdict is recorded
+    if (verbose)
+    {
+        while (!finished.load())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            report_progress();
+        }
+    }
+    io_thread.join();
+    if (verbose)
+        report_progress();
 
-        bytes_processed += piece_size;
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
 
-        if (verbose)
-        {
-            auto now = std::chrono::steady_clock::now();
-            double elapsed = std::chrono::duration<double>(now - start_time).count();
-            double speed = elapsed > 0 ? bytes_processed / elapsed : 0;
-            double remaining_bytes = total_size - bytes_processed;
-            double eta = speed > 0 ? remaining_bytes / speed : 0;
+    if (has_v2)
+    {
+        verify_files_v2(piece_roots, corrupt);
+    }
 
-            print_progress(i + 1, num_pieces, speed, eta, bytes_processed, total_size);
-        }
+    // Verdicts are merged in index order, however the reads and hashes interleaved
+    std::vector<CheckResult::CorruptedPiece> corrupted;
+    for (int i = 0; i < num_pieces; ++i)
+    {
+        if (!corrupt[i])
+            continue;
+        CheckResult::CorruptedPiece cp;
+        cp.index = i;
+        cp.offset = static_cast<int64_t>(i) * piece_length;
+        corrupted.push_back(cp);
+        log_message("Corrupted piece #" + std::to_string(i)
+                        + " at offset " + std::to_string(cp.offset),
+                    LogLevel::WARNING);
     }
 
     log_message("Verification complete: "
@@ -392,8 +403,6 @@ std::vector<CheckResult::CorruptedPiece> TorrentChecker::verify_all_pieces(const
                     + std::to_string(corrupted.size()) + " corrupted",
                 LogLevel::INFO);
 
-    close_all_files();
-
     return corrupted;
 }
 
@@ -421,19 +430,12 @@ std::vector<CheckResult::ExtraFile> TorrentChecker::find_extra_files(const fs::p
     if (!fs::exists(base_path, ec) || !fs::is_directory(base_path, ec))
         return extra;
 
-    for (const auto &entry : fs::recursive_directory_iterator(base_path, ec))
+    // Symlinks are not followed: a link inside the content tree is never a
+    // file the torrent expects.
+    auto index = ContentIndex::scan(base_path, {}, ScanOptions{.follow_symlinks = false});
+    for (const auto &entry : index->files())
     {
-        if (ec)
-            break;
-
-        if (entry.is_symlink())
-            continue;
-        if (!entry.is_regular_file())
-            continue;
-
-        fs::path rel = entry.path().lexically_relative(base_path);
-        std::string normalized = rel.generic_string();
-        std::string normalized_lower = normalized;
+        std::string normalized_lower = entry.path;
         std::transform(normalized_lower.begin(), normalized_lower.end(),
                        normalized_lower.begin(),
                        [](unsigned char c)
@@ -442,12 +444,10 @@ std::vector<CheckResult::ExtraFile> TorrentChecker::find_extra_files(const fs::p
         if (torrent_paths.find(normalized_lower) == torrent_paths.end())
         {
             CheckResult::ExtraFile ef;
-            ef.path = normalized;
-            ef.size = entry.file_size(ec);
-            if (ec)
-                ef.size = 0;
+            ef.path = entry.path;
+            ef.size = entry.size;
             extra.push_back(ef);
-            log_message("Extra file found: " + entry.path().string(), LogLevel::INFO);
+            log_message("Extra file found: " + index->full_path(entry).string(), LogLevel::INFO);
         }
     }
 
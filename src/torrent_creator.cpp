@@ -4,6 +4,14 @@
 #include "utils.hpp"
 #include "terminal.hpp"
 #include "output.hpp"
+#include "merkle.hpp"
+#include "hash_backend.hpp"
+#include "piece_stream.hpp"
+#include "work_queue.hpp"
+#include "hash_cache.hpp"
+#include "hash_executor.hpp"
+#include "content_reader.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <chrono>
@@ -14,12 +22,380 @@
 #include <thread>
 #include <stdexcept>
 #include <system_error>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <libtorrent/hasher.hpp>
+
+namespace
+{
+
+enum class HashFamily { V1, V2 };
+
+struct HashTask
+{
+    StreamPiece* piece;
+    HashFamily family;
+    int index;        // Piece index (the stream numbers only the pieces it reads)
+    int torrent = 0;  // Which torrent of the pass the digests belong to
+};
+
+// Piece-layer hash of one v2 piece, addressed by file and file-relative piece index.
+struct PieceLayerHash
+{
+    lt::file_index_t file{-1};
+    lt::piece_index_t::diff_type piece{0};
+    lt::sha256_hash hash;
+};
+
+// Computes the v2 piece-layer hash from the piece's 16 KiB leaves. In v2 and hybrid
+// layouts every file starts on a piece boundary, so the piece belongs to exactly one
+// file whose data leads the buffer. Returns file -1 for pieces that lie in pad files.
+PieceLayerHash hash_piece_v2(const lt::file_storage& files, lt::piece_index_t piece, const char* data)
+{
+    PieceLayerHash result;
+    const int piece_length = files.piece_length();
+    lt::file_index_t f = files.file_index_at_piece(piece);
+    if (files.pad_file_at(f)) return result;
+
+    const int64_t file_start = files.file_offset(f);
+    const int64_t file_size = files.file_size(f);
+    const int64_t offset_in_file = static_cast<int64_t>(static_cast<int>(piece)) * piece_length - file_start;
+    const int data_len = static_cast<int>(std::min<int64_t>(piece_length, file_size - offset_in_file));
+
+    // Files smaller than a piece pad to the next power of two rather than
+    // to a full piece, matching libtorrent's piece-layer construction.
+    result.hash = merkle::piece_root(data, data_len, merkle::piece_leafs(file_size, piece_length));
+    result.file = f;
+    result.piece = lt::piece_index_t::diff_type(static_cast<int>(piece) - static_cast<int>(file_start / piece_length));
+    return result;
+}
+
+// Cache keys are the SHA-256 of a byte string describing exactly what was
+// hashed; bump the prefix whenever the meaning of a record changes.
+constexpr std::string_view cache_format = "torrent-builder piece cache 1";
+
+class CacheKey
+{
+public:
+    explicit CacheKey(std::string_view kind) { add(cache_format); add(kind); }
+
+    template <typename T>
+    CacheKey& add(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        bytes_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        return *this;
+    }
+
+    CacheKey& add(std::string_view text)
+    {
+        add(static_cast<uint64_t>(text.size()));
+        bytes_.append(text);
+        return *this;
+    }
+
+    HashCache::Key key() const { return hash_backend::sha256(bytes_.data(), static_cast<int64_t>(bytes_.size())); }
+
+private:
+    std::string bytes_;
+};
+
+// A few KiB from the start, middle and end of a file: cheap next to hashing
+// it, and catches rewrites that kept both size and mtime.
+lt::sha1_hash content_sample(const fs::path& path, int64_t size)
+{
+    constexpr int64_t sample = 4096;
+    auto reader = ContentReader::open(path, ReadBackend::PREAD, AccessPattern::RANDOM);
+    std::vector<char> buf;
+    auto take = [&](int64_t offset, int64_t len) {
+        const size_t at = buf.size();
+        buf.resize(at + static_cast<size_t>(len));
+        buf.resize(at + static_cast<size_t>(reader->read(offset, buf.data() + at, len)));
+    };
+    if (size <= 3 * sample) {
+        take(0, size);
+    } else {
+        take(0, sample);
+        take(size / 2 - sample / 2, sample);
+        take(size - sample, sample);
+    }
+    return hash_backend::sha1(buf.data(), static_cast<int64_t>(buf.size()));
+}
+
+// Identity of every storage file for the cache: device, inode, size and
+// mtime from the scan plus a content sample. Empty for pad files and files
+// that cannot be sampled, which keeps them out of the cache.
+std::vector<std::string> file_identities(const lt::file_storage& files, const ContentIndex& index,
+                                         const fs::path& content_path)
+{
+    std::unordered_map<std::string, const ContentEntry*> by_path;
+    const std::string root_name = content_path.filename().string();
+    for (const auto& entry : index.files()) {
+        by_path.emplace(index.is_directory() ? root_name + "/" + entry.path : root_name, &entry);
+    }
+
+    std::vector<const ContentEntry*> entries(files.num_files(), nullptr);
+    for (lt::file_index_t f : files.file_range()) {
+        if (files.pad_file_at(f) || files.file_size(f) == 0) continue;
+        auto it = by_path.find(fs::path(files.file_path(f)).generic_string());
+        if (it != by_path.end() && it->second->size == files.file_size(f)) {
+            entries[static_cast<int>(f)] = it->second;
+        }
+    }
+
+    std::vector<std::string> ids(files.num_files());
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < entries.size(); i = next.fetch_add(1)) {
+            const ContentEntry* entry = entries[i];
+            if (!entry) continue;
+            try {
+                const lt::sha1_hash sample = content_sample(index.full_path(*entry), entry->size);
+                std::string id;
+                for (const auto v : {entry->device, entry->inode}) id.append(reinterpret_cast<const char*>(&v), sizeof(v));
+                for (const auto v : {entry->size, entry->mtime_ns}) id.append(reinterpret_cast<const char*>(&v), sizeof(v));
+                id.append(sample.data(), sample.size());
+                ids[i] = std::move(id);
+            } catch (const std::exception&) {
+                // Unreadable now: hashing reports it, the cache just stays out of the way
+            }
+        }
+    };
+    // Sampling runs on the hash executor, within the same thread budget as the hashing that follows
+    HashExecutor& executor = HashExecutor::shared();
+    auto group = executor.make_group();
+    const size_t max_tasks = static_cast<size_t>(std::min(8, executor.threads()));
+    const int tasks = static_cast<int>(std::clamp<size_t>(entries.size() / 64, 1, max_tasks));
+    for (int i = 0; i < tasks; ++i) group->submit(worker);
+    group->wait();
+    return ids;
+}
+
+// Consecutive v1 pieces whose hashes are cached as one record: either a run
+// of pieces holding data of a single file, or one piece spanning files.
+struct V1Run {
+    HashCache::Key key;
+    int first;
+    int count;
+};
+
+// The piece layer and root of one file.
+struct V2Tree {
+    HashCache::Key key;
+    lt::file_index_t file;
+    int first;
+    int count;
+};
+
+// Pieces the persistent cache could not supply, and the records to write
+// back once they have been hashed.
+struct HashPlan {
+    std::vector<char> need_v1;
+    std::vector<char> need_v2;
+    std::vector<V1Run> v1_store;
+    std::vector<V2Tree> v2_store;
+};
+
+// Describes the data of one piece: file identity, offset and length of each
+// slice, or just the length of pad slices.
+bool describe_piece(const lt::file_storage& files, const std::vector<std::string>& ids, int piece, CacheKey& key)
+{
+    const lt::piece_index_t p(piece);
+    for (const auto& slice : files.map_block(p, 0, files.piece_size(p))) {
+        if (files.pad_file_at(slice.file_index)) {
+            key.add(std::string_view("pad")).add(slice.size);
+            continue;
+        }
+        const std::string& id = ids[static_cast<int>(slice.file_index)];
+        if (id.empty()) return false;
+        key.add(std::string_view(id)).add(slice.offset).add(slice.size);
+    }
+    return true;
+}
+
+// Fills the slots with every hash the cache holds for this exact layout and
+// content, and marks the rest as needed.
+HashPlan plan_hashing(const lt::file_storage& files, const ContentIndex& index, const fs::path& content_path,
+                      HashCache* cache, bool want_v1, bool want_v2,
+                      std::vector<lt::sha1_hash>& v1_slots, std::vector<PieceLayerHash>& v2_slots)
+{
+    const int num_pieces = files.num_pieces();
+    const int piece_length = files.piece_length();
+    HashPlan plan;
+    plan.need_v1.assign(num_pieces, want_v1 ? 1 : 0);
+    plan.need_v2.assign(num_pieces, want_v2 ? 1 : 0);
+    if (!cache) return plan;
+
+    const std::vector<std::string> ids = file_identities(files, index, content_path);
+    std::vector<char> payload;
+
+    if (want_v1) {
+        // Owner of each piece: the one non-pad file it holds data of, or -1.
+        auto owner = [&](int piece) {
+            int found = -1;
+            const lt::piece_index_t p(piece);
+            for (const auto& slice : files.map_block(p, 0, files.piece_size(p))) {
+                if (files.pad_file_at(slice.file_index)) continue;
+                const int f = static_cast<int>(slice.file_index);
+                if (found >= 0 && found != f) return -1;
+                found = f;
+            }
+            return found;
+        };
+
+        for (int first = 0; first < num_pieces;) {
+            const int file = owner(first);
+            int count = 1;
+            if (file >= 0) {
+                while (first + count < num_pieces && owner(first + count) == file) ++count;
+            }
+            CacheKey key("v1");
+            key.add(piece_length).add(count);
+            bool cacheable = describe_piece(files, ids, first, key);
+            if (count > 1) cacheable = cacheable && describe_piece(files, ids, first + count - 1, key);
+
+            if (cacheable) {
+                const V1Run run{key.key(), first, count};
+                if (cache->lookup(run.key, payload) && payload.size() == count * sizeof(lt::sha1_hash)) {
+                    for (int i = 0; i < count; ++i) {
+                        std::memcpy(v1_slots[first + i].data(), payload.data() + i * sizeof(lt::sha1_hash),
+                                    sizeof(lt::sha1_hash));
+                        plan.need_v1[first + i] = 0;
+                    }
+                } else {
+                    plan.v1_store.push_back(run);
+                }
+            }
+            first += count;
+        }
+    }
+
+    if (want_v2) {
+        for (lt::file_index_t f : files.file_range()) {
+            const std::string& id = ids[static_cast<int>(f)];
+            if (id.empty()) continue;
+            const int first = static_cast<int>(files.file_offset(f) / piece_length);
+            const int count = static_cast<int>((files.file_size(f) + piece_length - 1) / piece_length);
+
+            const V2Tree tree{CacheKey("v2").add(piece_length).add(std::string_view(id)).key(), f, first, count};
+            const size_t expected = (count + 1) * sizeof(lt::sha256_hash);
+            bool hit = cache->lookup(tree.key, payload) && payload.size() == expected;
+            std::vector<lt::sha256_hash> layer(hit ? count : 0);
+            if (hit) {
+                lt::sha256_hash root;
+                std::memcpy(root.data(), payload.data(), sizeof(root));
+                for (int i = 0; i < count; ++i) {
+                    std::memcpy(layer[i].data(), payload.data() + (i + 1) * sizeof(lt::sha256_hash), sizeof(root));
+                }
+                // The stored root doubles as an integrity check of the layer
+                hit = merkle::layer_root(layer, piece_length) == root;
+            }
+            if (!hit) {
+                plan.v2_store.push_back(tree);
+                continue;
+            }
+            for (int i = 0; i < count; ++i) {
+                v2_slots[first + i] = {f, lt::piece_index_t::diff_type(i), layer[i]};
+                plan.need_v2[first + i] = 0;
+            }
+        }
+    }
+
+    return plan;
+}
+
+// Saves the records the plan could not find, now that their pieces are hashed.
+void store_hashes(HashCache& cache, const HashPlan& plan, int piece_length,
+                  const std::vector<lt::sha1_hash>& v1_slots, const std::vector<PieceLayerHash>& v2_slots)
+{
+    for (const V1Run& run : plan.v1_store) {
+        cache.store(run.key, reinterpret_cast<const char*>(v1_slots.data() + run.first),
+                    run.count * sizeof(lt::sha1_hash));
+    }
+    for (const V2Tree& tree : plan.v2_store) {
+        std::vector<lt::sha256_hash> layer(tree.count);
+        for (int i = 0; i < tree.count; ++i) layer[i] = v2_slots[tree.first + i].hash;
+        std::vector<lt::sha256_hash> record;
+        record.reserve(tree.count + 1);
+        record.push_back(merkle::layer_root(layer, piece_length));
+        record.insert(record.end(), layer.begin(), layer.end());
+        cache.store(tree.key, reinterpret_cast<const char*>(record.data()), record.size() * sizeof(lt::sha256_hash));
+    }
+}
+
+// True when two configurations select the same files of the same path.
+bool same_content(const TorrentConfig& a, const TorrentConfig& b) {
+    return a.path == b.path && a.filter == b.filter;
+}
+
+}
 
 // Constructor for TorrentCreator
 TorrentCreator::TorrentCreator(TorrentConfig config)
     : config_(std::move(config)) {
 }
 
+void TorrentCreator::add_output(TorrentConfig config) {
+    if (config.version != config_.version || !same_content(config, config_)) {
+        throw std::invalid_argument("Output " + config.output.string()
+            + " does not share content and version with " + config_.output.string());
+    }
+    extra_outputs_.push_back(std::move(config));
+}
+
+// Groups configurations by the layout they hash to. The auto piece size is
+// resolved from the scanned content size exactly as create_torrent() does,
+// so an explicit size equal to the automatic one still shares the pass.
+// v1 outputs at different piece sizes share a pass too (one read, one
+// SHA-1 per size).
+CreationStats TorrentCreator::create_torrents(std::vector<TorrentConfig> configs) {
+    std::vector<std::unique_ptr<TorrentCreator>> groups;
+    std::vector<int> group_piece_sizes;
+    for (auto& config : configs) {
+        if (!config.content_index) {
+            for (const auto& group : groups) {
+                const TorrentConfig& primary = group->config_;
+                if (same_content(primary, config)) {
+                    config.content_index = primary.content_index;
+                    break;
+                }
+            }
+            if (!config.content_index) {
+                config.content_index = ContentIndex::scan(config.path, config.filter);
+            }
+        }
+        const int piece_size = config.piece_size.value_or(utils::auto_piece_size(config.content_index->total_size()));
+
+        bool grouped = false;
+        for (size_t g = 0; g < groups.size() && !grouped; ++g) {
+            const TorrentConfig& primary = groups[g]->config_;
+            const bool same_size = group_piece_sizes[g] == piece_size || config.version == TorrentVersion::V1;
+            if (same_size && primary.version == config.version && same_content(primary, config)) {
+                groups[g]->add_output(std::move(config));
+                grouped = true;
+            }
+        }
+        if (!grouped) {
+            groups.push_back(std::make_unique<TorrentCreator>(std::move(config)));
+            group_piece_sizes.push_back(piece_size);
+        }
+    }
+
+    log_message(std::to_string(configs.size()) + " output(s) in " + std::to_string(groups.size())
+        + " hashing pass(es)", LogLevel::INFO);
+    CreationStats stats;
+    for (auto& group : groups) {
+        group->create_torrent();
+        stats += group->stats();
+    }
+    return stats;
+}
+
 
 lt::create_flags_t TorrentCreator::get_torrent_flags(TorrentVersion version) {
     lt::create_flags_t flags = {};
@@ -38,288 +414,331 @@ lt::create_flags_t TorrentCreator::get_torrent_flags(TorrentVersion version) {
     return flags;
 }
 
+    // Fills fs_ from the job's ContentIndex: the patterns were applied and every
+    // file stat-ed during the scan, so no directory is walked again here.
     void TorrentCreator::add_files_to_storage() {
-        if (fs::is_directory(config_.path)) {
-            const auto &exclude_regex = config_.exclude_regex;
-            const auto &include_regex = config_.include_regex;
-
-            int file_count_before = fs_.num_files();
-
-            if (exclude_regex.empty() && include_regex.empty()) {
-                lt::add_files(fs_, config_.path.string(), [](std::string const&) { return true; });
-            } else {
-                fs::path base = fs::absolute(config_.path);
-                int dirs_excluded = 0;
-                int files_excluded = 0;
-
-                // lt::add_files callback signature is (std::string const&) — only a path string,
-                // no file type information. is_directory() is mandatory to distinguish files from
-                // directories for pruning. There is no alternative without replacing lt::add_files.
-                lt::add_files(fs_, config_.path.string(),
-                    [&base, &exclude_regex, &include_regex, &dirs_excluded, &files_excluded](std::string const &file_path) {
-                        std::error_code ec;
-                        fs::path rel = fs::path(file_path).lexically_relative(base);
-
-                        // Fail-open: if lexically_relative fails (different mount points, symlinks),
-                        // include the entry rather than silently dropping it. This guard is
-                        // defense-in-depth — lt::add_files always passes paths within the base tree.
-                        if (rel.empty()) {
-                            log_message("Could not compute relative path for: " + file_path, LogLevel::WARNING);
-                            return true;
-                        }
-                        std::string rel_str = rel.generic_string();
-                        if (fs::is_directory(file_path, ec)) {
-                            // When include patterns exist, never prune directories — their files
-                            // must be checked individually against include rules.
-                            if (!include_regex.empty()) return true;
-                            std::string dir_path = rel_str + "/";
-                            for (const auto &re : exclude_regex) {
-                                if (std::regex_match(dir_path, re) || std::regex_match(rel_str, re)) {
-                                    ++dirs_excluded;
-                                    return false;
-                                }
-                            }
-                            return true;
-                        }
-                        if (!utils::should_include_file(rel_str, exclude_regex, include_regex)) {
-                            ++files_excluded;
-                            log_message("Excluded by pattern: " + rel_str, LogLevel::INFO);
-                            return false;
-                        }
-                        return true;
-                    });
+        const ContentIndex &index = *config_.content_index;
+        if (index.is_directory()) {
+            const std::string root_name = config_.path.filename().string();
+            for (const auto &entry : index.files()) {
+                lt::file_flags_t flags = {};
+                if (entry.executable) flags |= lt::file_storage::flag_executable;
+                fs_.add_file(root_name + "/" + entry.path, entry.size, flags,
+                             static_cast<std::time_t>(entry.mtime_ns / 1000000000));
+            }
 
-                int files_added = fs_.num_files() - file_count_before;
-                std::string filter_summary = "Pattern filter: " + std::to_string(files_added) + " file(s) included";
-                if (files_excluded > 0) filter_summary += ", " + std::to_string(files_excluded) + " file(s) excluded";
-                if (dirs_excluded > 0) filter_summary += ", " + std::to_string(dirs_excluded) + " directory(ies) excluded";
+            if (!config_.filter.empty()) {
+                std::string filter_summary = "Pattern filter: " + std::to_string(fs_.num_files()) + " file(s) included";
+                if (index.files_excluded() > 0) filter_summary += ", " + std::to_string(index.files_excluded()) + " file(s) excluded";
+                if (index.dirs_excluded() > 0) filter_summary += ", " + std::to_string(index.dirs_excluded()) + " directory(ies) excluded";
                 log_message(filter_summary);
             }
 
             if (fs_.num_files() == 0) {
                 throw std::runtime_error("No files matched the specified patterns ("
-                    + std::to_string(config_.exclude_regex.size()) + " exclude, "
-                    + std::to_string(config_.include_regex.size()) + " include). "
+                    + std::to_string(config_.filter.exclude_patterns().size()) + " exclude, "
+                    + std::to_string(config_.filter.include_patterns().size()) + " include). "
                     "Torrent would be empty.");
             }
         } else {
-            fs_.add_file(config_.path.filename().string(), fs::file_size(config_.path));
+            fs_.add_file(config_.path.filename().string(), index.total_size());
         }
     }
 
-// Hashing with streaming for large files
-void TorrentCreator::hash_large_file_parallel(const fs::path& path, lt::create_torrent& t, int piece_size, TerminalGuard& guard) {
-    const int64_t file_size = fs::file_size(path);
-    // Hashing is CPU-bound SHA-1, so matching thread count to physical cores
-    // maximizes throughput without oversubscribing the CPU.
-    const int num_threads = std::thread::hardware_concurrency();
-    const int64_t block_size = (file_size / num_threads) + 1; // +1 prevents dropping last block on integer truncation
-
-    std::vector<std::thread> threads;
-    std::mutex mutex;
-    std::atomic<bool> cancel{false};
-
-    for (int i = 0; i < num_threads; ++i) {
-        int64_t start_offset = i * block_size;
-        int64_t end_offset = std::min(start_offset + block_size, file_size);
-
-        threads.emplace_back(&TorrentCreator::hash_block, this, path, std::ref(t), piece_size, start_offset, end_offset, std::ref(mutex), std::ref(cancel));
+// Hashes every piece of a (possibly multi-file) storage as a two-stage pipeline.
+// A PieceStream reads each piece once into a bounded set of buffers (io_uring
+// where available, reader threads otherwise); every completed buffer is queued
+// once per hash family, so for hybrid torrents the v1 SHA-1 and the v2 SHA-256
+// leaves of the same data are computed concurrently by different hasher threads.
+// A buffer returns to the stream when the last family finishes with it.
+// Pieces whose hashes the persistent cache already holds for unchanged
+// content are never read.
+//
+// The first torrent is the one read. Any further torrents are v1 layouts of
+// the same bytes at smaller power-of-two piece sizes: each buffer then also
+// yields their pieces, hashed by separate tasks, so extra sizes cost CPU only.
+void TorrentCreator::hash_storage_parallel(const std::vector<lt::create_torrent*>& torrents, TerminalGuard& guard) {
+    lt::create_torrent& t = *torrents.front();
+    const lt::file_storage& files = t.files();
+    const std::string save_path = config_.path.parent_path().string();
+    const int num_pieces = t.num_pieces();
+    const int piece_length = t.piece_length();
+    const bool want_v1 = !t.is_v2_only();
+    const bool want_v2 = !t.is_v1_only();
+    const int num_torrents = static_cast<int>(torrents.size());
+
+    // Digests land in per-piece slots without locking and are committed to
+    // the torrents in one pass after the pipeline drains; cached ones are
+    // filled in up front.
+    std::vector<std::vector<lt::sha1_hash>> v1_slots(num_torrents);
+    std::vector<PieceLayerHash> v2_slots(want_v2 ? num_pieces : 0);
+    std::vector<HashPlan> plans;
+    std::vector<int> pieces_per_read(num_torrents, 1);
+    for (int i = 0; i < num_torrents; ++i) {
+        const lt::create_torrent& ti = *torrents[i];
+        v1_slots[i].resize(i > 0 || want_v1 ? ti.num_pieces() : 0);
+        pieces_per_read[i] = piece_length / ti.piece_length();
+        plans.push_back(plan_hashing(ti.files(), *config_.content_index, config_.path, config_.hash_cache.get(),
+                                     i > 0 || want_v1, i == 0 && want_v2, v1_slots[i], v2_slots));
     }
 
-    // Monitor thread polls for 'q' keypress while workers block on I/O;
-    // signals shutdown via cancel atomic so workers can exit cleanly.
-    std::thread monitor([&guard, &cancel]() {
-        while (!cancel.load()) {
-            char c = 0;
-            if (guard.check_key_press(c)) {
-                if (c == 'q' || c == 'Q' || c == '\x03') {
-                    cancel.store(true);
-                    return;
+    // Tasks a read piece needs: one per family of the read torrent, plus one
+    // per smaller size that still lacks any of the pieces inside it.
+    auto extra_pieces = [&](int torrent, int read_piece) {
+        const int first = read_piece * pieces_per_read[torrent];
+        return std::pair{first, std::min(first + pieces_per_read[torrent], torrents[torrent]->num_pieces())};
+    };
+    auto tasks_for = [&](int p) {
+        int needed = plans[0].need_v1[p] + plans[0].need_v2[p];
+        for (int i = 1; i < num_torrents; ++i) {
+            const auto [first, last] = extra_pieces(i, p);
+            for (int q = first; q < last; ++q) {
+                if (plans[i].need_v1[q]) {
+                    ++needed;
+                    break;
                 }
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-    });
-
-    for (auto& thread : threads) {
-        thread.join();
-    }
-
-    bool interrupted = cancel.exchange(true);
-    monitor.join();
-
-    if (interrupted) {
-        log_message("Process interrupted by user", LogLevel::WARNING);
-        throw UserInterrupt("Process interrupted by user");
+        return needed;
+    };
+
+    std::vector<int> todo;
+    int hash_tasks = 0;
+    int64_t reused_bytes = 0;
+    for (int p = 0; p < num_pieces; ++p) {
+        const int needed = tasks_for(p);
+        if (needed > 0) todo.push_back(p);
+        else reused_bytes += files.piece_size(lt::piece_index_t(p));
+        hash_tasks += needed;
     }
-}
-
-void TorrentCreator::hash_block(const fs::path& path, lt::create_torrent& t, int piece_size, int64_t start_offset, int64_t end_offset, std::mutex& mutex, std::atomic<bool>& cancel) {
-    const size_t buffer_size = PieceSizes::k16384KB; // Largest supported piece size; minimizes read syscalls
-    std::vector<char> buffer(buffer_size);
-    std::ifstream file(path, std::ios::binary);
-
-    if (!file) {
-        throw std::runtime_error("Failed to open file: " + path.string());
+    if (config_.hash_cache) {
+        const std::string reused = std::to_string(num_pieces - static_cast<int>(todo.size())) + " of "
+            + std::to_string(num_pieces) + " pieces reused from the hash cache ("
+            + utils::format_size(reused_bytes) + " not read)";
+        print_verbose("Hash cache: " + reused + "\n");
+        log_message("Hash cache: " + reused, LogLevel::INFO);
     }
+    const int num_todo = static_cast<int>(todo.size());
+    stats_.bytes_read += files.total_size() - reused_bytes;
+
+    // Hashing runs on the process-wide executor, so concurrent jobs share one
+    // core budget instead of each starting a thread per core.
+    HashExecutor& executor = HashExecutor::shared();
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int num_hashers = std::max(1, std::min(executor.threads(), hash_tasks));
+    const int num_readers = std::max(1, std::min({cores / 4, 4, num_todo}));
+
+    // Enough buffers to keep every hasher busy (a full batch of SIMD lanes
+    // each for v1) with reads in flight behind them, within the memory budget.
+    // Two buffers are the floor so reading and hashing still overlap.
+    const int64_t budget = config_.hash_memory > 0 ? config_.hash_memory : HashMemory::kDefaultBytes;
+    const int lanes = want_v1 ? hash_backend::batch_size() : 1;
+    const int wanted_buffers = num_hashers * lanes + 2 * num_readers;
+    const int pool_size = static_cast<int>(std::max<int64_t>(2,
+        std::min<int64_t>(wanted_buffers, budget / piece_length)));
+    const size_t batch = static_cast<size_t>(std::clamp(pool_size / num_hashers, 1, std::max(4, lanes)));
+
+    hash_with_monitor(t, guard, [&](std::atomic<int64_t>& bytes_done, std::atomic<bool>& cancel) {
+        bytes_done.fetch_add(reused_bytes, std::memory_order_relaxed);
+        if (todo.empty()) return;
+
+        auto stream = PieceStream::for_storage(files, save_path, pool_size, todo);
+        WorkQueue<HashTask> tasks;
+        auto group = executor.make_group();
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        auto fail = [&](std::exception_ptr e) {
+            {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) error = e;
+            }
+            cancel.store(true);
+        };
 
-    file.seekg(start_offset); // Position the file at the start of the block
+        // Each drain takes up to a batch of queued tasks so the v1 digests
+        // reach the hash backend together; v2 pieces batch their leaves
+        // internally. Drains run on the executor and never wait for work.
+        auto drain = [&]() {
+            thread_local std::vector<HashTask> batch_tasks;
+            thread_local std::vector<HashInput> inputs;
+            thread_local std::vector<lt::sha1_hash*> targets;
+            thread_local std::vector<lt::sha1_hash> digests;
+            if (tasks.try_pop_batch(batch_tasks, batch)) {
+                // After a failure keep draining so buffers still return to the stream.
+                if (!cancel.load()) {
+                    try {
+                        inputs.clear();
+                        targets.clear();
+                        for (const auto& task : batch_tasks) {
+                            StreamPiece* piece = task.piece;
+                            if (task.family == HashFamily::V2) {
+                                v2_slots[task.index] = hash_piece_v2(files, lt::piece_index_t(task.index),
+                                                                     piece->data.data());
+                            } else if (task.torrent == 0) {
+                                inputs.push_back({piece->data.data(), piece->size});
+                                targets.push_back(&v1_slots[0][task.index]);
+                            } else {
+                                // The smaller pieces lie back to back in the buffer
+                                const int length = torrents[task.torrent]->piece_length();
+                                const auto [first, last] = extra_pieces(task.torrent, task.index);
+                                for (int q = first; q < last; ++q) {
+                                    if (!plans[task.torrent].need_v1[q]) continue;
+                                    const int offset = (q - first) * length;
+                                    inputs.push_back({piece->data.data() + offset, std::min(length, piece->size - offset)});
+                                    targets.push_back(&v1_slots[task.torrent][q]);
+                                }
+                            }
+                        }
+                        digests.resize(inputs.size());
+                        hash_backend::sha1(inputs.data(), digests.data(), static_cast<int>(inputs.size()));
+                        for (size_t k = 0; k < targets.size(); ++k) {
+                            *targets[k] = digests[k];
+                        }
+                    } catch (...) {
+                        fail(std::current_exception());
+                    }
+                }
+                for (const auto& task : batch_tasks) {
+                    StreamPiece* piece = task.piece;
+                    if (piece->pending.fetch_sub(1) == 1) {
+                        bytes_done.fetch_add(piece->size, std::memory_order_relaxed);
+                        stream->release(piece);
+                    }
+                }
+            }
+        };
 
-    int64_t bytes_processed = 0;
-    lt::piece_index_t piece_index(static_cast<int>(start_offset / piece_size));
-    lt::hasher piece_hasher;
-    int bytes_in_current_piece = 0;
-    
-    int64_t file_size = fs::file_size(path);
-    auto start_time = std::chrono::steady_clock::now();
-
-    while (file && (start_offset + bytes_processed) < end_offset) {
-        size_t bytes_to_read = std::min(buffer_size, static_cast<size_t>(end_offset - (start_offset + bytes_processed)));
-        file.read(buffer.data(), bytes_to_read);
-        size_t bytes_read = file.gcount();
-
-        // Process the buffer
-        size_t remaining = bytes_read;
-        size_t offset = 0;
-
-        while (remaining > 0) {
-            size_t chunk = std::min(remaining, static_cast<size_t>(piece_size - bytes_in_current_piece));
-            piece_hasher.update(buffer.data() + offset, chunk);
-            offset += chunk;
-            bytes_processed += chunk;
-            bytes_in_current_piece += chunk;
-
-            if (bytes_in_current_piece == piece_size) {
-                std::lock_guard<std::mutex> lock(mutex); // Synchronize access to object `t`
-                t.set_hash(piece_index, piece_hasher.final());
-                piece_index = lt::piece_index_t(static_cast<int>(piece_index) + 1);
-                piece_hasher.reset();
-                bytes_in_current_piece = 0;
+        // Completed reads go straight to the hashers, once per hash family
+        // and once per extra piece size
+        auto on_ready = [&](StreamPiece* piece) {
+            const int index = todo[piece->index];
+            if (!piece->complete()) {
+                fail(std::make_exception_ptr(std::runtime_error("Failed to read piece "
+                    + std::to_string(index) + ": " + piece->error)));
+                stream->release(piece);
+                return;
             }
+            const int count = tasks_for(index);
+            piece->pending.store(count);
+            if (plans[0].need_v1[index]) tasks.push({piece, HashFamily::V1, index});
+            if (plans[0].need_v2[index]) tasks.push({piece, HashFamily::V2, index});
+            for (int i = 1; i < num_torrents; ++i) {
+                const auto [first, last] = extra_pieces(i, index);
+                for (int q = first; q < last; ++q) {
+                    if (plans[i].need_v1[q]) {
+                        tasks.push({piece, HashFamily::V1, index, i});
+                        break;
+                    }
+                }
+            }
+            // One drain per task: every task is taken by some drain, and a
+            // backlog still reaches the hash backend in batches.
+            for (int k = 0; k < count; ++k) {
+                group->submit(drain);
+            }
+        };
+
+        try {
+            stream->run(on_ready, cancel, num_readers);
+        } catch (...) {
+            fail(std::current_exception());
         }
+        tasks.close();
+        group->wait();
 
-        // Update progress safely
-        {
-            std::lock_guard<std::mutex> lock(progress_mutex_);
-            total_processed_ += bytes_read;
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
-            double speed = elapsed > 0 ? static_cast<double>(total_processed_) / elapsed : 0.0;
-            double eta = speed > 0 ? (file_size - total_processed_) / speed : 0.0;
-            
-            print_progress_bar(static_cast<int>(total_processed_ / piece_size),
-                             static_cast<int>(file_size / piece_size),
-                             speed,
-                             eta,
-                             total_processed_, 
-                             file_size);
+        if (error) {
+            std::rethrow_exception(error);
         }
+    });
 
-        if (cancel.load()) {
-            return;
+    for (int i = 0; i < num_torrents; ++i) {
+        lt::create_torrent& ti = *torrents[i];
+        if (config_.hash_cache) {
+            store_hashes(*config_.hash_cache, plans[i], ti.piece_length(), v1_slots[i], v2_slots);
+        }
+        for (int p = 0; p < static_cast<int>(v1_slots[i].size()); ++p) {
+            ti.set_hash(lt::piece_index_t(p), v1_slots[i][p]);
         }
     }
-
-    // Finalize the last piece if necessary
-    if (bytes_in_current_piece > 0) {
-        std::lock_guard<std::mutex> lock(mutex);
-        t.set_hash(piece_index, piece_hasher.final());
+    for (const auto& layer : v2_slots) {
+        if (layer.file != lt::file_index_t(-1)) {
+            t.set_hash2(layer.file, layer.piece, layer.hash);
+        }
     }
 }
 
-void TorrentCreator::hash_large_file(const fs::path& path, lt::create_torrent& t, int piece_size, TerminalGuard& guard) {
-    const size_t buffer_size = PieceSizes::k16384KB; // Largest supported piece size; minimizes read syscalls
-    std::vector<char> buffer(buffer_size);
-    std::ifstream file(path, std::ios::binary);
-
-    if (!file) {
-        throw std::runtime_error("Failed to open file: " + path.string());
-    }
+// Runs a hashing job on the calling thread while a monitor thread reports progress
+// and polls for 'q' keypress; 30s without progress is treated as a stalled filesystem.
+// The job advances `bytes_done` and must return promptly once `cancel` is set.
+void TorrentCreator::hash_with_monitor(const lt::create_torrent& t, TerminalGuard& guard,
+                                       const std::function<void(std::atomic<int64_t>&, std::atomic<bool>&)>& job) {
+    const int64_t total_size = t.files().total_size();
+    const int piece_length = t.piece_length();
+    const int num_pieces = t.num_pieces();
 
-    int64_t total_bytes = fs::file_size(path);
-    int64_t bytes_processed = 0;
-    lt::piece_index_t piece_index(0);
-    lt::hasher piece_hasher;
-    int bytes_in_current_piece = 0;
-
-    auto start_time = std::chrono::steady_clock::now();
-    double speed = 0.0;
-    double eta = 0.0;
-
-    while (file) {
-        file.read(buffer.data(), buffer.size());
-        size_t bytes_read = file.gcount();
-
-        // Process buffer
-        size_t remaining = bytes_read;
-        size_t offset = 0;
-
-        while (remaining > 0) {
-            size_t chunk = std::min(remaining, static_cast<size_t>(piece_size - bytes_in_current_piece));
-            piece_hasher.update(buffer.data() + offset, chunk);
-            offset += chunk;
-            remaining -= chunk;
-            bytes_processed += chunk;
-            bytes_in_current_piece += chunk;
-
-            if (bytes_in_current_piece == piece_size) {
-                t.set_hash(piece_index, piece_hasher.final());
-                piece_index = lt::piece_index_t(static_cast<int>(piece_index) + 1);
-                piece_hasher.reset();
-                bytes_in_current_piece = 0;
-
-                // Calculate speed and ETA
-                auto now = std::chrono::steady_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
-                if (elapsed > 0) {
-                    speed = static_cast<double>(bytes_processed) / elapsed; // bytes per second
-                    double remaining_bytes = total_bytes - bytes_processed;
-                    eta = remaining_bytes / speed; // in seconds
-                }
+    std::atomic<int64_t> bytes_done{0};
+    std::atomic<bool> cancel{false};
+    std::atomic<bool> finished{false};
+    bool interrupted = false;
+    bool timed_out = false;
 
-                // Update progress bar
-                print_progress_bar(static_cast<int>(bytes_processed / piece_size),
-                                 static_cast<int>(total_bytes / piece_size),
-                                 speed, eta, bytes_processed, total_bytes);
+    std::thread monitor([&]() {
+        auto start_time = std::chrono::steady_clock::now();
+        auto last_progress_time = start_time;
+        int64_t last_done = 0;
+        while (!finished.load()) {
+            auto now = std::chrono::steady_clock::now();
+            int64_t processed = bytes_done.load(std::memory_order_relaxed);
+            if (processed != last_done) {
+                last_done = processed;
+                last_progress_time = now;
+            } else if (std::chrono::duration_cast<std::chrono::seconds>(now - last_progress_time).count() > 30) {
+                timed_out = true;
+                cancel.store(true);
+                return;
             }
-        }
-
-        // --- Check for timeout and user interruption ---
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time);
 
-        if (elapsed.count() > 30) { // 30s stall threshold: filesystem freeze or unresponsive I/O
-            log_message("Hashing timeout after 30 seconds", LogLevel::ERR);
-            throw UserInterrupt("Hashing timeout");
-        }
+            double elapsed = std::chrono::duration<double>(now - start_time).count();
+            double speed = elapsed > 0 ? processed / elapsed : 0.0;
+            double eta = speed > 0 ? (total_size - processed) / speed : 0.0;
+            print_progress_bar(static_cast<int>(processed / piece_length), num_pieces, speed, eta, processed, total_size);
 
-        char c = 0;
-        if (guard.check_key_press(c)) {
-            if (c == 'q' || c == 'Q' || c == '\x03') {
-                log_message("Process interrupted by user", LogLevel::WARNING);
-                throw UserInterrupt("Process interrupted by user");
+            char c = 0;
+            if (guard.check_key_press(c)) {
+                if (c == 'q' || c == 'Q' || c == '\x03') {
+                    interrupted = true;
+                    cancel.store(true);
+                    return;
+                }
             }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
-        // --- End of timeout and user interruption check ---
-    }
+    });
 
-    // Final piece if any
-    if (bytes_in_current_piece > 0) {
-        t.set_hash(piece_index, piece_hasher.final());
+    std::exception_ptr error;
+    try {
+        job(bytes_done, cancel);
+    } catch (...) {
+        error = std::current_exception();
     }
 
-    // Update final progress bar
-    auto now = std::chrono::steady_clock::now();
-    auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
-    if (elapsed > 0) {
-        speed = static_cast<double>(bytes_processed) / elapsed;
+    finished.store(true);
+    monitor.join();
+
+    if (interrupted) {
+        log_message("Process interrupted by user", LogLevel::WARNING);
+        throw UserInterrupt("Process interrupted by user");
+    }
+    if (timed_out) {
+        log_message("Hashing timeout after 30 seconds", LogLevel::ERR);
+        throw UserInterrupt("Hashing timeout");
+    }
+    if (error) {
+        std::rethrow_exception(error);
     }
-    print_progress_bar(static_cast<int>(bytes_processed / piece_size),
-                     static_cast<int>(total_bytes / piece_size),
-                     speed, 0.0, bytes_processed, total_bytes);
 }
 
-// Displays a progress bar
 void TorrentCreator::print_progress_bar(int progress, int total, double speed, double eta, int64_t processed, int64_t total_size) const {
     if (config_.silent) return;
     print_progress(progress, total, speed, eta, processed, total_size);
@@ -332,6 +751,12 @@ void TorrentCreator::create_torrent() {
     
     try {
         log_message("Starting torrent creation for: " + config_.path.string(), LogLevel::INFO);
+        // Scan the content once (unless the caller already did); the disk
+        // check and the file storage both read from this snapshot.
+        if (!config_.content_index) {
+            config_.content_index = ContentIndex::scan(config_.path, config_.filter);
+        }
+
         // Check available disk space
         fs::path output_dir = config_.output.parent_path();
         if (output_dir.empty()) {
@@ -340,17 +765,8 @@ void TorrentCreator::create_torrent() {
 
         try {
             fs::space_info si = fs::space(output_dir);
-            int64_t required_space = 0;
-            if (fs::is_directory(config_.path)) {
-                for (const auto& entry : fs::recursive_directory_iterator(config_.path)) {
-                    if (entry.is_regular_file()) {
-                        required_space += entry.file_size();
-                    }
-                }
-            } else {
-                required_space = fs::file_size(config_.path);
-            }
-            
+            int64_t required_space = config_.content_index->total_size();
+
             if (si.available < required_space * 1.1) { // 10% buffer for filesystem metadata overhead
                 throw std::runtime_error("Not enough disk space. Required: " + 
                     std::to_string(required_space) + " bytes, Available: " + 
@@ -376,211 +792,187 @@ void TorrentCreator::create_torrent() {
             print_verbose("Piece size: " + std::to_string(piece_size / 1024) + " KB (auto-calculated for " + utils::format_size(fs_.total_size()) + " total)\n");
             log_message("Piece size: " + std::to_string(piece_size / 1024) + " KB (auto-calculated for " + std::to_string(fs_.total_size()) + " bytes)", LogLevel::INFO);
         }
+        // Outputs at other piece sizes share the read when the layouts are v1:
+        // without pad files every size sees the same byte stream.
+        auto output_piece_size = [&](const TorrentConfig& output) {
+            return output.piece_size.value_or(utils::auto_piece_size(fs_.total_size()));
+        };
+        std::vector<int> sizes{piece_size};
+        for (const auto& extra : extra_outputs_) {
+            const int size = output_piece_size(extra);
+            if (std::ranges::contains(sizes, size)) continue;
+            if (config_.version != TorrentVersion::V1) {
+                throw std::runtime_error("Output " + extra.output.string() + " needs "
+                    + std::to_string(size / 1024) + " KB pieces, not "
+                    + std::to_string(piece_size / 1024) + " KB; it cannot share this hashing pass");
+            }
+            sizes.push_back(size);
+        }
+        std::ranges::sort(sizes, std::greater<>());
+        for (int size : sizes) {
+            if (sizes.front() % size != 0) {
+                throw std::runtime_error("Piece size " + std::to_string(size / 1024) + " KB does not divide "
+                    + std::to_string(sizes.front() / 1024) + " KB; it cannot share this hashing pass");
+            }
+        }
         lt::create_flags_t flags = get_torrent_flags(config_.version);
 
-        lt::create_torrent t(fs_, piece_size, flags);
-
-        // Add trackers to create_torrent object
-        int tier = 0;
-        for (const auto& tracker : config_.trackers) {
-            t.add_tracker(tracker, tier++);
-            print_verbose("Tracker tier " + std::to_string(tier - 1) + ": " + tracker + "\n");
+        // Trackers, web seeds and the other per-output fields are applied to
+        // the generated entry by write_output(), so every output can reuse it.
+        // lt::create_torrent keeps a reference to its storage and sets the
+        // piece length on it, so each extra size gets a copy of fs_.
+        std::vector<lt::file_storage> storages(sizes.size() - 1, fs_);
+        std::vector<std::unique_ptr<lt::create_torrent>> torrents;
+        std::vector<lt::create_torrent*> passes;
+        for (size_t i = 0; i < sizes.size(); ++i) {
+            torrents.push_back(std::make_unique<lt::create_torrent>(i == 0 ? fs_ : storages[i - 1], sizes[i], flags));
+            passes.push_back(torrents.back().get());
+        }
+        if (sizes.size() > 1) {
+            std::string list;
+            for (int size : sizes) list += (list.empty() ? "" : ", ") + std::to_string(size / 1024);
+            print_verbose("Hashing " + std::to_string(sizes.size()) + " piece sizes from one read: " + list + " KB\n");
+            log_message("Hashing " + std::to_string(sizes.size()) + " piece sizes from one read: " + list + " KB", LogLevel::INFO);
         }
 
         // Set piece hashes using streaming for large files
         print_info("Hashing pieces...\n");
         log_message("Starting hashing process for: " + config_.path.string(), LogLevel::INFO);
-        int num_pieces = t.num_pieces();
-
-        auto start_time = std::chrono::steady_clock::now();
-        double speed = 0.0;
-        double eta = 0.0;
+        int num_pieces = passes.front()->num_pieces();
         int64_t total_size = fs_.total_size(); // Total size in bytes
-        int64_t piece_size_bytes = piece_size; // Piece size in bytes
-
-        int progress = 0; // Progress variable
-
-        // Define the progress_callback with additional calculations
-        auto progress_callback = [&](lt::piece_index_t piece) mutable {
-            progress = static_cast<int>(piece); // Update progress
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - start_time).count();
-            
-            if (elapsed > 0) {
-                // Calculate speed in pieces per second
-                double pieces_per_second = static_cast<double>(progress) / elapsed;
-                // Estimate bytes processed
-                int64_t processed = progress * piece_size_bytes;
-                // Calculate speed in bytes per second
-                speed = static_cast<double>(processed) / elapsed;
-                // Estimate ETA in seconds
-                int remaining_pieces = num_pieces - progress;
-                eta = (pieces_per_second > 0) ? (remaining_pieces / pieces_per_second) : 0.0;
-            } else {
-                speed = 0.0;
-                eta = 0.0;
-            }
 
-            // Call print_progress_bar with all six arguments
-            print_progress_bar(progress, num_pieces, speed, eta, progress * piece_size_bytes, total_size);
+        // Every layout goes through the storage pipeline: a few sequential readers
+        // fill a fixed buffer pool and the hashers consume it, so memory stays
+        // within config_.hash_memory whatever the core count.
+        const auto hash_start = std::chrono::steady_clock::now();
+        hash_storage_parallel(passes, guard);
+        stats_.hash_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - hash_start).count();
+
+        // Hashing is complete at this point - just show final progress
+        print_progress_bar(num_pieces, num_pieces, 0.0, 0.0, total_size, total_size);
+        print_info("\n");
+
+        const auto write_start = std::chrono::steady_clock::now();
+        std::vector<lt::entry> generated;
+        for (auto* t : passes) {
+            t->set_creation_date(0);
+            generated.push_back(t->generate());
+        }
+        const std::time_t creation_date = std::time(nullptr);
 
-            // Check for user interruption
-            char c = 0;
-            if (guard.check_key_press(c)) {
-                if (c == 'q' || c == 'Q' || c == '\x03') {
-                    log_message("Process interrupted by user", LogLevel::WARNING);
-                    throw UserInterrupt("Process interrupted by user");
-                }
-            }
+        auto write = [&](const TorrentConfig& output, int size) {
+            const size_t i = std::ranges::find(sizes, size) - sizes.begin();
+            write_output(output, generated[i], creation_date);
+            print_torrent_summary(output, total_size, size, passes[i]->num_pieces());
         };
+        write(config_, piece_size);
+        for (const auto& extra : extra_outputs_) {
+            write(extra, output_piece_size(extra));
+        }
+        stats_.write_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start).count();
 
-        // Set the hashes with the progress callback and error code
-        lt::error_code ec;
+    } catch (const UserInterrupt&) {
+        print_error("\n");
+        throw;
+    } catch (const std::runtime_error& e) {
+        print_error(std::string(e.what()) + "\n");
+        log_message("Runtime error: " + std::string(e.what()), LogLevel::ERR);
+        throw;
+    } catch (const std::exception& e) {
+        print_error(std::string("An unexpected error occurred: ") + e.what() + "\n");
+        log_message("Unexpected error: " + std::string(e.what()), LogLevel::ERR);
+        throw;
+    }
+}
 
-        if (fs::is_directory(config_.path) || config_.version == TorrentVersion::HYBRID) {
-            // Use libtorrent's native hashing to guarantee hybrid spec compliance for:
-            // 1. Directory inputs (always require both v1 and v2 hashes)
-            // 2. Explicitly requested hybrid torrents (even with single file inputs)
-            lt::set_piece_hashes(t, config_.path.parent_path().string(), progress_callback, ec);
+// Applies one output's metadata to the generated torrent and saves it. The
+// fields mirror what lt::create_torrent::generate() emits for them, so a
+// single output is byte-identical to generating it with the fields set.
+void TorrentCreator::write_output(const TorrentConfig& config, lt::entry e, std::time_t creation_date) const {
+    try {
+        // One tier per tracker, in order
+        for (size_t i = 0; i < config.trackers.size(); ++i) {
+            print_verbose("Tracker tier " + std::to_string(i) + ": " + config.trackers[i] + "\n");
+        }
+        if (!config.trackers.empty()) {
+            e["announce"] = config.trackers.front();
+        }
+        if (config.trackers.size() > 1) {
+            lt::entry::list_type announce_list;
+            for (const auto& tracker : config.trackers) {
+                lt::entry::list_type tier;
+                tier.emplace_back(tracker);
+                announce_list.emplace_back(std::move(tier));
+            }
+            e["announce-list"] = std::move(announce_list);
+        }
 
-        } else {
-            // For single large files, use our streaming hasher
-            if (fs::file_size(config_.path) > 1 * 1024 * 1024 * 1024) { // Below 1GB single-threaded is cheaper than thread coordination
-                hash_large_file_parallel(config_.path, t, piece_size, guard);
-            } else {
-                hash_large_file(config_.path, t, piece_size, guard);
+        if (config.web_seeds.size() == 1) {
+            e["url-list"] = config.web_seeds.front();
+        } else if (config.web_seeds.size() > 1) {
+            lt::entry::list_type url_list;
+            for (const auto& seed : config.web_seeds) {
+                url_list.emplace_back(seed);
             }
+            e["url-list"] = std::move(url_list);
         }
 
-        if (ec) {
-            log_message("Error setting piece hashes: " + ec.message(), LogLevel::ERR);
-            throw std::filesystem::filesystem_error("Error setting piece hashes: " + ec.message(), ec);
+        if (config.comment && !config.comment->empty()) {
+            e["comment"] = *config.comment;
         }
 
         // Set creation date if requested
-        if (config_.include_creation_date) {
-            t.set_creation_date(std::time(nullptr)); // Set to current time
-        } else {
-            t.set_creation_date(0); // Remove creation date
+        if (config.include_creation_date) {
+            e["creation date"] = static_cast<lt::entry::integer_type>(creation_date);
         }
 
         // Set creator if requested
-        if (config_.creator) {
-            t.set_creator(config_.creator->c_str()); // Set creator string
-        }
-        
-        // Check for user interruption and timeout
-        auto loop_start_time = std::chrono::steady_clock::now();
-        bool timeout_thrown = false;
-
-        // Only run progress loop for directory hashing (libtorrent async)
-        if (fs::is_directory(config_.path)) {
-            // Progress monitoring loop: polls hashing progress and user keypress
-            // until hashing completes or times out.
-            while (true) {
-                auto now = std::chrono::steady_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - loop_start_time);
-
-                // Reset: progress→0 each iteration so timeout detects stalls;
-                // timer refreshes only on meaningful progress.
-                if (progress > 0 && progress < num_pieces - 1) {
-                    loop_start_time = std::chrono::steady_clock::now();
-                    progress = 0;
-                }
-                
-                // progress == 0 means no piece completed since the last reset → stalled
-                if (elapsed.count() > 30 && !timeout_thrown && progress == 0) { // 30s stall threshold
-                    timeout_thrown = true;
-                    log_message("Hashing timeout after 30 seconds", LogLevel::ERR);
-                    throw UserInterrupt("Hashing timeout");
-                }
-
-                // Check for user interruption
-                char c = 0;
-                if (guard.check_key_press(c)) {
-                    if (c == 'q' || c == 'Q' || c == '\x03') {
-                        log_message("Process interrupted by user", LogLevel::WARNING);
-                        throw UserInterrupt("Process interrupted by user");
-                    }
-                }
-                
-                std::this_thread::sleep_for(std::chrono::milliseconds(10)); // keypress polling interval
-
-                if (progress >= num_pieces - 1) {
-                    print_progress_bar(num_pieces, num_pieces, speed, 0.0, total_size, total_size);
-                    print_info("\n");
-                    break;
-                }
-
-                std::this_thread::sleep_for(std::chrono::milliseconds(100)); // progress poll interval
-            }
-        } else {
-            // For single files, hashing is already complete - just show final progress
-            print_progress_bar(num_pieces, num_pieces, speed, 0.0, total_size, total_size);
-            print_info("\n");
+        if (config.creator && !config.creator->empty()) {
+            e["created by"] = *config.creator;
         }
 
-        // Generate and save torrent file
-        try {
-            std::ofstream out(config_.output, std::ios_base::binary);
-            if (!out) {
-                throw std::runtime_error("Failed to open output file: " + config_.output.string());
-            }
-
-            lt::entry e = t.generate();
-
-            if (config_.name) {
-                e["info"]["name"] = *config_.name;
-            }
-
-            if (config_.source) {
-                e["info"]["source"] = *config_.source;
-            }
+        if (config.is_private) {
+            e["info"]["private"] = lt::entry::integer_type(1);
+        }
 
-            if (config_.entropy) {
-                try {
-                    e["info"]["entropy"] = utils::generate_entropy_hex();
-                } catch (const std::exception& ex) {
-                    log_message("Failed to generate entropy: " + std::string(ex.what()), LogLevel::ERR);
-                    throw std::runtime_error("Failed to generate entropy: " + std::string(ex.what()));
-                }
-            }
+        if (config.name) {
+            e["info"]["name"] = *config.name;
+        }
 
-            lt::bencode(std::ostream_iterator<char>(out), e);
+        if (config.source) {
+            e["info"]["source"] = *config.source;
+        }
 
-            if (!out) {
-                throw std::runtime_error("Failed to write torrent file: " + config_.output.string());
+        if (config.entropy) {
+            try {
+                e["info"]["entropy"] = utils::generate_entropy_hex();
+            } catch (const std::exception& ex) {
+                log_message("Failed to generate entropy: " + std::string(ex.what()), LogLevel::ERR);
+                throw std::runtime_error("Failed to generate entropy: " + std::string(ex.what()));
             }
-
-            print_torrent_summary(fs_.total_size(), piece_size, t.num_pieces());
-            log_message("Torrent created successfully: " + config_.output.string(), LogLevel::INFO);
-            log_message("Torrent size: " + std::to_string(fs::file_size(config_.output)) + " bytes", LogLevel::INFO);
-        } catch (const std::exception& e) {
-            log_message("Error saving torrent file: " + std::string(e.what()), LogLevel::ERR);
-            throw;
         }
 
-    } catch (const UserInterrupt&) {
-        print_error("\n");
-        throw;
-    } catch (const std::runtime_error& e) {
-        print_error(std::string(e.what()) + "\n");
-        log_message("Runtime error: " + std::string(e.what()), LogLevel::ERR);
-        throw;
+        // Written beside the destination and renamed over it, so a failed
+        // write never leaves a truncated .torrent behind
+        std::vector<char> buffer;
+        lt::bencode(std::back_inserter(buffer), e);
+        utils::atomic_write(config.output, buffer);
+
+        log_message("Torrent created successfully: " + config.output.string(), LogLevel::INFO);
+        log_message("Torrent size: " + std::to_string(fs::file_size(config.output)) + " bytes", LogLevel::INFO);
     } catch (const std::exception& e) {
-        print_error(std::string("An unexpected error occurred: ") + e.what() + "\n");
-        log_message("Unexpected error: " + std::string(e.what()), LogLevel::ERR);
+        log_message("Error saving torrent file: " + std::string(e.what()), LogLevel::ERR);
         throw;
     }
 }
 
 // Prints a summary of the created torrent
-void TorrentCreator::print_torrent_summary(int64_t total_size, int piece_size, int num_pieces) const {
+void TorrentCreator::print_torrent_summary(const TorrentConfig& config, int64_t total_size, int piece_size, int num_pieces) const {
     print_info("\n=== TORRENT CREATED SUCCESSFULLY ===\n");
-    print_info("File: " + config_.output.string() + "\n");
+    print_info("File: " + config.output.string() + "\n");
     
     std::string version_str;
-    switch(config_.version) {
+    switch(config.version) {
         case TorrentVersion::V1: version_str = "v1"; break;
         case TorrentVersion::V2: version_str = "v2"; break;
         case TorrentVersion::HYBRID: version_str = "hybrid"; break;
@@ -588,17 +980,17 @@ void TorrentCreator::print_torrent_summary(int64_t total_size, int piece_size, i
     print_info("Version: " + version_str + "\n");
 
     print_info("Total size: " + utils::format_size(total_size) + "\n");
-    if (config_.target_piece_count) {
-        print_info("Target pieces: " + std::to_string(*config_.target_piece_count) + "\n");
+    if (config.target_piece_count) {
+        print_info("Target pieces: " + std::to_string(*config.target_piece_count) + "\n");
     }
     print_info("Pieces: " + std::to_string(num_pieces) + " of " + std::to_string(piece_size / 1024) + "KB\n");
-    print_info("Trackers: " + std::to_string(config_.trackers.size()) + "\n");
-    print_info("Web seeds: " + std::to_string(config_.web_seeds.size()) + "\n");
-    print_info("Private: " + std::string(config_.is_private ? "Yes" : "No") + "\n");
-    if (config_.source) {
-        print_info("Source: " + *config_.source + "\n");
+    print_info("Trackers: " + std::to_string(config.trackers.size()) + "\n");
+    print_info("Web seeds: " + std::to_string(config.web_seeds.size()) + "\n");
+    print_info("Private: " + std::string(config.is_private ? "Yes" : "No") + "\n");
+    if (config.source) {
+        print_info("Source: " + *config.source + "\n");
     }
-    if (config_.entropy) {
+    if (config.entropy) {
         print_info("Entropy: Yes (randomized info hash)\n");
     }
 }
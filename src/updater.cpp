@@ -3,6 +3,7 @@
 #include "logger.hpp"
 #include "output.hpp"
 #include "version.hpp"
+#include "content_reader.hpp"
 #include <nlohmann/json.hpp>
 #include <filesystem>
 #include <cstdlib>
@@ -89,10 +90,14 @@ std::string escape_shell_arg(const std::string &arg)
 
 std::string compute_sha256(const std::string &filepath)
 {
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file)
+    std::unique_ptr<ContentReader> reader;
+    try
     {
-        log_message("SHA-256: failed to open file: " + filepath, LogLevel::WARNING);
+        reader = ContentReader::open(filepath);
+    }
+    catch (const std::exception &e)
+    {
+        log_message("SHA-256: failed to open file: " + filepath + " (" + e.what() + ")", LogLevel::WARNING);
         return "";
     }
 
@@ -110,24 +115,30 @@ std::string compute_sha256(const std::string &filepath)
         return "";
     }
 
-    char buf[8192];
-    while (file.read(buf, sizeof(buf)))
+    std::vector<char> buf(1024 * 1024);
+    for (int64_t offset = 0; offset < reader->size();)
     {
-        if (EVP_DigestUpdate(ctx, buf, static_cast<size_t>(file.gcount())) != 1)
+        int64_t got = 0;
+        const char *data = nullptr;
+        try
+        {
+            data = reader->view(offset, static_cast<int64_t>(buf.size()), buf.data(), got);
+        }
+        catch (const std::exception &e)
         {
             EVP_MD_CTX_free(ctx);
-            log_message("SHA-256: EVP_DigestUpdate failed", LogLevel::WARNING);
+            log_message(std::string("SHA-256: ") + e.what(), LogLevel::WARNING);
             return "";
         }
-    }
-    if (file.gcount() > 0)
-    {
-        if (EVP_DigestUpdate(ctx, buf, static_cast<size_t>(file.gcount())) != 1)
+        if (got == 0)
+            break;
+        if (EVP_DigestUpdate(ctx, data, static_cast<size_t>(got)) != 1)
         {
             EVP_MD_CTX_free(ctx);
-            log_message("SHA-256: EVP_DigestUpdate (tail) failed", LogLevel::WARNING);
+            log_message("SHA-256: EVP_DigestUpdate failed", LogLevel::WARNING);
             return "";
         }
+        offset += got;
     }
 
     unsigned char digest[EVP_MAX_MD_SIZE];
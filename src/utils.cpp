@@ -1,5 +1,6 @@
 #include "utils.hpp"
 #include "constants.hpp"
+#include "content_index.hpp"
 #include "logger.hpp"
 #include <regex>
 #include <cctype>
@@ -89,19 +90,12 @@ int piece_size_for_target_count(int64_t total_size, int target_piece_count)
 
 int64_t compute_content_size(const std::filesystem::path &path)
 {
-    int64_t total_size = 0;
     try {
-        if (std::filesystem::is_directory(path)) {
-            for (const auto& entry : std::filesystem::recursive_directory_iterator(path)) {
-                if (entry.is_regular_file()) total_size += entry.file_size();
-            }
-        } else {
-            total_size = std::filesystem::file_size(path);
-        }
-    } catch (const std::filesystem::filesystem_error& e) {
+        return ContentIndex::scan(path)->total_size();
+    } catch (const std::exception& e) {
         log_message("Could not compute content size for " + path.string() + ": " + e.what(), LogLevel::WARNING);
     }
-    return total_size;
+    return 0;
 }
 
 bool is_valid_url(const std::string &url)
@@ -695,6 +689,16 @@ std::vector<std::regex> apply_builtin_excludes(const std::vector<std::regex>& us
     return combined;
 }
 
+std::vector<std::string> with_builtin_excludes(const std::vector<std::string>& user_globs, bool enabled)
+{
+    if (!enabled)
+        return user_globs;
+
+    std::vector<std::string> combined = builtin_exclude_patterns();
+    combined.insert(combined.end(), user_globs.begin(), user_globs.end());
+    return combined;
+}
+
 std::string generate_entropy_hex()
 {
     constexpr char hex_chars[] = "0123456789abcdef";
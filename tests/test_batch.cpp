@@ -5,6 +5,7 @@
 #include "torrent_inspector.hpp"
 #include <filesystem>
 #include <fstream>
+#include <sstream>
 
 namespace fs = std::filesystem;
 
@@ -229,6 +230,145 @@ jobs:
     EXPECT_THROW(BatchProcessor::parse(temp_dir / "batch.yaml"), std::runtime_error);
 }
 
+TEST_F(BatchTest, ParseHashMemory) {
+    write_file("batch.yaml", R"(
+version: 1
+hash_memory_mb: 64
+jobs:
+  - path: "/tmp/test"
+)");
+
+    auto config = BatchProcessor::parse(temp_dir / "batch.yaml");
+    EXPECT_EQ(config.hash_memory, 64LL * 1024 * 1024);
+}
+
+TEST_F(BatchTest, ParseInvalidHashMemoryThrows) {
+    write_file("batch.yaml", R"(
+version: 1
+hash_memory_mb: 0
+jobs:
+  - path: "/tmp/test"
+)");
+
+    EXPECT_THROW(BatchProcessor::parse(temp_dir / "batch.yaml"), std::runtime_error);
+}
+
+TEST_F(BatchTest, ParseHashCache) {
+    write_file("batch.yaml", R"(
+version: 1
+jobs:
+  - path: "/tmp/test"
+)");
+    EXPECT_TRUE(BatchProcessor::parse(temp_dir / "batch.yaml").hash_cache);
+
+    write_file("batch.yaml", R"(
+version: 1
+hash_cache: false
+jobs:
+  - path: "/tmp/test"
+)");
+    EXPECT_FALSE(BatchProcessor::parse(temp_dir / "batch.yaml").hash_cache);
+}
+
+TEST_F(BatchTest, ParseHashThreads) {
+    write_file("batch.yaml", R"(
+version: 1
+hash_threads: 6
+jobs:
+  - path: "/tmp/test"
+)");
+    EXPECT_EQ(BatchProcessor::parse(temp_dir / "batch.yaml").hash_threads, 6);
+
+    write_file("batch.yaml", R"(
+version: 1
+hash_threads: 0
+jobs:
+  - path: "/tmp/test"
+)");
+    EXPECT_THROW(BatchProcessor::parse(temp_dir / "batch.yaml"), std::runtime_error);
+}
+
+TEST_F(BatchTest, ParseDeviceReaders) {
+    write_file("batch.yaml", R"(
+version: 1
+jobs:
+  - path: "/tmp/test"
+)");
+    auto defaults = BatchProcessor::parse(temp_dir / "batch.yaml");
+    EXPECT_EQ(defaults.hdd_readers, 1);
+    EXPECT_EQ(defaults.ssd_readers, 0);
+
+    write_file("batch.yaml", R"(
+version: 1
+hdd_readers: 2
+ssd_readers: 4
+jobs:
+  - path: "/tmp/test"
+)");
+    auto config = BatchProcessor::parse(temp_dir / "batch.yaml");
+    EXPECT_EQ(config.hdd_readers, 2);
+    EXPECT_EQ(config.ssd_readers, 4);
+
+    write_file("batch.yaml", R"(
+version: 1
+hdd_readers: 0
+jobs:
+  - path: "/tmp/test"
+)");
+    EXPECT_THROW(BatchProcessor::parse(temp_dir / "batch.yaml"), std::runtime_error);
+}
+
+TEST_F(BatchTest, ParseFanOutOutputs) {
+    write_file("batch.yaml", R"(
+version: 1
+jobs:
+  - path: "/tmp/release"
+    preset: base
+    private: true
+    outputs:
+      - ptp
+      - "https://tracker.example/announce"
+      - preset: btn
+        output: btn_copy
+        source: BTN
+)");
+
+    auto config = BatchProcessor::parse(temp_dir / "batch.yaml");
+    ASSERT_EQ(config.jobs.size(), 1u);
+    const auto& outputs = config.jobs[0].outputs;
+    ASSERT_EQ(outputs.size(), 3u);
+    EXPECT_EQ(outputs[0].preset.value(), "ptp");
+    EXPECT_FALSE(outputs[1].preset.has_value());
+    ASSERT_TRUE(outputs[1].values.trackers.has_value());
+    EXPECT_EQ(outputs[1].values.trackers->front(), "https://tracker.example/announce");
+    EXPECT_EQ(outputs[2].preset.value(), "btn");
+    EXPECT_EQ(outputs[2].output.value(), "btn_copy.torrent");
+    EXPECT_EQ(outputs[2].values.source.value(), "BTN");
+    EXPECT_TRUE(config.jobs[0].values.is_private.value_or(false));
+}
+
+TEST_F(BatchTest, ParseFanOutWithJobOutputThrows) {
+    write_file("batch.yaml", R"(
+version: 1
+jobs:
+  - path: "/tmp/release"
+    output: "one.torrent"
+    outputs:
+      - ptp
+)");
+
+    EXPECT_THROW(BatchProcessor::parse(temp_dir / "batch.yaml"), std::runtime_error);
+
+    write_file("batch.yaml", R"(
+version: 1
+jobs:
+  - path: "/tmp/release"
+    outputs: []
+)");
+
+    EXPECT_THROW(BatchProcessor::parse(temp_dir / "batch.yaml"), std::runtime_error);
+}
+
 TEST_F(BatchTest, ParseFileNotFoundThrows) {
     EXPECT_THROW(
         BatchProcessor::parse(temp_dir / "nonexistent.yaml"),
@@ -603,6 +743,259 @@ jobs:
     EXPECT_TRUE(fs::exists(temp_dir / "good2.torrent"));
 }
 
+TEST_F(BatchTest, JournalKeepsLastValidEntryPerJob) {
+    const fs::path path = temp_dir / "batch.yaml.journal";
+    {
+        BatchJournal journal(path, false);
+        journal.append({0, false, "c0", "f0", {}});
+        journal.append({0, true, "c1", "f1", {"/out/a\tb.torrent"}});
+        journal.append({1, true, "c2", "f2", {"/out/x.torrent", "/out/y.torrent"}});
+    }
+    {
+        // A crash in the middle of a write leaves a line without its newline
+        std::ofstream f(path, std::ios::app | std::ios::binary);
+        f << "tbj1\tok\t2\tc3\tf3";
+    }
+
+    BatchJournal journal(path, true);
+    EXPECT_EQ(journal.loaded(), 3u);
+    const BatchJournalEntry* first = journal.find(0);
+    ASSERT_NE(first, nullptr);
+    EXPECT_TRUE(first->success);
+    EXPECT_EQ(first->config_hash, "c1");
+    EXPECT_EQ(first->outputs, std::vector<std::string>{"/out/a\tb.torrent"});
+    ASSERT_NE(journal.find(1), nullptr);
+    EXPECT_EQ(journal.find(1)->outputs.size(), 2u);
+    EXPECT_EQ(journal.find(2), nullptr);
+
+    BatchJournal fresh(path, false);
+    EXPECT_EQ(fresh.loaded(), 0u);
+    EXPECT_EQ(fs::file_size(path), 0u);
+}
+
+TEST_F(BatchTest, RunResumeSkipsFinishedJobs) {
+    fs::path first = temp_dir / "first.bin";
+    fs::path second = temp_dir / "second.bin";
+    for (const auto& path : {first, second}) {
+        std::ofstream f(path, std::ios::binary);
+        std::vector<char> data(4096, 'R');
+        f.write(data.data(), data.size());
+    }
+
+    write_file("batch.yaml", R"(
+version: 1
+jobs:
+  - path: ")" + first.generic_string() + R"("
+    output: ")" + (temp_dir / "first.torrent").generic_string() + R"("
+    no_date: true
+  - path: ")" + second.generic_string() + R"("
+    output: ")" + (temp_dir / "second.torrent").generic_string() + R"("
+    no_date: true
+)");
+
+    auto results = BatchProcessor(BatchProcessor::parse(temp_dir / "batch.yaml")).run();
+    ASSERT_TRUE(results[0].success && results[1].success);
+    EXPECT_TRUE(fs::exists(temp_dir / "batch.yaml.journal"));
+
+    // Change one job's content and lose the other's output
+    {
+        std::ofstream f(first, std::ios::app | std::ios::binary);
+        f << "more";
+    }
+    fs::remove(temp_dir / "second.torrent");
+    write_file("batch.yaml", R"(
+version: 1
+jobs:
+  - path: ")" + first.generic_string() + R"("
+    output: ")" + (temp_dir / "first.torrent").generic_string() + R"("
+    no_date: true
+  - path: ")" + second.generic_string() + R"("
+    output: ")" + (temp_dir / "second.torrent").generic_string() + R"("
+    no_date: true
+  - path: ")" + second.generic_string() + R"("
+    output: ")" + (temp_dir / "third.torrent").generic_string() + R"("
+    no_date: true
+)");
+
+    auto config = BatchProcessor::parse(temp_dir / "batch.yaml");
+    config.resume = true;
+    results = BatchProcessor(std::move(config)).run();
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_FALSE(results[0].resumed);
+    EXPECT_FALSE(results[1].resumed);
+    EXPECT_TRUE(fs::exists(temp_dir / "second.torrent"));
+
+    // Nothing changed since: every job is skipped
+    config = BatchProcessor::parse(temp_dir / "batch.yaml");
+    config.resume = true;
+    const auto written = fs::last_write_time(temp_dir / "third.torrent");
+    results = BatchProcessor(std::move(config)).run();
+    for (const auto& r : results) {
+        EXPECT_TRUE(r.success);
+        EXPECT_TRUE(r.resumed);
+    }
+    EXPECT_EQ(fs::last_write_time(temp_dir / "third.torrent"), written);
+}
+
+TEST_F(BatchTest, RunRecordsPhaseTimesAndBytesRead) {
+    fs::path content = temp_dir / "content.bin";
+    {
+        std::ofstream f(content, std::ios::binary);
+        std::vector<char> data(300000, 'P');
+        f.write(data.data(), data.size());
+    }
+
+    write_file("batch.yaml", R"(
+version: 1
+hash_cache: false
+jobs:
+  - path: ")" + content.generic_string() + R"("
+    output: ")" + (temp_dir / "content.torrent").generic_string() + R"("
+)");
+
+    auto results = BatchProcessor(BatchProcessor::parse(temp_dir / "batch.yaml")).run();
+    ASSERT_EQ(results.size(), 1u);
+    ASSERT_TRUE(results[0].success) << results[0].error_message;
+    EXPECT_EQ(results[0].bytes_read, 300000);
+    EXPECT_GT(results[0].phases.hash, 0.0);
+    EXPECT_GT(results[0].phases.write, 0.0);
+    const auto& p = results[0].phases;
+    EXPECT_LE(p.scan + p.rules + p.season + p.hash + p.write, results[0].elapsed_seconds);
+}
+
+// Job order comes from a size estimate taken before any job scans its
+// content: a large file nested a few directories down must count, so that
+// job runs first even when it is listed last.
+TEST_F(BatchTest, RunStartsNestedLargeJobFirst) {
+    fs::create_directories(temp_dir / "small");
+    write_file("small/readme.txt", std::string(1000, 's'));
+    fs::create_directories(temp_dir / "big" / "season" / "disc");
+    {
+        std::ofstream f(temp_dir / "big" / "season" / "disc" / "data.bin", std::ios::binary);
+        std::vector<char> data(4 * 1024 * 1024, 'B');
+        f.write(data.data(), data.size());
+    }
+
+    write_file("batch.yaml", R"(
+version: 1
+workers: 1
+hash_cache: false
+jobs:
+  - path: ")" + (temp_dir / "small").generic_string() + R"("
+    output: ")" + (temp_dir / "small.torrent").generic_string() + R"("
+  - path: ")" + (temp_dir / "big").generic_string() + R"("
+    output: ")" + (temp_dir / "big.torrent").generic_string() + R"("
+)");
+
+    auto results = BatchProcessor(BatchProcessor::parse(temp_dir / "batch.yaml")).run();
+    ASSERT_EQ(results.size(), 2u);
+    ASSERT_TRUE(results[0].success) << results[0].error_message;
+    ASSERT_TRUE(results[1].success) << results[1].error_message;
+    EXPECT_GT(results[1].predicted_seconds, results[0].predicted_seconds);
+    EXPECT_LT(fs::last_write_time(temp_dir / "big.torrent"), fs::last_write_time(temp_dir / "small.torrent"));
+}
+
+TEST_F(BatchTest, ReportLineIsOneJsonObjectPerJob) {
+    BatchResult ok{0, "out \"a\".torrent", true, "", 2.5};
+    ok.phases = {0.25, 0.01, 0.02, 2.0, 0.1};
+    ok.bytes_read = 4 * 1024 * 1024;
+    ok.content_bytes = ok.bytes_read;
+    ok.outputs = {"/out/a.torrent", "/out/b.torrent"};
+    BatchResult failed{1, "b", false, "Path does not exist: /b", 0.0};
+
+    std::ostringstream out;
+    BatchProcessor::write_report_line(out, ok);
+    BatchProcessor::write_report_line(out, failed);
+
+    std::istringstream lines(out.str());
+    std::string line;
+    ASSERT_TRUE(std::getline(lines, line));
+    EXPECT_EQ(line, "{\"job\": 1, \"name\": \"out \\\"a\\\".torrent\", \"status\": \"ok\", "
+        "\"elapsed_seconds\": 2.500, \"predicted_seconds\": 0.000, \"phases\": {\"scan\": 0.250, "
+        "\"rules\": 0.010, \"season\": 0.020, \"hash\": 2.000, \"write\": 0.100}, \"content_bytes\": 4194304, "
+        "\"bytes_read\": 4194304, \"read_mb_per_second\": 2.000, "
+        "\"outputs\": [\"/out/a.torrent\", \"/out/b.torrent\"]}");
+    ASSERT_TRUE(std::getline(lines, line));
+    EXPECT_NE(line.find("\"status\": \"failed\", \"error\": \"Path does not exist: /b\""), std::string::npos);
+    EXPECT_NE(line.find("\"read_mb_per_second\": 0.000"), std::string::npos);
+    EXPECT_FALSE(std::getline(lines, line));
+}
+
+TEST_F(BatchTest, JobStreamReadsYamlDocuments) {
+    std::istringstream in(R"(version: 1
+workers: 3
+---
+path: /data/a
+output: a
+--- {path: /data/b}
+---
+# comment-only documents are skipped
+---
+- not a job
+---
+path: /data/c
+...
+)");
+    BatchJobStream stream(in, BatchJobStream::Format::YAML);
+    EXPECT_EQ(stream.settings().workers, 3);
+
+    auto a = stream.next();
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a->path, "/data/a");
+    EXPECT_EQ(a->output, "a.torrent");
+    EXPECT_EQ(stream.next()->path, "/data/b");
+    EXPECT_THROW(stream.next(), std::runtime_error);
+    EXPECT_EQ(stream.next()->path, "/data/c");
+    EXPECT_FALSE(stream.next());
+    EXPECT_EQ(stream.jobs_read(), 4);
+}
+
+TEST_F(BatchTest, JobStreamReadsNdjson) {
+    std::istringstream in("{\"path\": \"/data/x\", \"private\": true}\n\n{broken\n{\"path\": \"/data/y\"}\n");
+    BatchJobStream stream(in, BatchJobStream::Format::NDJSON);
+    EXPECT_EQ(stream.settings().workers, 1);
+    auto x = stream.next();
+    ASSERT_TRUE(x);
+    EXPECT_EQ(x->path, "/data/x");
+    EXPECT_TRUE(x->values.is_private.value_or(false));
+    EXPECT_THROW(stream.next(), std::runtime_error);
+    EXPECT_EQ(stream.next()->path, "/data/y");
+    EXPECT_FALSE(stream.next());
+}
+
+TEST_F(BatchTest, RunStreamExecutesJobsAsTheyAreRead) {
+    fs::path test_file = temp_dir / "streamed.bin";
+    {
+        std::ofstream f(test_file, std::ios::binary);
+        std::vector<char> data(2048, 'S');
+        f.write(data.data(), data.size());
+    }
+
+    std::ostringstream ndjson;
+    ndjson << "{\"version\": 1, \"workers\": 2}\n";
+    for (int i = 0; i < 6; ++i) {
+        ndjson << "{\"path\": \"" << test_file.generic_string() << "\", \"output\": \""
+               << (temp_dir / ("streamed" + std::to_string(i))).generic_string() << "\"}\n";
+    }
+    ndjson << "{\"path\": \"/tmp/nonexistent_file_xyz\", \"output\": \"/tmp/bad.torrent\"}\n";
+    write_file("jobs.ndjson", ndjson.str());
+
+    auto stream = BatchJobStream::open((temp_dir / "jobs.ndjson").string());
+    BatchConfig config = stream->settings();
+    EXPECT_EQ(config.workers, 2);
+    BatchProcessor processor(std::move(config));
+    int reported = 0;
+    auto summary = processor.run_stream(*stream, [&](const BatchResult&) { ++reported; });
+
+    EXPECT_EQ(reported, 7);
+    EXPECT_EQ(summary.succeeded, 6);
+    ASSERT_EQ(summary.failures.size(), 1u);
+    EXPECT_EQ(summary.failures[0].job_index, 6);
+    for (int i = 0; i < 6; ++i) {
+        EXPECT_TRUE(fs::exists(temp_dir / ("streamed" + std::to_string(i) + ".torrent")));
+    }
+}
+
 TEST_F(BatchTest, RunAutoOutputPath) {
     fs::path test_file = temp_dir / "auto_output.bin";
     {
@@ -663,6 +1056,81 @@ jobs:
     EXPECT_TRUE(fs::exists(temp_dir / "preset_out.torrent"));
 }
 
+TEST_F(BatchTest, RunFanOutWritesOneTorrentPerOutput) {
+    fs::path content = temp_dir / "release";
+    fs::create_directories(content);
+    {
+        std::ofstream f(content / "video.mkv", std::ios::binary);
+        std::vector<char> data(300 * 1024, 'F');
+        f.write(data.data(), data.size());
+    }
+
+    write_file("presets.yaml", R"(
+version: 1
+presets:
+  alpha:
+    trackers: ["https://alpha.example/announce"]
+    source: "ALPHA"
+  beta:
+    trackers: ["https://beta.example/announce", "https://beta-backup.example/announce"]
+    entropy: true
+)");
+
+    write_file("rules.yaml", R"(
+version: 1
+trackers:
+  beta:
+    domain: "beta.example"
+    source: "BETA"
+)");
+
+    write_file("batch.yaml", R"(
+version: 1
+preset_file: ")" + (temp_dir / "presets.yaml").generic_string() + R"("
+rules_file: ")" + (temp_dir / "rules.yaml").generic_string() + R"("
+jobs:
+  - path: ")" + content.generic_string() + R"("
+    private: true
+    piece_size: 64
+    outputs:
+      - preset: alpha
+        output: ")" + (temp_dir / "alpha.torrent").generic_string() + R"("
+      - preset: beta
+        output: ")" + (temp_dir / "beta.torrent").generic_string() + R"("
+      - preset: alpha
+        private: false
+        torrent_version: 1
+        output: ")" + (temp_dir / "alpha_v1.torrent").generic_string() + R"("
+)");
+
+    auto config = BatchProcessor::parse(temp_dir / "batch.yaml");
+    BatchProcessor processor(std::move(config));
+    auto results = processor.run();
+
+    ASSERT_EQ(results.size(), 1u);
+    ASSERT_TRUE(results[0].success) << results[0].error_message;
+    EXPECT_EQ(results[0].outputs.size(), 3u);
+
+    TorrentMetadata alpha = TorrentInspector((temp_dir / "alpha.torrent").string()).inspect();
+    TorrentMetadata beta = TorrentInspector((temp_dir / "beta.torrent").string()).inspect();
+    TorrentMetadata alpha_v1 = TorrentInspector((temp_dir / "alpha_v1.torrent").string()).inspect();
+
+    EXPECT_EQ(alpha.trackers, std::vector<std::string>{"https://alpha.example/announce"});
+    EXPECT_EQ(beta.tracker_tiers.size(), 2u);
+    EXPECT_EQ(alpha.source.value_or(""), "ALPHA");
+    EXPECT_EQ(beta.source.value_or(""), "BETA");  // From the tracker rule
+    EXPECT_TRUE(alpha.is_private);
+    EXPECT_TRUE(beta.is_private);
+    EXPECT_FALSE(alpha_v1.is_private);
+    EXPECT_TRUE(alpha.is_hybrid);
+    EXPECT_FALSE(alpha_v1.is_hybrid);
+
+    // Same pieces, different info dictionaries
+    EXPECT_EQ(alpha.piece_length, 64 * 1024);
+    EXPECT_EQ(beta.piece_length, 64 * 1024);
+    EXPECT_NE(alpha.info_hash_v1, beta.info_hash_v1);
+}
+
 TEST_F(BatchTest, RunWithUnknownPresetFails) {
     fs::path test_file = temp_dir / "testfile.bin";
     {
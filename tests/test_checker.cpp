@@ -1,5 +1,6 @@
 #include "portable.hpp"
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 #include <string>
@@ -150,6 +151,44 @@ TEST_F(CheckerTest, CheckFailsForCorruptedPiece)
     EXPECT_LT(result.completion_percentage, 100.0);
 }
 
+TEST_F(CheckerTest, CorruptedPiecesAreReportedInIndexOrder)
+{
+    const int piece_size = 16384;
+    std::string a(piece_size * 23 + 100, '\0');
+    std::string b(piece_size * 17, '\0');
+    for (size_t i = 0; i < a.size(); ++i)
+        a[i] = static_cast<char>(i * 7 + 1);
+    for (size_t i = 0; i < b.size(); ++i)
+        b[i] = static_cast<char>(i * 13 + 5);
+    create_multi_file_torrent({{"a.bin", a}, {"b.bin", b}}, piece_size);
+
+    // Flip one byte in pieces 2, 23 (spanning both files) and 40 (the last)
+    auto flip = [&](const std::string &name, int64_t offset) {
+        std::fstream f(content_dir_ / "test_torrent" / name, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekg(offset);
+        char c = static_cast<char>(f.get());
+        f.seekp(offset);
+        f.put(static_cast<char>(c ^ 0x5a));
+    };
+    flip("a.bin", 2 * piece_size + 10);
+    flip("b.bin", 10);
+    flip("b.bin", static_cast<int64_t>(b.size()) - 1);
+
+    TorrentChecker checker(torrent_path_);
+    CheckResult result = checker.check(content_dir_);
+
+    EXPECT_FALSE(result.passed);
+    EXPECT_EQ(result.pieces_total, 41);
+    ASSERT_EQ(result.corrupted_pieces.size(), 3u);
+    const int expected[] = {2, 23, 40};
+    for (size_t k = 0; k < 3; ++k)
+    {
+        EXPECT_EQ(result.corrupted_pieces[k].index, expected[k]);
+        EXPECT_EQ(result.corrupted_pieces[k].offset, static_cast<int64_t>(expected[k]) * piece_size);
+    }
+    EXPECT_EQ(result.pieces_verified, 38);
+}
+
 TEST_F(CheckerTest, CheckDetectsExtraFiles)
 {
     create_single_file_torrent("test_file.txt", "Hello World");
@@ -521,6 +560,54 @@ TEST_F(V2CheckerTest, V2MultiFileCheckPasses)
     EXPECT_EQ(result.corrupted_pieces.size(), 0u);
 }
 
+TEST_F(V2CheckerTest, V2VerifiesEachFileAgainstItsHashTree)
+{
+    const int piece_size = 65536;
+    std::string big(piece_size * 4 + 30000, '\0');
+    std::string small(20000, '\0');
+    for (size_t i = 0; i < big.size(); ++i)
+        big[i] = static_cast<char>(i * 11 + 3);
+    for (size_t i = 0; i < small.size(); ++i)
+        small[i] = static_cast<char>(i * 5 + 9);
+    create_v2_multi_file_torrent({{"big.bin", big}, {"small.bin", small}}, piece_size);
+
+    TorrentChecker clean(torrent_path_);
+    EXPECT_TRUE(clean.check(content_dir_.parent_path()).passed);
+
+    // A byte in the second 16 KiB leaf of big.bin's third piece, and one in small.bin's second leaf
+    auto flip = [&](const std::string &name, int64_t offset) {
+        std::fstream f(content_dir_ / name, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekg(offset);
+        char c = static_cast<char>(f.get());
+        f.seekp(offset);
+        f.put(static_cast<char>(c ^ 0x21));
+    };
+    flip("big.bin", 2 * piece_size + 20000);
+    flip("small.bin", 17000);
+
+    lt::torrent_info info(torrent_path_.string());
+    std::vector<int> expected;
+    for (auto const f : info.files().file_range())
+    {
+        const std::string name = fs::path(info.files().file_path(f)).filename().string();
+        const int first = static_cast<int>(info.files().file_offset(f) / piece_size);
+        if (name == "big.bin")
+            expected.push_back(first + 2);
+        else if (name == "small.bin")
+            expected.push_back(first);
+    }
+    std::sort(expected.begin(), expected.end());
+
+    TorrentChecker checker(torrent_path_);
+    CheckResult result = checker.check(content_dir_.parent_path());
+
+    EXPECT_FALSE(result.passed);
+    ASSERT_EQ(result.corrupted_pieces.size(), 2u);
+    EXPECT_EQ(result.corrupted_pieces[0].index, expected[0]);
+    EXPECT_EQ(result.corrupted_pieces[1].index, expected[1]);
+    EXPECT_EQ(result.pieces_verified, result.pieces_total - 2);
+}
+
 TEST_F(V2CheckerTest, V2DetectsExtraFiles)
 {
     create_v2_single_file_torrent("test_file.txt", "Hello World v2");
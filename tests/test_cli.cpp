@@ -3764,6 +3764,60 @@ TEST(CLI, QuietSuppressesUpdateCheck)
 }
 #endif
 
+// ─── --hash-memory integration tests ───
+
+TEST(CLI, HashMemoryBelowOnePieceStillCreatesTorrent) {
+    namespace fs = std::filesystem;
+    auto temp_dir = fs::temp_directory_path() / "torrent_builder_hash_memory_test";
+    std::error_code ec;
+    fs::remove_all(temp_dir, ec);
+    fs::create_directories(temp_dir);
+    auto input_file = temp_dir / "input.bin";
+    auto output_file = temp_dir / "output.torrent";
+    {
+        std::ofstream f(input_file, std::ios::binary);
+        std::vector<char> data(1024 * 1024);
+        for (size_t i = 0; i < data.size(); ++i) data[i] = static_cast<char>(i * 31);
+        for (int i = 0; i < 6; ++i) f.write(data.data(), data.size());
+    }
+
+    // 1 MB budget with 4 MB pieces: the pipeline still keeps two pieces in flight
+    int exit_code;
+    std::string cmd = get_binary_path() + " --no-update-check --path " + input_file.string()
+        + " --output " + output_file.string()
+        + " --torrent-version 3 --piece-size 4096 --hash-memory 1 2>&1";
+    std::string output = exec_command(cmd, exit_code);
+
+    EXPECT_EQ(exit_code, 0) << "Output: " << output;
+    TorrentInspector inspector(output_file.string());
+    EXPECT_EQ(inspector.inspect().piece_count, 2);
+
+    fs::remove_all(temp_dir, ec);
+}
+
+TEST(CLI, HashMemoryMustBePositive) {
+    namespace fs = std::filesystem;
+    auto temp_dir = fs::temp_directory_path() / "torrent_builder_hash_memory_invalid_test";
+    std::error_code ec;
+    fs::remove_all(temp_dir, ec);
+    fs::create_directories(temp_dir);
+    auto input_file = temp_dir / "input.bin";
+    {
+        std::ofstream f(input_file, std::ios::binary);
+        f << "data";
+    }
+
+    int exit_code;
+    std::string cmd = get_binary_path() + " --no-update-check --path " + input_file.string()
+        + " --output " + (temp_dir / "output.torrent").string() + " --hash-memory 0 2>&1";
+    std::string output = exec_command(cmd, exit_code);
+
+    EXPECT_NE(exit_code, 0);
+    EXPECT_NE(output.find("--hash-memory"), std::string::npos);
+
+    fs::remove_all(temp_dir, ec);
+}
+
 // ─── --target-piece-count integration tests ───
 
 TEST(CLI, TargetPieceCountCreatesTorrent) {
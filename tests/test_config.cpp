@@ -2,6 +2,9 @@
 #include "torrent_creator.hpp"
 #include <fstream>
 #include <filesystem>
+#include <iterator>
+#include <string>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -80,3 +83,42 @@ TEST(GetTorrentFlags, Hybrid) {
     EXPECT_FALSE(flags & lt::create_torrent::v1_only);
     EXPECT_FALSE(flags & lt::create_torrent::v2_only);
 }
+
+// Several piece sizes hashed from one read must give the same torrents as
+// creating each size on its own; non-v1 sizes fall back to separate passes.
+TEST_F(TorrentConfigTest, CreateTorrentsSharesReadAcrossPieceSizes) {
+    fs::path content = temp_dir_ / "content";
+    fs::create_directories(content / "sub");
+    for (auto [name, size] : {std::pair{"a.bin", 70000}, {"sub/b.bin", 5000}, {"sub/c.bin", 200000}}) {
+        std::ofstream f(content / name, std::ios::binary);
+        for (int i = 0; i < size; ++i) f.put(static_cast<char>(i * 31 + size));
+    }
+
+    auto read_all = [](const fs::path& path) {
+        std::ifstream f(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(f), {});
+    };
+    auto make = [&](TorrentVersion version, int piece_kb, const std::string& out) {
+        TorrentConfig config(content, temp_dir_ / out, {"https://tracker.example/announce"}, version);
+        config.piece_size = piece_kb * 1024;
+        config.include_creation_date = false;
+        config.silent = true;
+        return config;
+    };
+
+    for (TorrentVersion version : {TorrentVersion::V1, TorrentVersion::HYBRID}) {
+        std::vector<TorrentConfig> configs;
+        for (int kb : {64, 16, 256}) {
+            TorrentCreator(make(version, kb, "single_" + std::to_string(kb) + ".torrent")).create_torrent();
+            configs.push_back(make(version, kb, "shared_" + std::to_string(kb) + ".torrent"));
+        }
+        TorrentCreator::create_torrents(std::move(configs));
+
+        for (int kb : {64, 16, 256}) {
+            const std::string single = read_all(temp_dir_ / ("single_" + std::to_string(kb) + ".torrent"));
+            ASSERT_FALSE(single.empty());
+            EXPECT_EQ(read_all(temp_dir_ / ("shared_" + std::to_string(kb) + ".torrent")), single)
+                << kb << " KB pieces";
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#include "portable.hpp"
+#include <gtest/gtest.h>
+#include "config_cache.hpp"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+class ConfigCacheTest : public ::testing::Test {
+protected:
+    fs::path temp_dir;
+    PresetLoader presets;
+    TrackerRulesDatabase rules;
+
+    void SetUp() override {
+        temp_dir = fs::temp_directory_path() / ("config_cache_test_" + std::to_string(portable_getpid()));
+        fs::create_directories(temp_dir);
+
+        write_file("presets.yaml", R"(
+version: 1
+presets:
+  base:
+    private: true
+    trackers: ["https://alpha.example/announce"]
+  child:
+    private: true
+    source: "CHILD"
+)");
+        write_file("rules.yaml", R"(
+version: 1
+trackers:
+  alpha:
+    domain: "alpha.example"
+    source: "ALPHA"
+)");
+        presets.load(temp_dir / "presets.yaml");
+        rules.load(temp_dir / "rules.yaml");
+    }
+
+    void TearDown() override {
+        fs::remove_all(temp_dir);
+    }
+
+    void write_file(const std::string& name, const std::string& content) {
+        std::ofstream f(temp_dir / name);
+        f << content;
+    }
+};
+
+TEST_F(ConfigCacheTest, ResolvesEachPresetOnce) {
+    ResolvedConfigCache cache(presets, rules);
+    auto first = cache.preset("child");
+    auto second = cache.preset("child");
+    EXPECT_EQ(first.get(), second.get());
+    EXPECT_EQ(first->source, "CHILD");
+    EXPECT_TRUE(first->is_private.value_or(false));
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.hits(), 1);
+
+    EXPECT_THROW(cache.preset("missing"), std::runtime_error);
+    EXPECT_THROW(cache.preset("missing"), std::runtime_error);
+}
+
+TEST_F(ConfigCacheTest, SharesFiltersPerPatternSet) {
+    ResolvedConfigCache cache(presets, rules);
+    PathFilter a = cache.filter({"*.nfo"}, {}, false);
+    PathFilter b = cache.filter({"*.nfo"}, {}, false);
+    PathFilter builtin = cache.filter({"*.nfo"}, {}, true);
+    PathFilter include = cache.filter({"*.nfo"}, {"keep.nfo"}, false);
+
+    EXPECT_EQ(a, b);
+    EXPECT_FALSE(a == builtin);
+    EXPECT_FALSE(a == include);
+    EXPECT_FALSE(a.should_include_file("x.nfo"));
+    EXPECT_TRUE(include.should_include_file("keep.nfo"));
+    EXPECT_EQ(cache.misses(), 3);
+    EXPECT_EQ(cache.hits(), 1);
+}
+
+TEST_F(ConfigCacheTest, MemoizesRuleMatchesPerTrackerList) {
+    ResolvedConfigCache cache(presets, rules);
+    auto matched = cache.rule({"https://tracker.alpha.example/announce"});
+    ASSERT_TRUE(*matched);
+    EXPECT_EQ((*matched)->source, "ALPHA");
+    EXPECT_EQ(cache.rule({"https://tracker.alpha.example/announce"}).get(), matched.get());
+    EXPECT_FALSE(*cache.rule({"https://other.example/announce"}));
+}
+
+TEST_F(ConfigCacheTest, ConcurrentLookupsAgree) {
+    ResolvedConfigCache cache(presets, rules);
+    std::vector<std::thread> workers;
+    std::vector<std::shared_ptr<const ConfigValues>> seen(8);
+    for (int i = 0; i < 8; ++i) {
+        workers.emplace_back([&, i] {
+            for (int n = 0; n < 100; ++n) {
+                seen[i] = cache.preset("child");
+                cache.rule({"https://alpha.example/announce"});
+            }
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    for (const auto& values : seen) {
+        EXPECT_EQ(values, cache.preset("child"));
+    }
+    EXPECT_EQ(cache.hits() + cache.misses(), 8 * 200 + 8);
+}
@@ -0,0 +1,210 @@
+#include "portable.hpp"
+#include <gtest/gtest.h>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "content_index.hpp"
+#include "season_pack.hpp"
+
+namespace fs = std::filesystem;
+
+class ContentIndexTest : public ::testing::Test
+{
+  protected:
+    fs::path temp_dir_;
+
+    void SetUp() override
+    {
+        temp_dir_ = fs::temp_directory_path() / ("torrent_content_index_test_" + std::to_string(portable_getpid()));
+        fs::remove_all(temp_dir_);
+        fs::create_directories(temp_dir_);
+    }
+
+    void TearDown() override
+    {
+        std::error_code ec;
+        fs::remove_all(temp_dir_, ec);
+    }
+
+    void write_file(const fs::path &rel, size_t size)
+    {
+        fs::create_directories((temp_dir_ / rel).parent_path());
+        std::ofstream f(temp_dir_ / rel, std::ios::binary);
+        f << std::string(size, 'x');
+    }
+
+    static std::vector<std::string> paths(const ContentIndex &index)
+    {
+        std::vector<std::string> out;
+        for (const auto &e : index.files())
+        {
+            out.push_back(e.path);
+        }
+        return out;
+    }
+};
+
+TEST_F(ContentIndexTest, ListsFilesInPathOrderWithMetadata)
+{
+    write_file("b.bin", 3);
+    write_file("a/z.bin", 5);
+    write_file("a/b/c.bin", 7);
+    write_file("a.txt", 11);
+
+    auto index = ContentIndex::scan(temp_dir_);
+
+    EXPECT_TRUE(index->is_directory());
+    EXPECT_EQ(paths(*index), (std::vector<std::string>{"a/b/c.bin", "a/z.bin", "a.txt", "b.bin"}));
+    EXPECT_EQ(index->total_size(), 26);
+    for (const auto &e : index->files())
+    {
+        EXPECT_TRUE(fs::exists(index->full_path(e)));
+        EXPECT_EQ(static_cast<int64_t>(fs::file_size(index->full_path(e))), e.size);
+        EXPECT_GT(e.mtime_ns, 0);
+    }
+}
+
+TEST_F(ContentIndexTest, SingleFileRoot)
+{
+    write_file("only.bin", 42);
+
+    auto index = ContentIndex::scan(temp_dir_ / "only.bin");
+
+    EXPECT_FALSE(index->is_directory());
+    ASSERT_EQ(index->files().size(), 1u);
+    EXPECT_EQ(index->total_size(), 42);
+    EXPECT_EQ(index->full_path(index->files()[0]), temp_dir_ / "only.bin");
+}
+
+TEST_F(ContentIndexTest, AppliesExcludePatternsAndPrunesDirectories)
+{
+    write_file("keep.mkv", 10);
+    write_file("skip.nfo", 20);
+    write_file("Sample/clip.mkv", 30);
+
+    auto index = ContentIndex::scan(temp_dir_, PathFilter({"*.nfo", "**/Sample/"}, {}));
+
+    EXPECT_EQ(paths(*index), (std::vector<std::string>{"keep.mkv"}));
+    EXPECT_EQ(index->total_size(), 10);
+    EXPECT_EQ(index->files_excluded(), 1);
+    EXPECT_EQ(index->dirs_excluded(), 1);
+}
+
+TEST_F(ContentIndexTest, IncludePatternsOverrideExcludes)
+{
+    write_file("a.mkv", 1);
+    write_file("sub/b.mkv", 2);
+    write_file("sub/c.txt", 4);
+
+    auto index = ContentIndex::scan(temp_dir_, PathFilter({"sub/"}, {"**/*.mkv"}));
+
+    EXPECT_EQ(paths(*index), (std::vector<std::string>{"a.mkv", "sub/b.mkv"}));
+    EXPECT_EQ(index->dirs_excluded(), 0);
+}
+
+#ifndef _WIN32
+TEST_F(ContentIndexTest, FollowsSymlinksWithoutLooping)
+{
+    write_file("real/data.bin", 8);
+    fs::create_directory_symlink(temp_dir_ / "real", temp_dir_ / "link");
+    fs::create_directory_symlink(temp_dir_, temp_dir_ / "real" / "loop");
+
+    auto index = ContentIndex::scan(temp_dir_);
+
+    EXPECT_EQ(paths(*index), (std::vector<std::string>{"link/data.bin", "real/data.bin"}));
+    EXPECT_EQ(index->total_size(), 16);
+}
+
+TEST_F(ContentIndexTest, SkipsSymlinksWhenNotFollowing)
+{
+    write_file("real/data.bin", 8);
+    fs::create_directory_symlink(temp_dir_ / "real", temp_dir_ / "dir_link");
+    fs::create_symlink(temp_dir_ / "real" / "data.bin", temp_dir_ / "file_link");
+
+    auto followed = ContentIndex::scan(temp_dir_);
+    EXPECT_EQ(paths(*followed), (std::vector<std::string>{"dir_link/data.bin", "file_link", "real/data.bin"}));
+    EXPECT_TRUE(followed->files()[1].symlink);
+
+    auto index = ContentIndex::scan(temp_dir_, {}, ScanOptions{.follow_symlinks = false});
+    EXPECT_EQ(paths(*index), (std::vector<std::string>{"real/data.bin"}));
+}
+#endif
+
+TEST_F(ContentIndexTest, OrderIsIndependentOfThreadCount)
+{
+    for (int d = 0; d < 12; ++d)
+    {
+        for (int f = 0; f < 15; ++f)
+        {
+            write_file("d" + std::to_string(d) + "/s" + std::to_string(f % 3) + "/f" + std::to_string(f) + ".bin",
+                       static_cast<size_t>(d + f));
+        }
+    }
+
+    auto serial = ContentIndex::scan(temp_dir_, {}, ScanOptions{.threads = 1});
+    auto parallel = ContentIndex::scan(temp_dir_, {}, ScanOptions{.threads = 8});
+
+    ASSERT_EQ(serial->files().size(), 180u);
+    EXPECT_EQ(paths(*serial), paths(*parallel));
+    EXPECT_EQ(serial->total_size(), parallel->total_size());
+}
+
+// Walkers are added as directories queue up: a deep chain keeps one walker
+// busy, a wide level spreads over several, and both must list everything.
+TEST_F(ContentIndexTest, WalksDeepAndWideTreesAsWalkersGrow)
+{
+    std::string deep = "deep";
+    for (int level = 0; level < 30; ++level)
+    {
+        deep += "/l" + std::to_string(level);
+        write_file(deep + "/f.bin", static_cast<size_t>(level));
+    }
+    for (int d = 0; d < 64; ++d)
+    {
+        write_file("wide/d" + std::to_string(d) + "/f.bin", 1);
+    }
+
+    auto serial = ContentIndex::scan(temp_dir_, {}, ScanOptions{.threads = 1});
+    auto parallel = ContentIndex::scan(temp_dir_, {}, ScanOptions{.threads = 16});
+
+    ASSERT_EQ(serial->files().size(), 94u);
+    EXPECT_EQ(paths(*serial), paths(*parallel));
+}
+
+TEST_F(ContentIndexTest, MaxFilesCutsTheWalkShort)
+{
+    for (int d = 0; d < 20; ++d)
+    {
+        write_file("d" + std::to_string(d) + "/f.bin", 10);
+    }
+
+    auto full = ContentIndex::scan(temp_dir_);
+    EXPECT_FALSE(full->truncated());
+    EXPECT_EQ(full->files().size(), 20u);
+
+    auto partial = ContentIndex::scan(temp_dir_, {}, ScanOptions{.threads = 1, .max_files = 5});
+    EXPECT_TRUE(partial->truncated());
+    EXPECT_GE(partial->files().size(), 5u);
+    EXPECT_LT(partial->files().size(), 20u);
+}
+
+TEST_F(ContentIndexTest, MissingRootThrows)
+{
+    EXPECT_THROW(ContentIndex::scan(temp_dir_ / "missing"), std::runtime_error);
+}
+
+TEST_F(ContentIndexTest, SeasonAnalysisSeesOnlyIndexedFiles)
+{
+    auto season_dir = temp_dir_ / "Show.S01";
+    write_file("Show.S01/Show.S01E01.mkv", 1);
+    write_file("Show.S01/Show.S01E02.mkv", 1);
+    write_file("Show.S01/Extras/Show.S01E04.mkv", 1);
+
+    SeasonPackInfo all = season_pack::analyze(*ContentIndex::scan(season_dir));
+    EXPECT_EQ(all.missing_episodes, (std::vector<int>{3}));
+
+    SeasonPackInfo filtered = season_pack::analyze(*ContentIndex::scan(season_dir, PathFilter({"Extras/"}, {})));
+    EXPECT_TRUE(filtered.is_season_pack);
+    EXPECT_TRUE(filtered.missing_episodes.empty());
+}
@@ -0,0 +1,130 @@
+#include "portable.hpp"
+#include <gtest/gtest.h>
+#include <cstdlib>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "content_reader.hpp"
+
+namespace fs = std::filesystem;
+
+class ContentReaderTest : public ::testing::TestWithParam<ReadBackend>
+{
+  protected:
+    fs::path temp_dir_;
+    std::string content_;
+
+    void SetUp() override
+    {
+        temp_dir_ = fs::temp_directory_path() / ("torrent_content_reader_test_" + std::to_string(portable_getpid()));
+        fs::create_directories(temp_dir_);
+
+        content_.resize(3 * 1024 * 1024 + 17);
+        for (size_t i = 0; i < content_.size(); ++i)
+        {
+            content_[i] = static_cast<char>((i * 31 + 7) & 0xff);
+        }
+        std::ofstream f(temp_dir_ / "data.bin", std::ios::binary);
+        f.write(content_.data(), static_cast<std::streamsize>(content_.size()));
+    }
+
+    void TearDown() override
+    {
+        std::error_code ec;
+        fs::remove_all(temp_dir_, ec);
+    }
+};
+
+TEST_P(ContentReaderTest, ReportsSize)
+{
+    auto reader = ContentReader::open(temp_dir_ / "data.bin", GetParam());
+    EXPECT_EQ(reader->size(), static_cast<int64_t>(content_.size()));
+    EXPECT_NE(reader->backend(), ReadBackend::AUTO);
+}
+
+TEST_P(ContentReaderTest, ReadsAtArbitraryOffsets)
+{
+    auto reader = ContentReader::open(temp_dir_ / "data.bin", GetParam(), AccessPattern::RANDOM);
+    std::vector<char> buf(100000);
+
+    for (int64_t offset : {int64_t{2000000}, int64_t{0}, int64_t{1234567}})
+    {
+        ASSERT_EQ(reader->read(offset, buf.data(), 100000), 100000);
+        EXPECT_EQ(std::string(buf.data(), 100000), content_.substr(offset, 100000));
+    }
+}
+
+TEST_P(ContentReaderTest, ReadIsShortAtEndOfFile)
+{
+    auto reader = ContentReader::open(temp_dir_ / "data.bin", GetParam());
+    std::vector<char> buf(1000);
+    int64_t offset = static_cast<int64_t>(content_.size()) - 10;
+
+    EXPECT_EQ(reader->read(offset, buf.data(), 1000), 10);
+    EXPECT_EQ(std::string(buf.data(), 10), content_.substr(offset));
+    EXPECT_EQ(reader->read(static_cast<int64_t>(content_.size()), buf.data(), 1000), 0);
+}
+
+TEST_P(ContentReaderTest, ViewMatchesContent)
+{
+    auto reader = ContentReader::open(temp_dir_ / "data.bin", GetParam());
+    std::vector<char> scratch(65536);
+    int64_t got = 0;
+
+    const char *data = reader->view(500000, 65536, scratch.data(), got);
+    ASSERT_EQ(got, 65536);
+    EXPECT_EQ(std::string(data, 65536), content_.substr(500000, 65536));
+
+    if (reader->backend() == ReadBackend::MMAP)
+    {
+        EXPECT_NE(data, scratch.data());
+    }
+}
+
+TEST_P(ContentReaderTest, PrefetchLeavesReadsUnchanged)
+{
+    auto reader = ContentReader::open(temp_dir_ / "data.bin", GetParam());
+    const int64_t size = static_cast<int64_t>(content_.size());
+    reader->prefetch(12345, 1 << 20);
+    reader->prefetch(size - 100, 1000);
+    reader->prefetch(size + 4096, 4096);
+
+    std::vector<char> buf(1 << 20);
+    ASSERT_EQ(reader->read(12345, buf.data(), 1 << 20), 1 << 20);
+    EXPECT_EQ(std::string(buf.data(), 1 << 20), content_.substr(12345, 1 << 20));
+}
+
+TEST_P(ContentReaderTest, EmptyFile)
+{
+    std::ofstream(temp_dir_ / "empty.bin").close();
+    auto reader = ContentReader::open(temp_dir_ / "empty.bin", GetParam());
+    char c = 0;
+    EXPECT_EQ(reader->size(), 0);
+    EXPECT_EQ(reader->read(0, &c, 1), 0);
+}
+
+TEST_P(ContentReaderTest, MissingFileThrows)
+{
+    EXPECT_THROW(ContentReader::open(temp_dir_ / "missing.bin", GetParam()), std::runtime_error);
+}
+
+// Mapping is opt-in: a file truncated under a mapping raises SIGBUS, so
+// AUTO must never pick it on its own.
+TEST_F(ContentReaderTest, AutoReadsWithPread)
+{
+    if (std::getenv("TB_IO_BACKEND")) GTEST_SKIP() << "TB_IO_BACKEND overrides AUTO";
+    auto reader = ContentReader::open(temp_dir_ / "data.bin", ReadBackend::AUTO);
+    EXPECT_EQ(reader->backend(), ReadBackend::PREAD);
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, ContentReaderTest,
+                         ::testing::Values(ReadBackend::AUTO, ReadBackend::PREAD, ReadBackend::MMAP));
+
+TEST(ContentReaderBackend, ParsesNames)
+{
+    EXPECT_EQ(ContentReader::parse_backend("pread"), ReadBackend::PREAD);
+    EXPECT_EQ(ContentReader::parse_backend("MMAP"), ReadBackend::MMAP);
+    EXPECT_EQ(ContentReader::parse_backend("auto"), ReadBackend::AUTO);
+    EXPECT_EQ(ContentReader::parse_backend("bogus"), ReadBackend::AUTO);
+}
@@ -0,0 +1,246 @@
+#include "portable.hpp"
+#include <gtest/gtest.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include <libtorrent/file_storage.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/entry.hpp>
+#include "constants.hpp"
+#include "content_index.hpp"
+#include "torrent_creator.hpp"
+
+namespace fs = std::filesystem;
+
+class TorrentCreatorTest : public ::testing::Test
+{
+  protected:
+    fs::path temp_dir_;
+    fs::path content_dir_;
+
+    void SetUp() override
+    {
+        temp_dir_ = fs::temp_directory_path() / ("torrent_creator_test_" + std::to_string(portable_getpid()));
+        content_dir_ = temp_dir_ / "content";
+        fs::create_directories(content_dir_);
+    }
+
+    void TearDown() override
+    {
+        std::error_code ec;
+        fs::remove_all(temp_dir_, ec);
+    }
+
+    void create_file(const std::string &name, int64_t size, uint32_t seed = 0x12345678)
+    {
+        const fs::path path = content_dir_ / name;
+        fs::create_directories(path.parent_path());
+        std::string content(static_cast<size_t>(size), '\0');
+        uint32_t state = seed;
+        for (auto &ch : content)
+        {
+            state = state * 1664525u + 1013904223u;
+            ch = static_cast<char>(state >> 24);
+        }
+        std::ofstream f(path, std::ios::binary);
+        f.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    // Files spanning piece boundaries, smaller than a piece and exactly one
+    // piece long, so v2 and hybrid layouts need pad files between them.
+    void create_tree()
+    {
+        create_file("a.bin", 70000, 1);
+        create_file("sub/b.bin", 5000, 2);
+        create_file("sub/c.bin", 200000, 3);
+        create_file("sub/d/e.bin", 65536, 4);
+        create_file("z.bin", 1, 5);
+    }
+
+    static std::string read_all(const fs::path &path)
+    {
+        std::ifstream f(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(f), {});
+    }
+
+    TorrentConfig make_config(TorrentVersion version, int piece_size, const std::string &out,
+                              const fs::path &content = {})
+    {
+        TorrentConfig config(content.empty() ? content_dir_ : content, temp_dir_ / out, {}, version, std::nullopt,
+                             false, {}, piece_size, std::nullopt);
+        config.include_creation_date = false;
+        config.silent = true;
+        return config;
+    }
+
+    std::string create(TorrentVersion version, int piece_size, const fs::path &content = {})
+    {
+        TorrentCreator(make_config(version, piece_size, "out.torrent", content)).create_torrent();
+        return read_all(temp_dir_ / "out.torrent");
+    }
+
+    // The same torrent hashed by lt::set_piece_hashes, over the storage
+    // TorrentCreator builds from the content index (the content directory
+    // unless @p content names something else).
+    std::string libtorrent_torrent(TorrentVersion version, int piece_size, const fs::path &content = {})
+    {
+        const fs::path root = content.empty() ? content_dir_ : content;
+        auto index = ContentIndex::scan(root);
+        lt::file_storage file_storage;
+        if (!index->is_directory())
+        {
+            file_storage.add_file(root.filename().string(), index->total_size());
+        }
+        else
+        {
+            for (const auto &entry : index->files())
+            {
+                lt::file_flags_t flags = {};
+                if (entry.executable) flags |= lt::file_storage::flag_executable;
+                file_storage.add_file(root.filename().string() + "/" + entry.path, entry.size, flags,
+                                      static_cast<std::time_t>(entry.mtime_ns / 1000000000));
+            }
+        }
+
+        lt::create_torrent ct(file_storage, piece_size, TorrentCreator::get_torrent_flags(version));
+        lt::set_piece_hashes(ct, root.parent_path().string());
+        ct.set_creation_date(0);
+        std::string buffer;
+        lt::bencode(std::back_inserter(buffer), ct.generate());
+        return buffer;
+    }
+
+    static int pad_files(const std::string &torrent)
+    {
+        lt::torrent_info ti(lt::span<char const>(torrent.data(), static_cast<std::ptrdiff_t>(torrent.size())),
+                            lt::from_span);
+        int pads = 0;
+        for (lt::file_index_t f : ti.files().file_range())
+        {
+            if (ti.files().pad_file_at(f)) ++pads;
+        }
+        return pads;
+    }
+};
+
+// The parallel storage hasher must produce exactly what libtorrent's serial
+// set_piece_hashes produces, pad files included.
+TEST_F(TorrentCreatorTest, MultiFileMatchesLibtorrentByteForByte)
+{
+    create_tree();
+
+    for (TorrentVersion version : {TorrentVersion::V1, TorrentVersion::V2, TorrentVersion::HYBRID})
+    {
+        for (int piece_size : {16 * 1024, 64 * 1024})
+        {
+            const std::string expected = libtorrent_torrent(version, piece_size);
+            ASSERT_FALSE(expected.empty());
+            if (version != TorrentVersion::V1)
+            {
+                EXPECT_GT(pad_files(expected), 0) << "piece size " << piece_size;
+            }
+            EXPECT_EQ(create(version, piece_size), expected)
+                << "version " << static_cast<int>(version) << ", piece size " << piece_size;
+        }
+    }
+}
+
+// Single files go through the same pipeline: every allowed piece size, on a
+// file that is a multiple of none of them and spans two of the largest.
+TEST_F(TorrentCreatorTest, SingleFileMatchesLibtorrentForAllPieceSizes)
+{
+    create_file("content.bin", 40LL * 1024 * 1024 + 12345);
+    const fs::path content = content_dir_ / "content.bin";
+
+    for (int piece_kb : AllowedPieceSizes::values)
+    {
+        const int piece_size = piece_kb * 1024;
+        EXPECT_EQ(create(TorrentVersion::V1, piece_size, content),
+                  libtorrent_torrent(TorrentVersion::V1, piece_size, content))
+            << "piece size " << piece_size;
+    }
+}
+
+// v2 trees of single files, from one block to several pieces, as libtorrent builds them.
+TEST_F(TorrentCreatorTest, SingleFileV2MatchesLibtorrent)
+{
+    struct Case { int64_t size; int piece_size; };
+    const std::vector<Case> cases = {
+        {1, 16384},
+        {16384, 16384},
+        {100000, 16384},
+        {100000, 65536},
+        {1048576, 262144},
+        {3 * 1048576 + 12345, 1048576},
+        {5000000, 4194304},
+    };
+
+    for (const auto &c : cases)
+    {
+        const std::string name = "file_" + std::to_string(c.size) + "_" + std::to_string(c.piece_size) + ".bin";
+        create_file(name, c.size);
+        for (TorrentVersion version : {TorrentVersion::V2, TorrentVersion::HYBRID})
+        {
+            EXPECT_EQ(create(version, c.piece_size, content_dir_ / name),
+                      libtorrent_torrent(version, c.piece_size, content_dir_ / name))
+                << name << ", version " << static_cast<int>(version);
+        }
+    }
+}
+
+// Hybrid pieces are read once and hashed by concurrent v1 and v2 tasks that
+// share each buffer. Whatever the buffer budget, and however the two
+// families interleave, the result must equal serial hashing.
+TEST_F(TorrentCreatorTest, HybridFamiliesMatchSerialHashing)
+{
+    create_tree();
+    create_file("sub/big.bin", 3 * 1024 * 1024 + 777, 6);
+    const int piece_size = 16 * 1024;
+    const std::string expected = libtorrent_torrent(TorrentVersion::HYBRID, piece_size);
+
+    // Two buffers (both families race to release each one), a handful, and the default
+    for (int64_t budget : {int64_t{2} * piece_size, int64_t{8} * piece_size, int64_t{0}})
+    {
+        for (int run = 0; run < 3; ++run)
+        {
+            TorrentConfig config = make_config(TorrentVersion::HYBRID, piece_size, "hybrid.torrent");
+            config.hash_memory = budget;
+            TorrentCreator(std::move(config)).create_torrent();
+            EXPECT_EQ(read_all(temp_dir_ / "hybrid.torrent"), expected) << "budget " << budget << ", run " << run;
+        }
+    }
+}
+
+// Digests are committed to the torrent once every piece is hashed, and only
+// then is the output written: a failed pass must leave no torrent and no
+// partial file behind, and must not touch an earlier output.
+TEST_F(TorrentCreatorTest, FailedHashingWritesNothing)
+{
+    create_tree();
+    const int piece_size = 16 * 1024;
+    const std::string expected = libtorrent_torrent(TorrentVersion::HYBRID, piece_size);
+    ASSERT_EQ(create(TorrentVersion::HYBRID, piece_size), expected);
+
+    // Shrunk after the scan: its pieces can no longer be read
+    auto index = ContentIndex::scan(content_dir_);
+    fs::resize_file(content_dir_ / "sub" / "c.bin", 1000);
+
+    for (const std::string out : {"out.torrent", "new.torrent"})
+    {
+        TorrentConfig config = make_config(TorrentVersion::HYBRID, piece_size, out);
+        config.content_index = index;
+        EXPECT_THROW(TorrentCreator(std::move(config)).create_torrent(), std::runtime_error) << out;
+    }
+
+    EXPECT_EQ(read_all(temp_dir_ / "out.torrent"), expected);
+    EXPECT_FALSE(fs::exists(temp_dir_ / "new.torrent"));
+    for (const auto &entry : fs::directory_iterator(temp_dir_))
+    {
+        const std::string name = entry.path().filename().string();
+        EXPECT_TRUE(name == "content" || name == "out.torrent") << name;
+    }
+}
@@ -0,0 +1,191 @@
+#include "portable.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "device_scheduler.hpp"
+#include "throughput_model.hpp"
+
+namespace fs = std::filesystem;
+
+class DeviceSchedulerTest : public ::testing::Test
+{
+  protected:
+    fs::path sysfs_;
+
+    void SetUp() override
+    {
+        sysfs_ = fs::temp_directory_path() / ("torrent_device_test_" + std::to_string(portable_getpid()));
+        fs::create_directories(sysfs_ / "dev" / "block");
+    }
+
+    void TearDown() override
+    {
+        std::error_code ec;
+        fs::remove_all(sysfs_, ec);
+    }
+
+    void write(const fs::path &path, const std::string &text)
+    {
+        fs::create_directories(path.parent_path());
+        std::ofstream(path) << text << "\n";
+    }
+
+    // Disk directory under devices/ with its dev number and rotational flag
+    fs::path add_disk(const std::string &name, const std::string &dev, bool rotational)
+    {
+        fs::path dir = sysfs_ / "devices" / "virtual" / "block" / name;
+        write(dir / "dev", dev);
+        write(dir / "queue" / "rotational", rotational ? "1" : "0");
+        fs::create_directory_symlink(dir, sysfs_ / "dev" / "block" / dev);
+        return dir;
+    }
+
+    fs::path add_partition(const fs::path &disk, const std::string &name, const std::string &dev)
+    {
+        fs::path dir = disk / name;
+        write(dir / "dev", dev);
+        write(dir / "partition", "1");
+        fs::create_directory_symlink(dir, sysfs_ / "dev" / "block" / dev);
+        return dir;
+    }
+};
+
+TEST_F(DeviceSchedulerTest, ResolvesPartitionsToTheirDisk)
+{
+    fs::path sda = add_disk("sda", "8:0", true);
+    add_partition(sda, "sda1", "8:1");
+    add_partition(sda, "sda2", "8:2");
+    add_disk("nvme0n1", "259:0", false);
+
+    StorageDevice first = block_device_info(8, 1, sysfs_);
+    StorageDevice second = block_device_info(8, 2, sysfs_);
+    EXPECT_EQ(first.id, "8:0");
+    EXPECT_EQ(first.name, "sda");
+    EXPECT_TRUE(first.rotational);
+    EXPECT_EQ(second.id, first.id);
+
+    StorageDevice nvme = block_device_info(259, 0, sysfs_);
+    EXPECT_EQ(nvme.name, "nvme0n1");
+    EXPECT_FALSE(nvme.rotational);
+
+    StorageDevice unknown = block_device_info(0, 42, sysfs_);
+    EXPECT_EQ(unknown.id, "0:42");
+    EXPECT_FALSE(unknown.rotational);
+}
+
+TEST_F(DeviceSchedulerTest, StackedDeviceInheritsRotationalMembers)
+{
+    fs::path sdb = add_disk("sdb", "8:16", true);
+    fs::path part = add_partition(sdb, "sdb1", "8:17");
+    fs::path dm = add_disk("dm-0", "253:0", false);
+    fs::create_directories(dm / "slaves");
+    fs::create_directory_symlink(part, dm / "slaves" / "sdb1");
+
+    EXPECT_TRUE(block_device_info(253, 0, sysfs_).rotational);
+}
+
+TEST_F(DeviceSchedulerTest, CapsReadersPerDeviceAndSpreadsWork)
+{
+    const StorageDevice hdd{"8:0", "sda", true};
+    const StorageDevice ssd{"259:0", "nvme0n1", false};
+    const std::vector<StorageDevice> devices = {hdd, hdd, hdd, hdd, ssd, ssd, ssd, ssd};
+    DeviceScheduler scheduler(devices, 1, 2);
+
+    std::mutex mutex;
+    std::map<std::string, int> running;
+    std::map<std::string, int> peak;
+    std::vector<int> order;
+
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 6; ++w)
+    {
+        workers.emplace_back([&]
+        {
+            while (auto job = scheduler.acquire())
+            {
+                const std::string &id = devices[*job].id;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    order.push_back(*job);
+                    peak[id] = std::max(peak[id], ++running[id]);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    --running[id];
+                }
+                scheduler.release(*job);
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    EXPECT_EQ(peak["8:0"], 1);
+    EXPECT_EQ(peak["259:0"], 2);
+    ASSERT_EQ(order.size(), devices.size());
+    // Jobs of one device keep their order; the first two go to different disks
+    std::vector<int> hdd_jobs;
+    std::copy_if(order.begin(), order.end(), std::back_inserter(hdd_jobs), [](int j) { return j < 4; });
+    EXPECT_TRUE(std::is_sorted(hdd_jobs.begin(), hdd_jobs.end()));
+    EXPECT_NE(devices[order[0]].id, devices[order[1]].id);
+}
+
+TEST_F(DeviceSchedulerTest, UncappedDeviceRunsEveryWorker)
+{
+    const std::vector<StorageDevice> devices(4, StorageDevice{"259:0", "nvme0n1", false});
+    DeviceScheduler scheduler(devices, 1, 0);
+    std::vector<int> taken;
+    for (int i = 0; i < 4; ++i)
+        taken.push_back(*scheduler.acquire());
+    EXPECT_EQ(taken, (std::vector<int>{0, 1, 2, 3}));
+    EXPECT_FALSE(scheduler.acquire().has_value());
+}
+
+TEST_F(DeviceSchedulerTest, DispatchesInGivenOrder)
+{
+    const std::vector<StorageDevice> devices(4, StorageDevice{"259:0", "nvme0n1", false});
+    DeviceScheduler scheduler(devices, 1, 0, {3, 1, 0, 2});
+    std::vector<int> taken;
+    while (auto job = scheduler.acquire())
+        taken.push_back(*job);
+    EXPECT_EQ(taken, (std::vector<int>{3, 1, 0, 2}));
+}
+
+TEST_F(DeviceSchedulerTest, ThroughputModelLearnsAndPersists)
+{
+    const StorageDevice sda{"8:0", "sda", true};
+    const StorageDevice sdb{"8:16", "sdb", true};
+    const StorageDevice nvme{"259:0", "nvme0n1", false};
+    const int64_t gib = 1024LL * 1024 * 1024;
+    const fs::path file = sysfs_ / "throughput.txt";
+
+    {
+        ThroughputModel model(file);
+        EXPECT_DOUBLE_EQ(model.estimate_seconds(sda, gib), gib / ThroughputModel::kDefaultHddBytesPerSecond);
+        EXPECT_LT(model.estimate_seconds(nvme, gib), model.estimate_seconds(sda, gib));
+
+        model.record(sda, gib, 10.0);
+        model.record(nvme, gib, 0.5);  // Too short to trust
+        EXPECT_NEAR(model.estimate_seconds(sda, gib), 10.0, 0.01);
+        // Another spinning disk falls back to what was learned for the class
+        EXPECT_NEAR(model.estimate_seconds(sdb, gib), 10.0, 0.01);
+        EXPECT_DOUBLE_EQ(model.estimate_seconds(nvme, gib), gib / ThroughputModel::kDefaultSsdBytesPerSecond);
+        model.save();
+    }
+
+    ThroughputModel reloaded(file);
+    EXPECT_NEAR(reloaded.estimate_seconds(sda, gib), 10.0, 0.01);
+    reloaded.record(sda, gib, 20.0);
+    const double blended = reloaded.estimate_seconds(sda, gib);
+    EXPECT_GT(blended, 10.0);
+    EXPECT_LT(blended, 20.0);
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <libtorrent/hasher.hpp>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "hash_backend.hpp"
+
+// Runs each test with every kernel; kernels the host CPU lacks are skipped.
+class HashBackendTest : public ::testing::TestWithParam<HashKernel>
+{
+  protected:
+    HashKernel previous_kernel_ = HashKernel::GENERIC;
+    bool previous_verify_ = false;
+    std::vector<char> data_;
+
+    void SetUp() override
+    {
+        if (!hash_backend::supported(GetParam()))
+        {
+            GTEST_SKIP() << hash_backend::kernel_name(GetParam()) << " not supported on this CPU";
+        }
+        previous_kernel_ = hash_backend::active();
+        previous_verify_ = hash_backend::verify();
+        hash_backend::set_active(GetParam());
+
+        std::mt19937 rng(42);
+        data_.resize(1 << 20);
+        for (auto &c : data_)
+        {
+            c = static_cast<char>(rng());
+        }
+    }
+
+    void TearDown() override
+    {
+        if (hash_backend::supported(GetParam()))
+        {
+            hash_backend::set_active(previous_kernel_);
+            hash_backend::set_verify(previous_verify_);
+        }
+    }
+
+    // Sizes around the padding boundaries, plus runs of equal sizes that fill SIMD lanes.
+    std::vector<HashInput> mixed_inputs() const
+    {
+        std::vector<int64_t> sizes = {0, 1, 55, 56, 63, 64, 65, 119, 120, 128, 1000, 65536};
+        for (int i = 0; i < 19; ++i)
+            sizes.push_back(16384);
+        for (int i = 0; i < 9; ++i)
+            sizes.push_back(262144);
+        for (int i = 0; i < 3; ++i)
+            sizes.push_back(77);
+
+        std::vector<HashInput> inputs;
+        for (size_t i = 0; i < sizes.size(); ++i)
+        {
+            inputs.push_back({data_.data() + i * 131, sizes[i]});
+        }
+        return inputs;
+    }
+};
+
+TEST_P(HashBackendTest, Sha1MatchesLibtorrent)
+{
+    auto inputs = mixed_inputs();
+    std::vector<lt::sha1_hash> out(inputs.size());
+    hash_backend::sha1(inputs.data(), out.data(), static_cast<int>(inputs.size()));
+
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        lt::hasher h;
+        h.update(inputs[i].data, static_cast<int>(inputs[i].size));
+        EXPECT_EQ(out[i], h.final()) << "message " << i << " of " << inputs[i].size << " bytes";
+    }
+}
+
+TEST_P(HashBackendTest, Sha256MatchesLibtorrent)
+{
+    auto inputs = mixed_inputs();
+    std::vector<lt::sha256_hash> out(inputs.size());
+    hash_backend::sha256(inputs.data(), out.data(), static_cast<int>(inputs.size()));
+
+    for (size_t i = 0; i < inputs.size(); ++i)
+    {
+        lt::hasher256 h;
+        h.update(inputs[i].data, static_cast<int>(inputs[i].size));
+        EXPECT_EQ(out[i], h.final()) << "message " << i << " of " << inputs[i].size << " bytes";
+    }
+}
+
+TEST_P(HashBackendTest, VerifyModeAgreesWithOpenSSL)
+{
+    hash_backend::set_verify(true);
+    auto inputs = mixed_inputs();
+    std::vector<lt::sha1_hash> out1(inputs.size());
+    std::vector<lt::sha256_hash> out256(inputs.size());
+    EXPECT_NO_THROW(hash_backend::sha1(inputs.data(), out1.data(), static_cast<int>(inputs.size())));
+    EXPECT_NO_THROW(hash_backend::sha256(inputs.data(), out256.data(), static_cast<int>(inputs.size())));
+}
+
+TEST_P(HashBackendTest, SingleMessageMatchesBatch)
+{
+    HashInput in{data_.data(), 300000};
+    lt::sha256_hash batched;
+    hash_backend::sha256(&in, &batched, 1);
+    EXPECT_EQ(hash_backend::sha256(in.data, in.size), batched);
+}
+
+INSTANTIATE_TEST_SUITE_P(Kernels, HashBackendTest,
+                         ::testing::Values(HashKernel::GENERIC, HashKernel::SHA_NI, HashKernel::AVX2,
+                                           HashKernel::AVX512),
+                         [](const auto &info) {
+                             std::string name = hash_backend::kernel_name(info.param);
+                             std::erase(name, '-');
+                             return name;
+                         });
+
+TEST(HashBackendParseTest, ParsesKernelNames)
+{
+    EXPECT_EQ(hash_backend::parse_kernel("generic"), HashKernel::GENERIC);
+    EXPECT_EQ(hash_backend::parse_kernel("SHANI"), HashKernel::SHA_NI);
+    EXPECT_EQ(hash_backend::parse_kernel("sha-ni"), HashKernel::SHA_NI);
+    EXPECT_EQ(hash_backend::parse_kernel("avx2"), HashKernel::AVX2);
+    EXPECT_EQ(hash_backend::parse_kernel("AVX-512"), HashKernel::AVX512);
+    EXPECT_THROW(hash_backend::parse_kernel("neon"), std::invalid_argument);
+}
+
+TEST(HashBackendParseTest, DetectedKernelIsSupported)
+{
+    EXPECT_TRUE(hash_backend::supported(hash_backend::detect()));
+    EXPECT_TRUE(hash_backend::supported(HashKernel::GENERIC));
+}
@@ -0,0 +1,183 @@
+#include "portable.hpp"
+#include <gtest/gtest.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "hash_cache.hpp"
+#include "torrent_creator.hpp"
+
+namespace fs = std::filesystem;
+
+class HashCacheTest : public ::testing::Test
+{
+  protected:
+    fs::path temp_dir_;
+    fs::path cache_path_;
+
+    void SetUp() override
+    {
+        temp_dir_ = fs::temp_directory_path() / ("torrent_hash_cache_test_" + std::to_string(portable_getpid()));
+        fs::create_directories(temp_dir_);
+        cache_path_ = temp_dir_ / "cache" / "piece-hashes.bin";
+    }
+
+    void TearDown() override
+    {
+        std::error_code ec;
+        fs::remove_all(temp_dir_, ec);
+    }
+
+    static HashCache::Key key(int n)
+    {
+        HashCache::Key k;
+        std::memcpy(k.data(), &n, sizeof(n));
+        return k;
+    }
+
+    static std::string read_all(const fs::path &path)
+    {
+        std::ifstream f(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(f), {});
+    }
+
+    void write_file(const fs::path &path, size_t size, char seed)
+    {
+        fs::create_directories(path.parent_path());
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+            content[i] = static_cast<char>(seed + i * 7 + i / 509);
+        std::ofstream f(path, std::ios::binary);
+        f.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    std::string create(const fs::path &content, TorrentVersion version, std::shared_ptr<HashCache> cache)
+    {
+        fs::path out = temp_dir_ / "out.torrent";
+        TorrentConfig config(content, out, {}, version);
+        config.piece_size = 16 * 1024;
+        config.include_creation_date = false;
+        config.silent = true;
+        config.hash_cache = std::move(cache);
+        TorrentCreator(std::move(config)).create_torrent();
+        return read_all(out);
+    }
+};
+
+TEST_F(HashCacheTest, StoresAndPersists)
+{
+    {
+        HashCache cache(cache_path_);
+        std::vector<char> payload;
+        EXPECT_FALSE(cache.lookup(key(1), payload));
+        cache.store(key(1), "hello", 5);
+        cache.store(key(2), "world!", 6);
+        ASSERT_TRUE(cache.lookup(key(1), payload));
+        EXPECT_EQ(std::string(payload.begin(), payload.end()), "hello");
+        EXPECT_EQ(cache.hits(), 1);
+        EXPECT_EQ(cache.misses(), 1);
+    }
+
+    HashCache reopened(cache_path_);
+    EXPECT_EQ(reopened.entries(), 2u);
+    std::vector<char> payload;
+    ASSERT_TRUE(reopened.lookup(key(2), payload));
+    EXPECT_EQ(std::string(payload.begin(), payload.end()), "world!");
+}
+
+TEST_F(HashCacheTest, LaterRecordReplacesEarlier)
+{
+    HashCache cache(cache_path_);
+    cache.store(key(1), "old", 3);
+    cache.store(key(1), "newer", 5);
+    std::vector<char> payload;
+    ASSERT_TRUE(cache.lookup(key(1), payload));
+    EXPECT_EQ(std::string(payload.begin(), payload.end()), "newer");
+    EXPECT_EQ(cache.entries(), 1u);
+}
+
+TEST_F(HashCacheTest, SeesRecordsOfAnotherInstance)
+{
+    HashCache reader(cache_path_);
+    HashCache writer(cache_path_);
+    writer.store(key(7), "shared", 6);
+    std::vector<char> payload;
+    ASSERT_TRUE(reader.lookup(key(7), payload));
+    EXPECT_EQ(std::string(payload.begin(), payload.end()), "shared");
+}
+
+TEST_F(HashCacheTest, IgnoresTornTail)
+{
+    {
+        HashCache cache(cache_path_);
+        cache.store(key(1), "intact", 6);
+        cache.store(key(2), "partial record", 14);
+    }
+    // Cut the last record short, as a crash mid-append would
+    fs::resize_file(cache_path_, fs::file_size(cache_path_) - 10);
+
+    HashCache cache(cache_path_);
+    std::vector<char> payload;
+    EXPECT_TRUE(cache.lookup(key(1), payload));
+    EXPECT_FALSE(cache.lookup(key(2), payload));
+
+    cache.store(key(3), "after", 5);
+    HashCache reopened(cache_path_);
+    EXPECT_EQ(reopened.entries(), 2u);
+    EXPECT_TRUE(reopened.lookup(key(3), payload));
+}
+
+TEST_F(HashCacheTest, EvictsLeastRecentlyUsed)
+{
+    const std::vector<char> blob(1000, 'x');
+    HashCache cache(cache_path_, 16 * 1024);
+    cache.store(key(0), blob.data(), blob.size());
+    std::vector<char> payload;
+    for (int i = 1; i < 40; ++i)
+    {
+        // Keep record 0 hot while the others age
+        ASSERT_TRUE(cache.lookup(key(0), payload)) << "record 0 evicted after " << i << " stores";
+        cache.store(key(i), blob.data(), blob.size());
+    }
+
+    EXPECT_LE(cache.file_size(), 16 * 1024);
+    EXPECT_TRUE(cache.lookup(key(0), payload));
+    EXPECT_TRUE(cache.lookup(key(39), payload));
+    EXPECT_FALSE(cache.lookup(key(1), payload));
+}
+
+// Re-creating unchanged content must reuse the cached hashes and produce the
+// same torrent; a rewrite that keeps size and mtime must still be noticed.
+TEST_F(HashCacheTest, CreatorReusesHashesOfUnchangedFiles)
+{
+    const fs::path content = temp_dir_ / "content";
+    write_file(content / "a.bin", 50000, 1);
+    write_file(content / "sub" / "b.bin", 3000, 2);
+    write_file(content / "sub" / "c.bin", 70000, 3);
+
+    for (TorrentVersion version : {TorrentVersion::V1, TorrentVersion::V2, TorrentVersion::HYBRID})
+    {
+        std::error_code ec;
+        fs::remove(cache_path_, ec);
+        auto cache = std::make_shared<HashCache>(cache_path_);
+
+        const std::string reference = create(content, version, nullptr);
+        EXPECT_EQ(create(content, version, cache), reference);
+        EXPECT_EQ(cache->hits(), 0);
+
+        EXPECT_EQ(create(content, version, cache), reference);
+        EXPECT_GT(cache->hits(), 0);
+
+        // Same size, same mtime, different bytes
+        const auto mtime = fs::last_write_time(content / "sub" / "c.bin");
+        write_file(content / "sub" / "c.bin", 70000, 9);
+        fs::last_write_time(content / "sub" / "c.bin", mtime);
+        const std::string changed = create(content, version, nullptr);
+        EXPECT_NE(changed, reference);
+        EXPECT_EQ(create(content, version, cache), changed);
+
+        write_file(content / "sub" / "c.bin", 70000, 3);
+    }
+}
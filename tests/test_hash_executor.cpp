@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "hash_executor.hpp"
+
+TEST(HashExecutorTest, RunsEveryTaskBeforeWaitReturns)
+{
+    HashExecutor executor(4);
+    auto group = executor.make_group();
+    std::atomic<int> done{0};
+    for (int i = 0; i < 1000; ++i)
+        group->submit([&] { done.fetch_add(1); });
+    group->wait();
+    EXPECT_EQ(done.load(), 1000);
+}
+
+TEST(HashExecutorTest, NeverExceedsThreadBudget)
+{
+    HashExecutor executor(3);
+    std::atomic<int> running{0};
+    std::atomic<int> peak{0};
+    auto task = [&]
+    {
+        const int now = running.fetch_add(1) + 1;
+        int seen = peak.load();
+        while (now > seen && !peak.compare_exchange_weak(seen, now))
+        {
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        running.fetch_sub(1);
+    };
+
+    // Several jobs submitting at once, as batch workers do
+    std::vector<std::thread> workers;
+    for (int w = 0; w < 8; ++w)
+    {
+        workers.emplace_back([&]
+        {
+            auto group = executor.make_group();
+            for (int i = 0; i < 50; ++i)
+                group->submit(task);
+            group->wait();
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    EXPECT_EQ(executor.threads(), 3);
+    EXPECT_LE(peak.load(), 3);
+    EXPECT_GE(peak.load(), 1);
+}
+
+// A group queued behind a large backlog must not wait for that backlog to drain
+TEST(HashExecutorTest, SharesThreadsFairlyBetweenGroups)
+{
+    HashExecutor executor(1);
+    auto big = executor.make_group();
+    auto small = executor.make_group();
+    std::atomic<int> big_done{0};
+    std::atomic<int> big_done_when_small_finished{-1};
+
+    for (int i = 0; i < 200; ++i)
+        big->submit([&]
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            big_done.fetch_add(1);
+        });
+    std::atomic<int> small_done{0};
+    for (int i = 0; i < 5; ++i)
+        small->submit([&]
+        {
+            if (small_done.fetch_add(1) + 1 == 5)
+                big_done_when_small_finished.store(big_done.load());
+        });
+
+    small->wait();
+    EXPECT_LT(big_done_when_small_finished.load(), 50);
+    big->wait();
+    EXPECT_EQ(big_done.load(), 200);
+}
@@ -0,0 +1,146 @@
+#include "portable.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <libtorrent/create_torrent.hpp>
+#include <libtorrent/torrent_info.hpp>
+#include <libtorrent/file_storage.hpp>
+#include <libtorrent/hasher.hpp>
+#include <libtorrent/bencode.hpp>
+#include <libtorrent/entry.hpp>
+#include "merkle.hpp"
+
+namespace fs = std::filesystem;
+
+class MerkleTest : public ::testing::Test
+{
+  protected:
+    fs::path temp_dir_;
+
+    void SetUp() override
+    {
+        temp_dir_ = fs::temp_directory_path() / ("torrent_merkle_test_" + std::to_string(portable_getpid()));
+        fs::create_directories(temp_dir_);
+    }
+
+    void TearDown() override
+    {
+        std::error_code ec;
+        fs::remove_all(temp_dir_, ec);
+    }
+
+    fs::path create_file(const std::string &name, int64_t size)
+    {
+        auto path = temp_dir_ / name;
+        std::string content(static_cast<size_t>(size), '\0');
+        for (size_t i = 0; i < content.size(); ++i)
+        {
+            content[i] = static_cast<char>((i * 131 + i / 7) & 0xff);
+        }
+        std::ofstream f(path, std::ios::binary);
+        f.write(content.data(), static_cast<std::streamsize>(content.size()));
+        return path;
+    }
+
+    // A v2-only single-file torrent as libtorrent hashes it.
+    lt::torrent_info libtorrent_info(const std::string &name, int64_t size, int piece_size)
+    {
+        lt::file_storage file_storage;
+        file_storage.add_file(name, size);
+        lt::create_torrent ct(file_storage, piece_size, lt::create_torrent::v2_only);
+        lt::set_piece_hashes(ct, temp_dir_.string());
+
+        std::vector<char> buffer;
+        lt::bencode(std::back_inserter(buffer), ct.generate());
+        return lt::torrent_info(buffer, lt::from_span);
+    }
+};
+
+TEST_F(MerkleTest, NumLeafsRoundsUpToPowerOfTwo)
+{
+    EXPECT_EQ(merkle::num_leafs(0), 1);
+    EXPECT_EQ(merkle::num_leafs(1), 1);
+    EXPECT_EQ(merkle::num_leafs(3), 4);
+    EXPECT_EQ(merkle::num_leafs(64), 64);
+    EXPECT_EQ(merkle::num_leafs(65), 128);
+}
+
+TEST_F(MerkleTest, RootOfTwoLeavesIsHashOfPair)
+{
+    lt::sha256_hash a = lt::hasher256("a", 1).final();
+    lt::sha256_hash b = lt::hasher256("b", 1).final();
+
+    lt::hasher256 h;
+    h.update(a.data(), static_cast<int>(a.size()));
+    h.update(b.data(), static_cast<int>(b.size()));
+
+    EXPECT_EQ(merkle::root({a, b}, 2), h.final());
+}
+
+TEST_F(MerkleTest, PadHashMatchesRootOfZeroLeaves)
+{
+    std::vector<lt::sha256_hash> zeros(8);
+    EXPECT_EQ(merkle::pad_hash(8), merkle::root(zeros, 8));
+    EXPECT_TRUE(merkle::pad_hash(1).is_all_zeros());
+}
+
+// The helpers the creator and checker build v2 trees from must reproduce
+// libtorrent's piece layers and pieces roots.
+TEST_F(MerkleTest, PieceAndLayerRootsMatchLibtorrent)
+{
+    struct Case { int64_t size; int piece_size; };
+    const std::vector<Case> cases = {
+        {1, 16384},
+        {16384, 16384},
+        {40000, 65536},
+        {100000, 16384},
+        {100000, 65536},
+        {1048576, 262144},
+        {3 * 1048576 + 12345, 1048576},
+        {5000000, 4194304},
+    };
+
+    for (const auto &c : cases)
+    {
+        std::string name = "file_" + std::to_string(c.size) + "_" + std::to_string(c.piece_size) + ".bin";
+        auto path = create_file(name, c.size);
+        std::string data(static_cast<size_t>(c.size), '\0');
+        std::ifstream(path, std::ios::binary).read(data.data(), c.size);
+
+        const int leafs = merkle::piece_leafs(c.size, c.piece_size);
+        std::vector<lt::sha256_hash> layer;
+        for (int64_t offset = 0; offset < c.size; offset += c.piece_size)
+        {
+            const int len = static_cast<int>(std::min<int64_t>(c.piece_size, c.size - offset));
+            layer.push_back(merkle::piece_root(data.data() + offset, len, leafs));
+        }
+
+        lt::torrent_info ti = libtorrent_info(name, c.size, c.piece_size);
+        const lt::file_index_t file(0);
+        if (layer.size() > 1)
+        {
+            // Single-piece files have no piece layer: their root is the piece
+            lt::span<char const> expected = ti.piece_layer(file);
+            ASSERT_EQ(static_cast<size_t>(expected.size()), layer.size() * lt::sha256_hash::size()) << name;
+            for (size_t i = 0; i < layer.size(); ++i)
+            {
+                EXPECT_EQ(layer[i], lt::sha256_hash(expected.data() + i * lt::sha256_hash::size()))
+                    << name << ", piece " << i;
+            }
+        }
+        EXPECT_EQ(merkle::layer_root(layer, c.piece_size), ti.files().root(file)) << name;
+    }
+}
+
+TEST_F(MerkleTest, PieceLeafsPadSmallFilesToTheirBlocks)
+{
+    EXPECT_EQ(merkle::piece_leafs(1, 65536), 1);
+    EXPECT_EQ(merkle::piece_leafs(40000, 65536), 4);
+    EXPECT_EQ(merkle::piece_leafs(65536, 65536), 4);
+    EXPECT_EQ(merkle::piece_leafs(65537, 65536), 4);
+    EXPECT_EQ(merkle::piece_leafs(10000000, 1048576), 64);
+    EXPECT_TRUE(merkle::layer_root({}, 65536).is_all_zeros());
+}
@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include "path_filter.hpp"
+#include "utils.hpp"
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+std::vector<std::regex> to_regex(const std::vector<std::string> &globs)
+{
+    std::vector<std::regex> out;
+    for (const auto &g : globs)
+        out.push_back(utils::glob_to_regex(g));
+    return out;
+}
+
+std::string random_string(std::mt19937 &rng, const std::string &alphabet, int max_len)
+{
+    std::uniform_int_distribution<int> len(0, max_len);
+    std::uniform_int_distribution<size_t> pick(0, alphabet.size() - 1);
+    std::string s(static_cast<size_t>(len(rng)), '\0');
+    for (auto &c : s)
+        c = alphabet[pick(rng)];
+    return s;
+}
+
+}
+
+TEST(PathFilter, EmptyKeepsEverything)
+{
+    PathFilter filter;
+    EXPECT_TRUE(filter.empty());
+    EXPECT_TRUE(filter.should_include_file("any/path.bin"));
+    EXPECT_FALSE(filter.should_prune_directory("any"));
+}
+
+TEST(PathFilter, ExcludeAndIncludePrecedence)
+{
+    PathFilter filter({"*.nfo", "**/*.txt"}, {"keep.txt"});
+    EXPECT_TRUE(filter.should_include_file("keep.txt"));
+    EXPECT_FALSE(filter.should_include_file("movie.mkv"));
+    EXPECT_FALSE(filter.should_include_file("a/b.txt"));
+
+    PathFilter excludes_only({"*.nfo", "**/*.txt"}, {});
+    EXPECT_FALSE(excludes_only.should_include_file("info.NFO"));
+    EXPECT_TRUE(excludes_only.should_include_file("sub/info.nfo"));
+    EXPECT_FALSE(excludes_only.should_include_file("sub/deep/notes.TXT"));
+    EXPECT_TRUE(excludes_only.should_include_file("movie.mkv"));
+}
+
+TEST(PathFilter, BuiltinExcludesMatchAtAnyDepth)
+{
+    PathFilter filter(utils::builtin_exclude_patterns(), {});
+    EXPECT_FALSE(filter.should_include_file(".DS_Store"));
+    EXPECT_FALSE(filter.should_include_file("a/b/thumbs.db"));
+    EXPECT_FALSE(filter.should_include_file("x/Zone.Identifier:$DATA"));
+    EXPECT_FALSE(filter.should_include_file("@eaDir/file"));
+    EXPECT_TRUE(filter.should_include_file("movie.mkv"));
+    EXPECT_TRUE(filter.should_prune_directory("photos/@eaDir"));
+    EXPECT_FALSE(filter.should_prune_directory("photos"));
+}
+
+TEST(PathFilter, PrunesOnlyWithoutIncludes)
+{
+    PathFilter excludes({"Sample/"}, {});
+    EXPECT_TRUE(excludes.should_prune_directory("Sample"));
+    EXPECT_TRUE(excludes.should_prune_directory("sample"));
+    EXPECT_FALSE(excludes.should_prune_directory("a/Sample"));
+
+    PathFilter with_includes({"Sample/"}, {"*.mkv"});
+    EXPECT_FALSE(with_includes.should_prune_directory("Sample"));
+}
+
+TEST(PathFilter, ManyPatternsSpanSeveralWords)
+{
+    std::vector<std::string> globs;
+    for (int i = 0; i < 40; ++i)
+        globs.push_back("**/dir" + std::to_string(i) + "/*.bin");
+    PathFilter filter(globs, {});
+    EXPECT_FALSE(filter.should_include_file("x/dir39/f.bin"));
+    EXPECT_FALSE(filter.should_include_file("dir0/f.bin"));
+    EXPECT_TRUE(filter.should_include_file("dir40/f.bin"));
+    EXPECT_TRUE(filter.should_include_file("dir39/sub/f.bin"));
+}
+
+// The automaton must agree with the std::regex path on every input, including
+// the corner cases of '**' (no line breaks) versus '*' and '?' (no slashes).
+TEST(PathFilter, AgreesWithRegexOnRandomPatterns)
+{
+    std::mt19937 rng(7);
+    const std::string pattern_alphabet = "aB/.**?*\n";
+    const std::string path_alphabet = "abAB/.\n\r?*";
+    for (int round = 0; round < 400; ++round)
+    {
+        std::vector<std::string> excludes;
+        std::vector<std::string> includes;
+        for (int i = rng() % 3; i > 0; --i)
+            excludes.push_back(random_string(rng, pattern_alphabet, 8));
+        if (round % 3 == 0)
+            includes.push_back(random_string(rng, pattern_alphabet, 8));
+
+        PathFilter filter(excludes, includes);
+        auto exclude_re = to_regex(excludes);
+        auto include_re = to_regex(includes);
+
+        for (int j = 0; j < 60; ++j)
+        {
+            std::string path = random_string(rng, path_alphabet, 10);
+            EXPECT_EQ(filter.should_include_file(path), utils::should_include_file(path, exclude_re, include_re))
+                << "path '" << path << "'";
+
+            bool pruned = false;
+            if (include_re.empty())
+            {
+                for (const auto &re : exclude_re)
+                    pruned |= std::regex_match(path + "/", re) || std::regex_match(path, re);
+            }
+            EXPECT_EQ(filter.should_prune_directory(path), pruned) << "directory '" << path << "'";
+        }
+    }
+}
+
+// Micro-benchmark against the per-pattern std::regex path. Disabled by default;
+// run with --gtest_also_run_disabled_tests --gtest_filter='*Benchmark*'.
+TEST(PathFilterBenchmark, DISABLED_AgainstRegex)
+{
+    std::vector<std::string> excludes = utils::builtin_exclude_patterns();
+    for (int i = 0; i < 12; ++i)
+        excludes.push_back("**/extras" + std::to_string(i) + "/**");
+    const std::vector<std::string> includes;
+
+    std::vector<std::string> paths;
+    std::mt19937 rng(1);
+    for (int i = 0; i < 200000; ++i)
+    {
+        paths.push_back("Show.S01/Season " + std::to_string(rng() % 9) + "/disc" + std::to_string(rng() % 40) +
+                        "/Show.S01E" + std::to_string(rng() % 99) + ".1080p.WEB-DL.x264.mkv");
+    }
+
+    auto time = [&](auto &&fn) {
+        auto start = std::chrono::steady_clock::now();
+        size_t kept = 0;
+        for (const auto &p : paths)
+            kept += fn(p) ? 1 : 0;
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return std::make_pair(seconds, kept);
+    };
+
+    PathFilter filter(excludes, includes);
+    auto exclude_re = to_regex(excludes);
+    const std::vector<std::regex> include_re;
+    auto [regex_s, regex_kept] = time([&](const std::string &p) { return utils::should_include_file(p, exclude_re, include_re); });
+    auto [automaton_s, automaton_kept] = time([&](const std::string &p) { return filter.should_include_file(p); });
+
+    EXPECT_EQ(regex_kept, automaton_kept);
+    std::cout << paths.size() << " paths x " << excludes.size() << " patterns: std::regex "
+              << regex_s * 1000 << " ms, automaton " << automaton_s * 1000 << " ms ("
+              << regex_s / automaton_s << "x)\n";
+}
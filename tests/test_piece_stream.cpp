@@ -0,0 +1,233 @@
+#include "portable.hpp"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <fstream>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "piece_stream.hpp"
+
+namespace fs = std::filesystem;
+
+// Runs each test with io_uring (where the host allows it) and with the synchronous readers.
+class PieceStreamTest : public ::testing::TestWithParam<bool>
+{
+  protected:
+    fs::path temp_dir_;
+    std::vector<fs::path> files_;
+    std::vector<std::string> contents_;
+
+    void SetUp() override
+    {
+        temp_dir_ = fs::temp_directory_path() / ("torrent_piece_stream_test_" + std::to_string(portable_getpid()));
+        fs::create_directories(temp_dir_);
+    }
+
+    void TearDown() override
+    {
+        std::error_code ec;
+        fs::remove_all(temp_dir_, ec);
+    }
+
+    void add_file(const std::string &name, size_t size, char seed)
+    {
+        std::string content(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            content[i] = static_cast<char>(seed + i * 13 + i / 251);
+        }
+        std::ofstream f(temp_dir_ / name, std::ios::binary);
+        f.write(content.data(), static_cast<std::streamsize>(content.size()));
+        files_.push_back(temp_dir_ / name);
+        contents_.push_back(content);
+    }
+
+    // Concatenates all files with `pad` zero bytes after each, split into fixed-size pieces.
+    PieceStream::Layout layout(int piece_size, int64_t pad, const std::vector<int64_t> &sizes)
+    {
+        return [=](int piece, std::vector<ReadSpan> &spans) {
+            int64_t start = static_cast<int64_t>(piece) * piece_size;
+            int64_t pos = 0;
+            int64_t taken = 0;
+            for (size_t f = 0; f < sizes.size(); ++f)
+            {
+                for (int part = 0; part < 2; ++part)
+                {
+                    int64_t len = part == 0 ? sizes[f] : pad;
+                    int64_t lo = std::max(start, pos);
+                    int64_t hi = std::min(start + piece_size, pos + len);
+                    if (lo < hi)
+                    {
+                        spans.push_back({part == 0 ? static_cast<int>(f) : -1, part == 0 ? lo - pos : 0, hi - lo});
+                        taken += hi - lo;
+                    }
+                    pos += len;
+                }
+            }
+            return static_cast<int>(taken);
+        };
+    }
+
+    std::string expected_stream(int64_t pad, const std::vector<int64_t> &sizes)
+    {
+        std::string all;
+        for (size_t f = 0; f < sizes.size(); ++f)
+        {
+            std::string c = f < contents_.size() ? contents_[f] : std::string();
+            c.resize(static_cast<size_t>(sizes[f]), '\0');
+            all += c;
+            all += std::string(static_cast<size_t>(pad), '\0');
+        }
+        return all;
+    }
+
+    struct Collected
+    {
+        std::string data;
+        std::vector<int> seen;
+        int64_t missing = 0;
+        std::string first_error;
+    };
+
+    Collected collect(PieceStream &stream, int piece_size, int64_t total)
+    {
+        if (!GetParam())
+        {
+            stream.disable_async();
+        }
+        Collected out;
+        out.data.assign(static_cast<size_t>(total), '\x7f');
+        std::mutex mutex;
+        std::atomic<bool> cancel{false};
+        stream.run([&](StreamPiece *p) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::copy(p->data.begin(), p->data.begin() + p->size,
+                          out.data.begin() + static_cast<int64_t>(p->index) * piece_size);
+                out.seen.push_back(p->index);
+                out.missing += p->missing;
+                if (out.first_error.empty())
+                    out.first_error = p->error;
+            }
+            stream.release(p);
+        }, cancel, 3);
+        std::sort(out.seen.begin(), out.seen.end());
+        return out;
+    }
+};
+
+TEST_P(PieceStreamTest, DeliversEveryPieceAcrossFiles)
+{
+    add_file("a.bin", 100000, 1);
+    add_file("b.bin", 7, 2);
+    add_file("c.bin", 300001, 3);
+    const std::vector<int64_t> sizes = {100000, 7, 300001};
+    const int piece_size = 16384;
+    const int64_t pad = 3000;
+    const int64_t total = 100000 + 7 + 300001 + 3 * pad;
+    const int num_pieces = static_cast<int>((total + piece_size - 1) / piece_size);
+
+    PieceStream stream(files_, num_pieces, layout(piece_size, pad, sizes), piece_size, 4);
+    Collected out = collect(stream, piece_size, total);
+
+    ASSERT_EQ(static_cast<int>(out.seen.size()), num_pieces);
+    for (int i = 0; i < num_pieces; ++i)
+    {
+        EXPECT_EQ(out.seen[i], i);
+    }
+    EXPECT_EQ(out.missing, 0);
+    EXPECT_EQ(out.data, expected_stream(pad, sizes));
+}
+
+TEST_P(PieceStreamTest, MissingAndShortFilesReadAsZeros)
+{
+    add_file("short.bin", 5000, 4);
+    files_.push_back(temp_dir_ / "missing.bin");
+    const std::vector<int64_t> sizes = {8000, 4000};
+    const int piece_size = 4096;
+    const int64_t total = 12000;
+    const int num_pieces = static_cast<int>((total + piece_size - 1) / piece_size);
+
+    PieceStream stream(files_, num_pieces, layout(piece_size, 0, sizes), piece_size, 2);
+    Collected out = collect(stream, piece_size, total);
+
+    EXPECT_EQ(static_cast<int>(out.seen.size()), num_pieces);
+    EXPECT_EQ(out.missing, 3000 + 4000);
+    EXPECT_FALSE(out.first_error.empty());
+    EXPECT_EQ(out.data, expected_stream(0, sizes));
+}
+
+TEST_P(PieceStreamTest, ManySmallFilesAcrossReaderRuns)
+{
+    // More files than a reader keeps open, and enough buffers for multi-piece runs
+    std::vector<int64_t> sizes;
+    for (int i = 0; i < 40; ++i)
+    {
+        add_file("f" + std::to_string(i) + ".bin", 1500 + i * 37, static_cast<char>(i));
+        sizes.push_back(1500 + i * 37);
+    }
+    const int piece_size = 4096;
+    const int64_t pad = 100;
+    int64_t total = 0;
+    for (int64_t size : sizes)
+        total += size + pad;
+    const int num_pieces = static_cast<int>((total + piece_size - 1) / piece_size);
+
+    PieceStream stream(files_, num_pieces, layout(piece_size, pad, sizes), piece_size, 24);
+    Collected out = collect(stream, piece_size, total);
+
+    ASSERT_EQ(static_cast<int>(out.seen.size()), num_pieces);
+    for (int i = 0; i < num_pieces; ++i)
+    {
+        EXPECT_EQ(out.seen[i], i);
+    }
+    EXPECT_EQ(out.missing, 0);
+    EXPECT_EQ(out.data, expected_stream(pad, sizes));
+}
+
+TEST_P(PieceStreamTest, CancelStopsDelivery)
+{
+    add_file("big.bin", 1 << 20, 5);
+    const int piece_size = 16384;
+    const int num_pieces = (1 << 20) / piece_size;
+
+    PieceStream stream(files_, num_pieces, layout(piece_size, 0, {1 << 20}), piece_size, 2);
+    if (!GetParam())
+    {
+        stream.disable_async();
+    }
+    std::atomic<bool> cancel{false};
+    int delivered = 0;
+    stream.run([&](StreamPiece *p) {
+        ++delivered;
+        cancel.store(true);
+        stream.release(p);
+    }, cancel, 1);
+
+    EXPECT_LT(delivered, num_pieces);
+}
+
+// io_uring must keep every free buffer's reads in flight, not wait for one
+// piece at a time.
+TEST_P(PieceStreamTest, KeepsSeveralReadsInFlight)
+{
+    if (!GetParam() || !PieceStream::async_available())
+    {
+        GTEST_SKIP() << "io_uring only";
+    }
+    add_file("big.bin", 1 << 20, 6);
+    const int piece_size = 16384;
+    const int num_pieces = (1 << 20) / piece_size;
+    const int buffers = 4;
+
+    PieceStream stream(files_, num_pieces, layout(piece_size, 0, {1 << 20}), piece_size, buffers);
+    Collected out = collect(stream, piece_size, 1 << 20);
+
+    ASSERT_TRUE(stream.used_async());
+    EXPECT_EQ(static_cast<int>(out.seen.size()), num_pieces);
+    EXPECT_GT(stream.peak_inflight(), 1);
+    EXPECT_LE(stream.peak_inflight(), buffers);
+}
+
+INSTANTIATE_TEST_SUITE_P(ReadPaths, PieceStreamTest, ::testing::Values(true, false));